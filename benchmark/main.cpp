@@ -0,0 +1,517 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "uniform_body.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Steps canonical scenes without a window and reports the step times, 
+// the solver iterations and the peak memory as CSV or JSON.
+// Run a single scene per process for an exact peak memory of that scene.
+
+// Return the peak resident memory of the process in bytes.
+static u64 GetPeakMemory()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return u64(counters.PeakWorkingSetSize);
+	}
+	return 0;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+	{
+		return 0;
+	}
+#if defined(__APPLE__)
+	// Bytes
+	return u64(usage.ru_maxrss);
+#else
+	// Kilobytes
+	return u64(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+class Scene
+{
+public:
+	Scene()
+	{
+		m_body = nullptr;
+	}
+
+	virtual ~Scene()
+	{
+		delete m_body;
+	}
+
+	UniformBody* GetBody()
+	{
+		return m_body;
+	}
+protected:
+	UniformBody* m_body;
+};
+
+// A cloth pinned at its borders.
+template<int N>
+class PinnedClothScene : public Scene
+{
+public:
+	PinnedClothScene()
+	{
+		ClothDef def;
+		def.mesh = &m_mesh;
+		def.density = 0.2f;
+		def.stretchingStiffness = 100000.0f;
+
+		m_body = new UniformBody(def);
+
+		m_body->SetGravity(b3Vec3(0.0f, -9.8f, 0.0f));
+
+		for (int i = 0; i < m_mesh.GetRowVertexCount(); ++i)
+		{
+			int v1 = m_mesh.GetVertex(i, 0);
+			int v2 = m_mesh.GetVertex(i, m_mesh.GetColumnVertexCount() - 1);
+
+			m_body->GetParticle(v1)->SetType(e_staticParticle);
+			m_body->GetParticle(v2)->SetType(e_staticParticle);
+		}
+
+		for (int j = 0; j < m_mesh.GetColumnVertexCount(); ++j)
+		{
+			int v1 = m_mesh.GetVertex(0, j);
+			int v2 = m_mesh.GetVertex(m_mesh.GetRowVertexCount() - 1, j);
+
+			m_body->GetParticle(v1)->SetType(e_staticParticle);
+			m_body->GetParticle(v2)->SetType(e_staticParticle);
+		}
+	}
+
+	GridClothMesh<N, N> m_mesh;
+};
+
+// A block of tetrahedrons falling on a box.
+template<int N>
+class TetBoxScene : public Scene
+{
+public:
+	TetBoxScene()
+	{
+		m_mesh.Translate(b3Vec3(0.0f, 0.5f * float(N) + 3.0f, 0.0f));
+
+		TetDef def;
+		def.mesh = &m_mesh;
+		def.elementYoungModulus = 1000.0f;
+		def.elementStiffnessDamping = 0.01f;
+
+		m_body = new UniformBody(def);
+
+		b3BoxShape boxShape;
+		boxShape.m_extents.Set(2.0f * float(N), 1.0f, 2.0f * float(N));
+		boxShape.m_radius = 0.2f;
+
+		b3WorldFixtureDef fixtureDef;
+		fixtureDef.shape = &boxShape;
+		fixtureDef.friction = 0.5f;
+
+		m_body->CreateFixture(fixtureDef);
+
+		m_body->SetGravity(b3Vec3(0.0f, -9.8f, 0.0f));
+	}
+
+	GridTetMesh<N, N, N> m_mesh;
+};
+
+// A cloth falling on a sphere.
+template<int N>
+class ClothSphereScene : public Scene
+{
+public:
+	ClothSphereScene()
+	{
+		m_mesh.Translate(b3Vec3(0.0f, 10.0f, 0.0f));
+
+		ClothDef def;
+		def.mesh = &m_mesh;
+		def.thickness = 0.2f;
+		def.friction = 0.8f;
+
+		m_body = new UniformBody(def);
+
+		b3SphereShape sphereShape;
+		sphereShape.m_radius = 0.3f * float(N);
+
+		b3WorldFixtureDef fixtureDef;
+		fixtureDef.shape = &sphereShape;
+		fixtureDef.friction = 0.5f;
+
+		m_body->CreateFixture(fixtureDef);
+
+		m_body->SetGravity(b3Vec3(0.0f, -9.8f, 0.0f));
+	}
+
+	GridClothMesh<N, N> m_mesh;
+};
+
+// A cloth falling on a capsule.
+template<int N>
+class ClothCapsuleScene : public Scene
+{
+public:
+	ClothCapsuleScene()
+	{
+		m_mesh.Translate(b3Vec3(0.0f, 10.0f, 0.0f));
+
+		ClothDef def;
+		def.mesh = &m_mesh;
+		def.thickness = 0.2f;
+		def.friction = 0.4f;
+
+		m_body = new UniformBody(def);
+
+		b3CapsuleShape capsuleShape;
+		capsuleShape.m_center1.Set(0.0f, 0.0f, 0.5f * float(N));
+		capsuleShape.m_center2.Set(0.0f, 0.0f, -0.5f * float(N));
+		capsuleShape.m_radius = 0.2f * float(N);
+
+		b3WorldFixtureDef fixtureDef;
+		fixtureDef.shape = &capsuleShape;
+		fixtureDef.friction = 0.5f;
+
+		m_body->CreateFixture(fixtureDef);
+
+		m_body->SetGravity(b3Vec3(0.0f, -9.8f, 0.0f));
+	}
+
+	GridClothMesh<N, N> m_mesh;
+};
+
+template<class T>
+static Scene* CreateScene()
+{
+	return new T;
+}
+
+struct SceneEntry
+{
+	const char* name;
+	Scene* (*create)();
+};
+
+static const SceneEntry g_scenes[] =
+{
+	{ "pinned_cloth_16", CreateScene< PinnedClothScene<16> > },
+	{ "pinned_cloth_32", CreateScene< PinnedClothScene<32> > },
+	{ "pinned_cloth_64", CreateScene< PinnedClothScene<64> > },
+	{ "tet_box_4", CreateScene< TetBoxScene<4> > },
+	{ "tet_box_8", CreateScene< TetBoxScene<8> > },
+	{ "cloth_sphere_32", CreateScene< ClothSphereScene<32> > },
+	{ "cloth_capsule_32", CreateScene< ClothCapsuleScene<32> > },
+};
+
+static const u32 g_sceneCount = sizeof(g_scenes) / sizeof(SceneEntry);
+
+struct Settings
+{
+	Settings()
+	{
+		steps = 300;
+		warmupSteps = 10;
+		hertz = 60.0f;
+		forceIterations = 1;
+		forceSubIterations = 40;
+		threadCount = 1;
+		json = false;
+		scene = nullptr;
+	}
+
+	u32 steps;
+	u32 warmupSteps;
+	float hertz;
+	u32 forceIterations;
+	u32 forceSubIterations;
+	u32 threadCount;
+	bool json;
+	const char* scene;
+};
+
+struct Result
+{
+	const char* name;
+	u32 particleCount;
+	u32 forceCount;
+	u32 steps;
+	double mean;
+	double p50;
+	double p90;
+	double p99;
+	double max;
+	double iterations;
+	double subIterations;
+	u32 maxSubIterations;
+	u64 peakMemory;
+};
+
+// Nearest-rank percentile of sorted values.
+static double Percentile(const double* sorted, u32 count, double percent)
+{
+	u32 rank = u32(percent / 100.0 * double(count) + 0.5);
+	if (rank < 1)
+	{
+		rank = 1;
+	}
+	if (rank > count)
+	{
+		rank = count;
+	}
+	return sorted[rank - 1];
+}
+
+static Result Run(const SceneEntry& entry, const Settings& settings)
+{
+	Scene* scene = entry.create();
+	UniformBody* body = scene->GetBody();
+
+	body->SetThreadCount(settings.threadCount);
+
+	float dt = 1.0f / settings.hertz;
+
+	for (u32 i = 0; i < settings.warmupSteps; ++i)
+	{
+		body->Step(dt, settings.forceIterations, settings.forceSubIterations);
+	}
+
+	u32 steps = settings.steps > 0 ? settings.steps : 1;
+	double* times = (double*)malloc(steps * sizeof(double));
+
+	double sum = 0.0;
+	u64 iterations = 0;
+	u64 subIterations = 0;
+	u32 maxSubIterations = 0;
+
+	for (u32 i = 0; i < steps; ++i)
+	{
+		b3Timer timer;
+
+		body->Step(dt, settings.forceIterations, settings.forceSubIterations);
+
+		times[i] = timer.GetMilliseconds();
+		sum += times[i];
+
+		const b3SolverStats& stats = body->GetSolverStats();
+		iterations += stats.iterations;
+		subIterations += stats.subIterations;
+		maxSubIterations = b3Max(maxSubIterations, stats.subIterations);
+	}
+
+	std::sort(times, times + steps);
+
+	Result result;
+	result.name = entry.name;
+	result.particleCount = body->GetParticleList().m_count;
+	result.forceCount = body->GetForceList().m_count;
+	result.steps = steps;
+	result.mean = sum / double(steps);
+	result.p50 = Percentile(times, steps, 50.0);
+	result.p90 = Percentile(times, steps, 90.0);
+	result.p99 = Percentile(times, steps, 99.0);
+	result.max = times[steps - 1];
+	result.iterations = double(iterations) / double(steps);
+	result.subIterations = double(subIterations) / double(steps);
+	result.maxSubIterations = maxSubIterations;
+	result.peakMemory = GetPeakMemory();
+
+	free(times);
+	delete scene;
+
+	return result;
+}
+
+static void PrintCSVHeader()
+{
+	printf("scene,particles,forces,steps,mean_ms,p50_ms,p90_ms,p99_ms,max_ms,iterations_per_step,cg_iterations_per_step,max_cg_iterations_per_step,peak_memory_bytes\n");
+}
+
+static void PrintCSV(const Result& r)
+{
+	printf("%s,%u,%u,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.2f,%.2f,%u,%llu\n",
+		r.name, r.particleCount, r.forceCount, r.steps, 
+		r.mean, r.p50, r.p90, r.p99, r.max, 
+		r.iterations, r.subIterations, r.maxSubIterations, r.peakMemory);
+}
+
+static void PrintJSON(const Result& r, bool last)
+{
+	printf("  {\"scene\": \"%s\", \"particles\": %u, \"forces\": %u, \"steps\": %u, "
+		"\"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p90_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f, "
+		"\"iterations_per_step\": %.2f, \"cg_iterations_per_step\": %.2f, \"max_cg_iterations_per_step\": %u, "
+		"\"peak_memory_bytes\": %llu}%s\n",
+		r.name, r.particleCount, r.forceCount, r.steps,
+		r.mean, r.p50, r.p90, r.p99, r.max,
+		r.iterations, r.subIterations, r.maxSubIterations, r.peakMemory, last ? "" : ",");
+}
+
+static void PrintUsage()
+{
+	printf("usage: benchmark [options]\n");
+	printf("  --scene <name>          run a single scene\n");
+	printf("  --list                  list the scenes\n");
+	printf("  --steps <n>             measured steps per scene (default 300)\n");
+	printf("  --warmup <n>            unmeasured steps per scene (default 10)\n");
+	printf("  --hertz <f>             step frequency (default 60)\n");
+	printf("  --iterations <n>        force iterations (default 1)\n");
+	printf("  --sub-iterations <n>    force sub-iterations (default 40)\n");
+	printf("  --threads <n>           force solver threads (default 1)\n");
+	printf("  --format <csv|json>     output format (default csv)\n");
+}
+
+int main(int argc, char** argv)
+{
+	Settings settings;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		if (strcmp(arg, "--list") == 0)
+		{
+			for (u32 j = 0; j < g_sceneCount; ++j)
+			{
+				printf("%s\n", g_scenes[j].name);
+			}
+			return 0;
+		}
+
+		if (value == nullptr)
+		{
+			PrintUsage();
+			return 1;
+		}
+
+		if (strcmp(arg, "--scene") == 0)
+		{
+			settings.scene = value;
+		}
+		else if (strcmp(arg, "--steps") == 0)
+		{
+			settings.steps = atoi(value);
+		}
+		else if (strcmp(arg, "--warmup") == 0)
+		{
+			settings.warmupSteps = atoi(value);
+		}
+		else if (strcmp(arg, "--hertz") == 0)
+		{
+			settings.hertz = float(atof(value));
+		}
+		else if (strcmp(arg, "--iterations") == 0)
+		{
+			settings.forceIterations = atoi(value);
+		}
+		else if (strcmp(arg, "--sub-iterations") == 0)
+		{
+			settings.forceSubIterations = atoi(value);
+		}
+		else if (strcmp(arg, "--threads") == 0)
+		{
+			settings.threadCount = atoi(value);
+		}
+		else if (strcmp(arg, "--format") == 0)
+		{
+			settings.json = strcmp(value, "json") == 0;
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+
+		++i;
+	}
+
+	if (settings.hertz <= 0.0f)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	// Select the scenes.
+	u32 selected[g_sceneCount];
+	u32 selectedCount = 0;
+	for (u32 i = 0; i < g_sceneCount; ++i)
+	{
+		if (settings.scene == nullptr || strcmp(settings.scene, g_scenes[i].name) == 0)
+		{
+			selected[selectedCount++] = i;
+		}
+	}
+
+	if (selectedCount == 0)
+	{
+		fprintf(stderr, "unknown scene: %s\n", settings.scene);
+		return 1;
+	}
+
+	if (settings.json)
+	{
+		printf("[\n");
+	}
+	else
+	{
+		PrintCSVHeader();
+	}
+
+	for (u32 i = 0; i < selectedCount; ++i)
+	{
+		Result result = Run(g_scenes[selected[i]], settings);
+
+		if (settings.json)
+		{
+			PrintJSON(result, i + 1 == selectedCount);
+		}
+		else
+		{
+			PrintCSV(result);
+		}
+
+		fflush(stdout);
+	}
+
+	if (settings.json)
+	{
+		printf("]\n");
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -23,13 +23,17 @@
 
 #include <bounce_softbody/common/settings.h>
 #include <bounce_softbody/common/draw.h>
+#include <bounce_softbody/common/timer.h>
+#include <bounce_softbody/common/profile.h>
 
 #include <bounce_softbody/collision/shapes/sphere_shape.h>
 #include <bounce_softbody/collision/shapes/capsule_shape.h>
 #include <bounce_softbody/collision/shapes/box_shape.h>
 
 #include <bounce_softbody/dynamics/body.h>
+#include <bounce_softbody/dynamics/body_mesh.h>
 #include <bounce_softbody/dynamics/particle.h>
+#include <bounce_softbody/dynamics/solver_stats.h>
 
 #include <bounce_softbody/dynamics/forces/stretch_force.h>
 #include <bounce_softbody/dynamics/forces/shear_force.h>
@@ -36,6 +36,11 @@ public:
 	// Create a proxy. Give it a tight fitting AABB and user pointer.
 	u32 CreateProxy(const b3AABB& aabb, void* userData);
 
+	// Create a proxy for each AABB and write the proxy identifiers.
+	// This builds a balanced subtree top-down, which is much faster than 
+	// creating the proxies one at a time.
+	void CreateProxies(u32* proxyIds, const b3AABB* aabbs, void* const* userData, u32 count);
+
 	// Destroy a given proxy.
 	void DestroyProxy(u32 proxyId);
 
@@ -121,6 +126,13 @@ private:
 
 	// Make a node available for the next allocation.
 	void AddToFreeList(u32 node);
+
+	// Grow the node array to hold at least a given number of nodes.
+	void Reserve(u32 capacity);
+
+	// Build a subtree from a set of leaves by splitting them at the median of their centers. 
+	// Return the subtree root.
+	u32 BuildSubtree(u32* leaves, b3Vec3* centers, u32 count);
 	
 	// Balance the tree.
 	u32 Balance(u32 index);
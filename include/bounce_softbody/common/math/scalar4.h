@@ -0,0 +1,341 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_SCALAR4_H
+#define B3_SCALAR4_H
+
+#include <bounce_softbody/common/math/simd.h>
+
+// Four scalars processed in parallel. 
+// This maps to a SSE register if available and to four scalars otherwise.
+// The lanes are computed with the same operations as scalar code, so each lane rounds 
+// as the equivalent scalar expression.
+struct b3Scalar4
+{
+	b3Scalar4() { }
+
+	// Broadcast a scalar to all lanes.
+	explicit b3Scalar4(scalar s)
+	{
+#if defined(B3_SIMD_SSE)
+		v = _mm_set1_ps(s);
+#else
+		v[0] = v[1] = v[2] = v[3] = s;
+#endif
+	}
+
+	b3Scalar4(scalar a, scalar b, scalar c, scalar d)
+	{
+#if defined(B3_SIMD_SSE)
+		v = _mm_setr_ps(a, b, c, d);
+#else
+		v[0] = a; v[1] = b; v[2] = c; v[3] = d;
+#endif
+	}
+
+	// Load four consecutive scalars.
+	static b3Scalar4 Load(const scalar* p)
+	{
+		b3Scalar4 r;
+#if defined(B3_SIMD_SSE)
+		r.v = _mm_loadu_ps(p);
+#else
+		r.v[0] = p[0]; r.v[1] = p[1]; r.v[2] = p[2]; r.v[3] = p[3];
+#endif
+		return r;
+	}
+
+	// Store four consecutive scalars.
+	void Store(scalar* p) const
+	{
+#if defined(B3_SIMD_SSE)
+		_mm_storeu_ps(p, v);
+#else
+		p[0] = v[0]; p[1] = v[1]; p[2] = v[2]; p[3] = v[3];
+#endif
+	}
+
+#if defined(B3_SIMD_SSE)
+	__m128 v;
+#else
+	scalar v[4];
+#endif
+};
+
+// A comparison result of four lanes.
+struct b3Bool4
+{
+	b3Bool4() { }
+
+	// Broadcast a value to all lanes.
+	explicit b3Bool4(bool b)
+	{
+#if defined(B3_SIMD_SSE)
+		v = _mm_castsi128_ps(_mm_set1_epi32(b ? -1 : 0));
+#else
+		v[0] = v[1] = v[2] = v[3] = b;
+#endif
+	}
+
+	// Return a bit for each lane that is true.
+	u32 GetBits() const
+	{
+#if defined(B3_SIMD_SSE)
+		return u32(_mm_movemask_ps(v));
+#else
+		return u32(v[0]) | (u32(v[1]) << 1) | (u32(v[2]) << 2) | (u32(v[3]) << 3);
+#endif
+	}
+
+#if defined(B3_SIMD_SSE)
+	__m128 v;
+#else
+	bool v[4];
+#endif
+};
+
+#if defined(B3_SIMD_SSE)
+
+inline b3Scalar4 b3MakeScalar4(__m128 v)
+{
+	b3Scalar4 r;
+	r.v = v;
+	return r;
+}
+
+inline b3Bool4 b3MakeBool4(__m128 v)
+{
+	b3Bool4 r;
+	r.v = v;
+	return r;
+}
+
+inline b3Scalar4 operator+(const b3Scalar4& a, const b3Scalar4& b) { return b3MakeScalar4(_mm_add_ps(a.v, b.v)); }
+inline b3Scalar4 operator-(const b3Scalar4& a, const b3Scalar4& b) { return b3MakeScalar4(_mm_sub_ps(a.v, b.v)); }
+inline b3Scalar4 operator*(const b3Scalar4& a, const b3Scalar4& b) { return b3MakeScalar4(_mm_mul_ps(a.v, b.v)); }
+inline b3Scalar4 operator/(const b3Scalar4& a, const b3Scalar4& b) { return b3MakeScalar4(_mm_div_ps(a.v, b.v)); }
+inline b3Scalar4 operator-(const b3Scalar4& a) { return b3MakeScalar4(_mm_xor_ps(a.v, _mm_set1_ps(-0.0f))); }
+
+inline b3Bool4 operator>(const b3Scalar4& a, const b3Scalar4& b) { return b3MakeBool4(_mm_cmpgt_ps(a.v, b.v)); }
+inline b3Bool4 operator>=(const b3Scalar4& a, const b3Scalar4& b) { return b3MakeBool4(_mm_cmpge_ps(a.v, b.v)); }
+inline b3Bool4 operator&(const b3Bool4& a, const b3Bool4& b) { return b3MakeBool4(_mm_and_ps(a.v, b.v)); }
+inline b3Bool4 operator|(const b3Bool4& a, const b3Bool4& b) { return b3MakeBool4(_mm_or_ps(a.v, b.v)); }
+
+inline b3Scalar4 b3Sqrt(const b3Scalar4& a) { return b3MakeScalar4(_mm_sqrt_ps(a.v)); }
+inline b3Scalar4 b3Abs(const b3Scalar4& a) { return b3MakeScalar4(_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)); }
+
+// Return a if the condition is true and b otherwise in each lane.
+inline b3Scalar4 b3Select(const b3Bool4& condition, const b3Scalar4& a, const b3Scalar4& b)
+{
+	return b3MakeScalar4(_mm_or_ps(_mm_and_ps(condition.v, a.v), _mm_andnot_ps(condition.v, b.v)));
+}
+
+#else
+
+#define B3_SCALAR4_OPERATOR(op) \
+	inline b3Scalar4 operator op(const b3Scalar4& a, const b3Scalar4& b) \
+	{ \
+		return b3Scalar4(a.v[0] op b.v[0], a.v[1] op b.v[1], a.v[2] op b.v[2], a.v[3] op b.v[3]); \
+	}
+
+B3_SCALAR4_OPERATOR(+)
+B3_SCALAR4_OPERATOR(-)
+B3_SCALAR4_OPERATOR(*)
+B3_SCALAR4_OPERATOR(/)
+
+#undef B3_SCALAR4_OPERATOR
+
+inline b3Scalar4 operator-(const b3Scalar4& a) { return b3Scalar4(-a.v[0], -a.v[1], -a.v[2], -a.v[3]); }
+
+inline b3Bool4 operator>(const b3Scalar4& a, const b3Scalar4& b)
+{
+	b3Bool4 r;
+	for (u32 i = 0; i < 4; ++i)
+	{
+		r.v[i] = a.v[i] > b.v[i];
+	}
+	return r;
+}
+
+inline b3Bool4 operator>=(const b3Scalar4& a, const b3Scalar4& b)
+{
+	b3Bool4 r;
+	for (u32 i = 0; i < 4; ++i)
+	{
+		r.v[i] = a.v[i] >= b.v[i];
+	}
+	return r;
+}
+
+inline b3Bool4 operator&(const b3Bool4& a, const b3Bool4& b)
+{
+	b3Bool4 r;
+	for (u32 i = 0; i < 4; ++i)
+	{
+		r.v[i] = a.v[i] && b.v[i];
+	}
+	return r;
+}
+
+inline b3Bool4 operator|(const b3Bool4& a, const b3Bool4& b)
+{
+	b3Bool4 r;
+	for (u32 i = 0; i < 4; ++i)
+	{
+		r.v[i] = a.v[i] || b.v[i];
+	}
+	return r;
+}
+
+inline b3Scalar4 b3Sqrt(const b3Scalar4& a) 
+{ 
+	return b3Scalar4(b3Sqrt(a.v[0]), b3Sqrt(a.v[1]), b3Sqrt(a.v[2]), b3Sqrt(a.v[3])); 
+}
+
+inline b3Scalar4 b3Abs(const b3Scalar4& a) 
+{ 
+	return b3Scalar4(b3Abs(a.v[0]), b3Abs(a.v[1]), b3Abs(a.v[2]), b3Abs(a.v[3])); 
+}
+
+// Return a if the condition is true and b otherwise in each lane.
+inline b3Scalar4 b3Select(const b3Bool4& condition, const b3Scalar4& a, const b3Scalar4& b)
+{
+	b3Scalar4 r;
+	for (u32 i = 0; i < 4; ++i)
+	{
+		r.v[i] = condition.v[i] ? a.v[i] : b.v[i];
+	}
+	return r;
+}
+
+#endif
+
+// Four 3D vectors stored by component.
+struct b3Vec3x4
+{
+	b3Vec3x4() { }
+
+	b3Vec3x4(const b3Scalar4& _x, const b3Scalar4& _y, const b3Scalar4& _z) : x(_x), y(_y), z(_z) { }
+
+	// Gather four vectors.
+	b3Vec3x4(const b3Vec3& a, const b3Vec3& b, const b3Vec3& c, const b3Vec3& d) :
+		x(a.x, b.x, c.x, d.x), 
+		y(a.y, b.y, c.y, d.y), 
+		z(a.z, b.z, c.z, d.z)
+	{
+	}
+
+	b3Scalar4 x, y, z;
+};
+
+inline b3Vec3x4 operator+(const b3Vec3x4& a, const b3Vec3x4& b)
+{
+	return b3Vec3x4(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+
+inline b3Vec3x4 operator-(const b3Vec3x4& a, const b3Vec3x4& b)
+{
+	return b3Vec3x4(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+inline b3Vec3x4 operator*(const b3Scalar4& s, const b3Vec3x4& v)
+{
+	return b3Vec3x4(s * v.x, s * v.y, s * v.z);
+}
+
+inline b3Scalar4 b3Dot(const b3Vec3x4& a, const b3Vec3x4& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline b3Vec3x4 b3Cross(const b3Vec3x4& a, const b3Vec3x4& b)
+{
+	return b3Vec3x4(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+inline b3Scalar4 b3Length(const b3Vec3x4& v)
+{
+	return b3Sqrt(b3Dot(v, v));
+}
+
+// Return a if the condition is true and b otherwise in each lane.
+inline b3Vec3x4 b3Select(const b3Bool4& condition, const b3Vec3x4& a, const b3Vec3x4& b)
+{
+	return b3Vec3x4(b3Select(condition, a.x, b.x), b3Select(condition, a.y, b.y), b3Select(condition, a.z, b.z));
+}
+
+// Four 3x3 matrices stored by component.
+struct b3Mat33x4
+{
+	b3Mat33x4() { }
+
+	b3Mat33x4(const b3Vec3x4& _x, const b3Vec3x4& _y, const b3Vec3x4& _z) : x(_x), y(_y), z(_z) { }
+
+	// Gather four matrices.
+	explicit b3Mat33x4(const b3Mat33 A[4]) :
+		x(A[0].x, A[1].x, A[2].x, A[3].x),
+		y(A[0].y, A[1].y, A[2].y, A[3].y),
+		z(A[0].z, A[1].z, A[2].z, A[3].z)
+	{
+	}
+
+	// Scatter the four matrices.
+	void Store(b3Mat33 A[4]) const
+	{
+		const b3Scalar4* c = &x.x;
+
+		scalar lanes[9][4];
+		for (u32 i = 0; i < 9; ++i)
+		{
+			c[i].Store(lanes[i]);
+		}
+
+		for (u32 l = 0; l < 4; ++l)
+		{
+			scalar* a = &A[l].x.x;
+			for (u32 i = 0; i < 9; ++i)
+			{
+				a[i] = lanes[i][l];
+			}
+		}
+	}
+
+	b3Vec3x4 x, y, z;
+};
+
+// Multiply a matrix times a vector. This matches the scalar operator in each lane.
+inline b3Vec3x4 operator*(const b3Mat33x4& A, const b3Vec3x4& v)
+{
+	return v.x * A.x + v.y * A.y + v.z * A.z;
+}
+
+// Multiply two matrices.
+inline b3Mat33x4 operator*(const b3Mat33x4& A, const b3Mat33x4& B)
+{
+	return b3Mat33x4(A * B.x, A * B.y, A * B.z);
+}
+
+inline b3Mat33x4 b3Transpose(const b3Mat33x4& A)
+{
+	return b3Mat33x4(
+		b3Vec3x4(A.x.x, A.y.x, A.z.x),
+		b3Vec3x4(A.x.y, A.y.y, A.z.y),
+		b3Vec3x4(A.x.z, A.y.z, A.z.z));
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,104 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_SIMD_H
+#define B3_SIMD_H
+
+#include <bounce_softbody/common/math/mat33.h>
+
+// The instruction set is selected at compile time from the compiler flags.
+// Define B3_NO_SIMD to force the scalar code paths.
+#if !defined(B3_NO_SIMD)
+	#if defined(__AVX2__)
+		#define B3_SIMD_AVX2
+		#define B3_SIMD_SSE
+		#include <immintrin.h>
+	#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define B3_SIMD_SSE
+		#include <emmintrin.h>
+	#endif
+#endif
+
+// The number of scalars allocated after an array of 3x3 blocks.
+// This allows loading the last column of the last block with a 4-wide load.
+#define B3_BLOCK_PADDING 1
+
+// Return the number of bytes for an array of 3x3 blocks including the padding.
+inline u32 b3GetBlockArraySize(u32 count)
+{
+	return count * sizeof(b3Mat33) + B3_BLOCK_PADDING * sizeof(scalar);
+}
+
+#if defined(B3_SIMD_SSE)
+
+// Compute A * v in the first three lanes.
+// The block must be followed by at least one scalar in memory.
+inline __m128 b3Mul4(const b3Mat33& A, const b3Vec3& v)
+{
+	const scalar* a = &A.x.x;
+
+	__m128 x = _mm_mul_ps(_mm_loadu_ps(a), _mm_set1_ps(v.x));
+	__m128 y = _mm_mul_ps(_mm_loadu_ps(a + 3), _mm_set1_ps(v.y));
+	__m128 z = _mm_mul_ps(_mm_loadu_ps(a + 6), _mm_set1_ps(v.z));
+
+	return _mm_add_ps(_mm_add_ps(x, y), z);
+}
+
+// Store the first three lanes.
+inline void b3Store3(b3Vec3& out, __m128 v)
+{
+	scalar a[4];
+	_mm_storeu_ps(a, v);
+	out.Set(a[0], a[1], a[2]);
+}
+
+#endif
+
+#if defined(B3_SIMD_AVX2)
+
+// Compute A1 * v1 in the lower half and A2 * v2 in the upper half.
+// The blocks must be followed by at least one scalar in memory.
+inline __m256 b3Mul8(const b3Mat33& A1, const b3Vec3& v1, const b3Mat33& A2, const b3Vec3& v2)
+{
+	const scalar* a1 = &A1.x.x;
+	const scalar* a2 = &A2.x.x;
+
+	__m256 cx = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a1)), _mm_loadu_ps(a2), 1);
+	__m256 cy = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a1 + 3)), _mm_loadu_ps(a2 + 3), 1);
+	__m256 cz = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a1 + 6)), _mm_loadu_ps(a2 + 6), 1);
+
+	__m256 vx = _mm256_insertf128_ps(_mm256_set1_ps(v1.x), _mm_set1_ps(v2.x), 1);
+	__m256 vy = _mm256_insertf128_ps(_mm256_set1_ps(v1.y), _mm_set1_ps(v2.y), 1);
+	__m256 vz = _mm256_insertf128_ps(_mm256_set1_ps(v1.z), _mm_set1_ps(v2.z), 1);
+
+#if defined(__FMA__)
+	return _mm256_fmadd_ps(cz, vz, _mm256_fmadd_ps(cy, vy, _mm256_mul_ps(cx, vx)));
+#else
+	return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, vx), _mm256_mul_ps(cy, vy)), _mm256_mul_ps(cz, vz));
+#endif
+}
+
+// Add the lower and upper halves.
+inline __m128 b3AddHalves(__m256 v)
+{
+	return _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+}
+
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,138 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef B3_PROFILE_H
+#define B3_PROFILE_H
+
+#include <bounce_softbody/common/settings.h>
+#include <stdio.h>
+
+// The phases of a time step are timed only if B3_ENABLE_PROFILE is defined.
+// Otherwise the profile macros compile to nothing.
+
+// The maximum number of events recorded per time step.
+#define B3_MAX_PROFILE_EVENTS 256
+
+// A timed phase. 
+// Times are in milliseconds relative to the beginning of the time step.
+struct b3ProfileEvent
+{
+	const char* name;
+	scalar64 begin;
+	scalar64 duration;
+};
+
+// The phase times of a time step in milliseconds.
+// Phases executed in every force iteration are accumulated.
+struct b3Profile
+{
+	b3Profile()
+	{
+		Reset(0.0);
+	}
+
+	// Clear the times and the events. 
+	// The beginning of the time step is given by b3GetTime.
+	void Reset(scalar64 time)
+	{
+		step = 0.0;
+		updateContacts = 0.0;
+		clearForces = 0.0;
+		gather = 0.0;
+		forces = 0.0;
+		matrix = 0.0;
+		linearSolve = 0.0;
+		scatter = 0.0;
+		friction = 0.0;
+		synchronize = 0.0;
+		findContacts = 0.0;
+		begin = time;
+		eventCount = 0;
+	}
+
+	scalar64 step; // the whole time step
+	scalar64 updateContacts; // updating contacts
+	scalar64 clearForces; // clearing internal forces
+	scalar64 gather; // building the sparsity pattern and the mass matrices from the particle state
+	scalar64 forces; // computing forces and Jacobians
+	scalar64 matrix; // building the filtered linear systems
+	scalar64 linearSolve; // solving the linear systems
+	scalar64 scatter; // copying the force solver state to the body arrays
+	scalar64 friction; // solving friction
+	scalar64 synchronize; // synchronizing triangles and moving their tree proxies
+	scalar64 findContacts; // finding new contacts
+
+	scalar64 begin; // beginning of the time step given by b3GetTime
+	u32 eventCount;
+	b3ProfileEvent events[B3_MAX_PROFILE_EVENTS];
+};
+
+// Time a scope and record it in a profile. The profile can be null.
+class b3ProfileScope
+{
+public:
+	b3ProfileScope(b3Profile* profile, scalar64* time, const char* name);
+	~b3ProfileScope();
+private:
+	b3Profile* m_profile;
+	scalar64* m_time;
+	const char* m_name;
+	scalar64 m_begin;
+};
+
+#if defined(B3_ENABLE_PROFILE)
+
+#define B3_PROFILE_JOIN2(a, b) a##b
+#define B3_PROFILE_JOIN(a, b) B3_PROFILE_JOIN2(a, b)
+
+// Time the enclosing scope as a phase of a given profile.
+#define B3_PROFILE(profile, phase, name) b3ProfileScope B3_PROFILE_JOIN(b3_profileScope, __LINE__)(profile, (profile) ? &(profile)->phase : nullptr, name)
+
+#else
+
+#define B3_PROFILE(profile, phase, name)
+
+#endif
+
+// Write time step profiles as a Chrome trace (JSON) for chrome://tracing or Perfetto.
+class b3ChromeTraceWriter
+{
+public:
+	b3ChromeTraceWriter();
+	~b3ChromeTraceWriter();
+
+	// Create a trace file. Return true if the file could be created.
+	bool Open(const char* path);
+
+	// Write the events of a time step. 
+	// The profiles of multiple bodies or time steps can be written to the same trace.
+	// The thread id allows to display each body in its own row.
+	void Write(const b3Profile& profile, u32 threadId = 0);
+
+	// Finish and close the trace file.
+	void Close();
+
+	// Is the trace file open?
+	bool IsOpen() const;
+private:
+	FILE* m_file;
+	u32 m_eventCount;
+};
+
+#endif
\ No newline at end of file
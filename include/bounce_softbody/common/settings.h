@@ -112,6 +112,10 @@ void* b3Alloc(u32 size);
 // You must implement this function if you have implemented b3Alloc.
 void b3Free(void* block);
 
+// The number of b3Alloc calls made by the calling thread. 
+// b3Alloc should increment this counter.
+extern thread_local u32 b3_threadAllocCalls;
+
 // You should implement this function to visualize log messages coming 
 // from this software.
 void b3Log(const char* string, ...);
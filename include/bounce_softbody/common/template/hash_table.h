@@ -0,0 +1,225 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_HASH_TABLE_H
+#define B3_HASH_TABLE_H
+
+#include <bounce_softbody/common/settings.h>
+
+// A hash table of objects keyed by N pointers. 
+// The order of the pointers in a key doesn't matter.
+// This uses open addressing with linear probing. Find, insert and remove take constant time on average.
+template <typename T, u32 N>
+class b3HashTable
+{
+public:
+	b3HashTable()
+	{
+		m_capacity = 0;
+		m_count = 0;
+		m_entries = nullptr;
+	}
+
+	~b3HashTable()
+	{
+		if (m_entries)
+		{
+			b3Free(m_entries);
+		}
+	}
+
+	// Find the object with a given key. Return nullptr if the key is not in the table.
+	T* Find(const void* const key[N]) const
+	{
+		if (m_count == 0)
+		{
+			return nullptr;
+		}
+
+		b3Entry entry;
+		SetKey(entry, key);
+		
+		return m_entries[FindIndex(entry)].value;
+	}
+
+	// Insert an object. The key must not be in the table.
+	void Insert(const void* const key[N], T* value)
+	{
+		B3_ASSERT(value != nullptr);
+
+		// Keep the load factor below one half.
+		if (2 * (m_count + 1) > m_capacity)
+		{
+			Grow();
+		}
+
+		b3Entry entry;
+		SetKey(entry, key);
+		entry.value = value;
+
+		u32 index = FindIndex(entry);
+		B3_ASSERT(m_entries[index].value == nullptr);
+		
+		m_entries[index] = entry;
+		++m_count;
+	}
+
+	// Remove the object with a given key. The key must be in the table.
+	void Remove(const void* const key[N])
+	{
+		b3Entry entry;
+		SetKey(entry, key);
+
+		u32 i = FindIndex(entry);
+		B3_ASSERT(m_entries[i].value != nullptr);
+
+		// Shift the following entries of the cluster back so the probe sequences stay unbroken.
+		u32 mask = m_capacity - 1;
+		u32 j = i;
+		for (;;)
+		{
+			j = (j + 1) & mask;
+
+			if (m_entries[j].value == nullptr)
+			{
+				break;
+			}
+
+			// Skip the entry if its home slot is cyclically in (i, j].
+			u32 k = m_entries[j].hash & mask;
+			bool inRange = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+			if (inRange)
+			{
+				continue;
+			}
+
+			m_entries[i] = m_entries[j];
+			i = j;
+		}
+
+		m_entries[i].value = nullptr;
+		--m_count;
+	}
+
+	// Get the number of objects in the table.
+	u32 Count() const
+	{
+		return m_count;
+	}
+private:
+	struct b3Entry
+	{
+		const void* key[N]; // sorted key
+		u32 hash;
+		T* value; // null if the slot is empty
+	};
+
+	// Sort the key and compute its hash.
+	static void SetKey(b3Entry& entry, const void* const key[N])
+	{
+		for (u32 i = 0; i < N; ++i)
+		{
+			entry.key[i] = key[i];
+		}
+
+		// Insertion sort
+		for (u32 i = 1; i < N; ++i)
+		{
+			const void* p = entry.key[i];
+			
+			u32 j = i;
+			while (j > 0 && size_t(entry.key[j - 1]) > size_t(p))
+			{
+				entry.key[j] = entry.key[j - 1];
+				--j;
+			}
+
+			entry.key[j] = p;
+		}
+
+		u64 hash = 0;
+		for (u32 i = 0; i < N; ++i)
+		{
+			// 64-bit finalizer of MurmurHash3
+			u64 x = u64(size_t(entry.key[i]));
+			x ^= x >> 33;
+			x *= 0xff51afd7ed558ccdULL;
+			x ^= x >> 33;
+
+			hash = (hash ^ x) * 0x9e3779b97f4a7c15ULL;
+		}
+
+		entry.hash = u32(hash >> 32);
+	}
+
+	// Return the slot holding a key or the empty slot where the key would be inserted.
+	u32 FindIndex(const b3Entry& entry) const
+	{
+		u32 mask = m_capacity - 1;
+		u32 index = entry.hash & mask;
+		for (;;)
+		{
+			const b3Entry& slot = m_entries[index];
+			
+			if (slot.value == nullptr)
+			{
+				return index;
+			}
+
+			if (slot.hash == entry.hash && memcmp(slot.key, entry.key, sizeof(entry.key)) == 0)
+			{
+				return index;
+			}
+
+			index = (index + 1) & mask;
+		}
+	}
+
+	// Double the capacity and reinsert the objects.
+	void Grow()
+	{
+		u32 oldCapacity = m_capacity;
+		b3Entry* oldEntries = m_entries;
+
+		m_capacity = oldCapacity > 0 ? 2 * oldCapacity : 64;
+		m_entries = (b3Entry*)b3Alloc(m_capacity * sizeof(b3Entry));
+		for (u32 i = 0; i < m_capacity; ++i)
+		{
+			m_entries[i].value = nullptr;
+		}
+
+		for (u32 i = 0; i < oldCapacity; ++i)
+		{
+			if (oldEntries[i].value)
+			{
+				m_entries[FindIndex(oldEntries[i])] = oldEntries[i];
+			}
+		}
+
+		if (oldEntries)
+		{
+			b3Free(oldEntries);
+		}
+	}
+
+	u32 m_capacity; // power of two
+	u32 m_count;
+	b3Entry* m_entries;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,116 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_THREAD_POOL_H
+#define B3_THREAD_POOL_H
+
+#include <bounce_softbody/common/math/math.h>
+
+// A task executed by the thread pool over a range of indices.
+class b3ThreadTask
+{
+public:
+	// Execute the task for the indices [begin, end) of a given chunk.
+	virtual void Execute(u32 chunk, u32 begin, u32 end) = 0;
+};
+
+struct b3ThreadPoolData;
+
+// A pool of worker threads. The calling thread also executes tasks.
+// Work is split into chunks whose boundaries depend only on the number
+// of indices and the chunk size, never on the number of threads.
+// Therefore, tasks that write per-chunk results are deterministic.
+class b3ThreadPool
+{
+public:
+	b3ThreadPool();
+	~b3ThreadPool();
+
+	// Set the number of threads including the calling thread.
+	// One thread means that all tasks are executed by the calling thread.
+	void SetThreadCount(u32 count);
+
+	// Get the number of threads including the calling thread.
+	u32 GetThreadCount() const;
+
+	// Execute a task for the indices [0, count) split into chunks of a given size.
+	// This function returns when all chunks have been executed.
+	void Execute(b3ThreadTask* task, u32 count, u32 chunkSize);
+private:
+	friend struct b3ThreadPoolData;
+
+	// Execute chunks until there are no chunks left.
+	void ExecuteChunks();
+
+	// Worker thread entry point. 
+	// The worker waits for the first job after the given generation.
+	void WorkerMain(u32 generation);
+
+	u32 m_threadCount;
+	b3ThreadPoolData* m_data;
+
+	// Current job
+	b3ThreadTask* m_task;
+	u32 m_count;
+	u32 m_chunkSize;
+	u32 m_chunkCount;
+};
+
+// Return the number of chunks for executing a given number of indices.
+inline u32 b3GetChunkCount(u32 count, u32 chunkSize)
+{
+	B3_ASSERT(chunkSize > 0);
+	return (count + chunkSize - 1) / chunkSize;
+}
+
+// Execute a task with a thread pool or serially if there is no pool.
+inline void b3Execute(b3ThreadPool* pool, b3ThreadTask* task, u32 count, u32 chunkSize)
+{
+	if (pool)
+	{
+		pool->Execute(task, count, chunkSize);
+		return;
+	}
+
+	u32 chunkCount = b3GetChunkCount(count, chunkSize);
+	for (u32 i = 0; i < chunkCount; ++i)
+	{
+		u32 begin = i * chunkSize;
+		u32 end = b3Min(begin + chunkSize, count);
+		task->Execute(i, begin, end);
+	}
+}
+
+// Sum values in a fixed pairwise order.
+inline scalar b3PairwiseSum(const scalar* values, u32 count)
+{
+	if (count == 0)
+	{
+		return scalar(0);
+	}
+
+	if (count == 1)
+	{
+		return values[0];
+	}
+
+	u32 half = count / 2;
+	return b3PairwiseSum(values, half) + b3PairwiseSum(values + half, count - half);
+}
+
+#endif
\ No newline at end of file
@@ -21,9 +21,14 @@
 
 #include <bounce_softbody/common/memory/stack_allocator.h>
 #include <bounce_softbody/common/memory/block_allocator.h>
+#include <bounce_softbody/common/thread/thread_pool.h>
+#include <bounce_softbody/common/profile.h>
 #include <bounce_softbody/common/template/list.h>
+#include <bounce_softbody/common/template/hash_table.h>
 #include <bounce_softbody/collision/trees/dynamic_tree.h>
 #include <bounce_softbody/dynamics/contact_manager.h>
+#include <bounce_softbody/dynamics/force_solver.h>
+#include <bounce_softbody/dynamics/particle_storage.h>
 
 class b3Draw;
 
@@ -45,6 +50,9 @@ class b3TetrahedronFixture;
 struct b3WorldFixtureDef;
 class b3WorldFixture;
 
+struct b3BodyMeshDef;
+class b3BodyMesh;
+
 struct b3RayCastInput;
 struct b3RayCastOutput;
 
@@ -84,6 +92,7 @@ public:
 	const b3List<b3Force>& GetForceList() const;
 
 	// Create a sphere fixture.
+	// If the particle already has a sphere then the existing fixture is returned.
 	b3SphereFixture* CreateSphere(const b3SphereFixtureDef& def);
 
 	// Destroy a given sphere fixture.
@@ -93,6 +102,7 @@ public:
 	const b3List<b3SphereFixture>& GetSphereList() const;
 	
 	// Create a triangle fixture.
+	// If a triangle with the same particles exists then it is returned. The order of the particles doesn't matter.
 	b3TriangleFixture* CreateTriangle(const b3TriangleFixtureDef& def);
 
 	// Destroy a given triangle fixture.
@@ -102,6 +112,7 @@ public:
 	const b3List<b3TriangleFixture>& GetTriangleList() const;
 
 	// Create a tetrahedron fixture.
+	// If a tetrahedron with the same particles exists then it is returned. The order of the particles doesn't matter.
 	b3TetrahedronFixture* CreateTetrahedron(const b3TetrahedronFixtureDef& def);
 
 	// Destroy a given tetrahedron fixture.
@@ -110,6 +121,23 @@ public:
 	// Return the list of tetrahedrons in this body.
 	const b3List<b3TetrahedronFixture>& GetTetrahedronList() const;
 
+	// Create the particles, fixtures and forces of a mesh in one pass. 
+	// This is much faster than creating the objects one at a time.
+	// Return nullptr if an element references an invalid vertex or if an element is repeated.
+	b3BodyMesh* CreateMesh(const b3BodyMeshDef& def);
+
+	// Destroy a given mesh. This destroys the remaining particles of the mesh 
+	// and the objects attached to them.
+	void DestroyMesh(b3BodyMesh* mesh);
+
+	// Return the list of meshes in this body.
+	const b3List<b3BodyMesh>& GetMeshList() const;
+
+	// Recompute the particle masses from the triangle and tetrahedron densities.
+	// Creating or destroying a fixture updates the masses of its particles only, 
+	// so call this after changing fixture densities.
+	void ResetMass();
+
 	// Create a new world fixture.
 	b3WorldFixture* CreateFixture(const b3WorldFixtureDef& def);
 
@@ -125,6 +153,60 @@ public:
 	// Get the acceleration of gravity.
 	b3Vec3 GetGravity() const;
 
+	// Enable/disable matrix-free products in the force solver. 
+	// This avoids storing the system matrix, which saves memory for large bodies, 
+	// at the cost of evaluating both Jacobians on every product.
+	void SetMatrixFree(bool flag);
+
+	// Are matrix-free products enabled?
+	bool GetMatrixFree() const;
+
+	// Enable/disable warm starting. The force sub-solver starts from the 
+	// velocity change of the last step. This is disabled by default.
+	void SetWarmStart(bool flag);
+
+	// Is warm starting enabled?
+	bool GetWarmStart() const;
+
+	// Enable/disable the comparison of warm starting with a cold start. 
+	// This solves the first sub-problem of each step twice for counting 
+	// the saved sub-iterations, so it should only be enabled for debugging.
+	void SetCompareColdStart(bool flag);
+
+	// Is the comparison with a cold start enabled?
+	bool GetCompareColdStart() const;
+
+	// Enable/disable the adaptive sub-solver tolerance. The early force iterations 
+	// are solved inexactly while the error is large. This only has an effect 
+	// for more than one force iteration. This is disabled by default.
+	void SetAdaptiveSubTolerance(bool flag);
+
+	// Is the adaptive sub-solver tolerance enabled?
+	bool GetAdaptiveSubTolerance() const;
+
+	// Set the linear solver of the force solver.
+	// The LDLT solver computes exact Newton steps. It is usually faster than CG for 
+	// small and medium bodies but the factorization fills in as the body grows.
+	void SetLinearSolver(b3LinearSolverType type);
+
+	// Get the linear solver of the force solver.
+	b3LinearSolverType GetLinearSolver() const;
+
+	// Set the preconditioner of the force sub-solver.
+	// The block Jacobi preconditioner inverts the full 3x3 diagonal blocks, 
+	// which usually reduces the number of sub-iterations for stiff bodies.
+	void SetPreconditioner(b3PreconditionerType type);
+
+	// Get the preconditioner of the force sub-solver.
+	b3PreconditionerType GetPreconditioner() const;
+
+	// Set the number of threads used by the force solver, including the calling thread.
+	// The default is one thread. Results don't depend on the number of threads.
+	void SetThreadCount(u32 count);
+
+	// Get the number of threads used by the force solver.
+	u32 GetThreadCount() const;
+
 	// Perform a time step given the number of force solver iterations. 
 	// Use 1 force iteration for reasonable performance. 
 	void Step(scalar dt, u32 forceIterations, u32 forceSubIterations);
@@ -135,6 +217,13 @@ public:
 	// Return the kinetic energy in this system.
 	scalar GetEnergy() const;
 
+	// Get the solver statistics of the last time step.
+	const b3SolverStats& GetSolverStats() const;
+
+	// Get the phase times of the last time step. 
+	// These are only recorded if B3_ENABLE_PROFILE is defined.
+	const b3Profile& GetProfile() const;
+
 	// Debug draw the body entities.
 	void Draw(b3Draw* draw) const;
 protected:
@@ -144,25 +233,58 @@ protected:
 	friend class b3TetrahedronFixture;
 	friend class b3WorldFixture;
 	friend class b3ContactManager;
-	
-	// Rest the mass data of the body.
-	void ResetMass();
 
 	// Solve
 	void Solve(const b3TimeStep& step);
 
+	// Add a created object to the body and particle lists.
+	// The tree proxy of a triangle is created by the caller.
+	void AddParticle(b3Particle* particle);
+	void AddSphere(b3SphereFixture* fixture);
+	void AddTriangle(b3TriangleFixture* fixture);
+	void AddTetrahedron(b3TetrahedronFixture* fixture);
+	void AddForce(b3Force* force);
+
+	// Free the memory of a destroyed object. 
+	// The memory of mesh objects is freed with the mesh.
+	void Free(void* memory, u32 size, const b3BodyMesh* mesh);
+
 	// Stack allocator
 	b3StackAllocator m_stackAllocator;
 
 	// Block allocator
 	b3BlockAllocator m_blockAllocator;
 
+	// Force solver worker threads
+	b3ThreadPool m_threadPool;
+
 	// Gravity acceleration
 	b3Vec3 m_gravity;
 
+	// Force solver matrix-free mode
+	bool m_matrixFree;
+
+	// Force solver warm starting
+	bool m_warmStart;
+
+	// Force solver warm starting comparison
+	bool m_compareColdStart;
+
+	// Force solver adaptive sub-solver tolerance
+	bool m_adaptiveSubTolerance;
+
+	// Force solver linear solver
+	b3LinearSolverType m_linearSolver;
+
+	// Force sub-solver preconditioner
+	b3PreconditionerType m_preconditioner;
+
 	// List of particles
 	b3List<b3Particle> m_particleList;
 
+	// Particle state indexed by the particle solver identifiers
+	b3ParticleStorage m_particleStorage;
+
 	// List of forces
 	b3List<b3Force> m_forceList;
 
@@ -174,7 +296,16 @@ protected:
 	
 	// List of tetrahedrons
 	b3List<b3TetrahedronFixture> m_tetrahedronList;
+
+	// Fixtures indexed by their particles. 
+	// These find duplicate fixtures without scanning the lists.
+	b3HashTable<b3SphereFixture, 1> m_sphereTable;
+	b3HashTable<b3TriangleFixture, 3> m_triangleTable;
+	b3HashTable<b3TetrahedronFixture, 4> m_tetrahedronTable;
 	
+	// List of meshes
+	b3List<b3BodyMesh> m_meshList;
+
 	// List of world fixtures
 	b3List<b3WorldFixture> m_fixtureList;
 
@@ -183,6 +314,21 @@ protected:
 
 	// Dynamic tree.
 	b3DynamicTree m_tree;
+
+	// Incremented when particles or forces are created or destroyed.
+	u32 m_topologyVersion;
+
+	// Solver matrices kept across time steps.
+	b3ForceSolverCache m_solverCache;
+
+	// The topology version of the sparsity pattern in the solver cache.
+	u32 m_solverCacheVersion;
+
+	// Solver statistics of the last time step.
+	b3SolverStats m_stats;
+
+	// Phase times of the last time step.
+	b3Profile m_profile;
 };
 
 inline void b3Body::SetGravity(const b3Vec3& gravity)
@@ -195,6 +341,86 @@ inline b3Vec3 b3Body::GetGravity() const
 	return m_gravity;
 }
 
+inline void b3Body::SetMatrixFree(bool flag)
+{
+	m_matrixFree = flag;
+}
+
+inline bool b3Body::GetMatrixFree() const
+{
+	return m_matrixFree;
+}
+
+inline void b3Body::SetWarmStart(bool flag)
+{
+	m_warmStart = flag;
+}
+
+inline bool b3Body::GetWarmStart() const
+{
+	return m_warmStart;
+}
+
+inline void b3Body::SetCompareColdStart(bool flag)
+{
+	m_compareColdStart = flag;
+}
+
+inline bool b3Body::GetCompareColdStart() const
+{
+	return m_compareColdStart;
+}
+
+inline void b3Body::SetAdaptiveSubTolerance(bool flag)
+{
+	m_adaptiveSubTolerance = flag;
+}
+
+inline bool b3Body::GetAdaptiveSubTolerance() const
+{
+	return m_adaptiveSubTolerance;
+}
+
+inline void b3Body::SetLinearSolver(b3LinearSolverType type)
+{
+	m_linearSolver = type;
+}
+
+inline b3LinearSolverType b3Body::GetLinearSolver() const
+{
+	return m_linearSolver;
+}
+
+inline void b3Body::SetPreconditioner(b3PreconditionerType type)
+{
+	m_preconditioner = type;
+}
+
+inline b3PreconditionerType b3Body::GetPreconditioner() const
+{
+	return m_preconditioner;
+}
+
+inline void b3Body::SetThreadCount(u32 count)
+{
+	m_threadPool.SetThreadCount(count);
+}
+
+inline u32 b3Body::GetThreadCount() const
+{
+	return m_threadPool.GetThreadCount();
+}
+
+inline const b3SolverStats& b3Body::GetSolverStats() const
+{
+	return m_stats;
+}
+
+inline const b3Profile& b3Body::GetProfile() const
+{
+	return m_profile;
+}
+
 inline const b3List<b3Force>& b3Body::GetForceList() const
 {
 	return m_forceList;
@@ -220,6 +446,11 @@ inline const b3List<b3TetrahedronFixture>& b3Body::GetTetrahedronList() const
 	return m_tetrahedronList;
 }
 
+inline const b3List<b3BodyMesh>& b3Body::GetMeshList() const
+{
+	return m_meshList;
+}
+
 inline const b3List<b3WorldFixture>& b3Body::GetFixtureList() const
 {
 	return m_fixtureList;
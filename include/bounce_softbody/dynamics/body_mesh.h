@@ -0,0 +1,274 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_BODY_MESH_H
+#define B3_BODY_MESH_H
+
+#include <bounce_softbody/dynamics/particle.h>
+#include <bounce_softbody/dynamics/fixtures/sphere_fixture.h>
+#include <bounce_softbody/dynamics/fixtures/triangle_fixture.h>
+#include <bounce_softbody/dynamics/fixtures/tetrahedron_fixture.h>
+#include <bounce_softbody/dynamics/forces/force.h>
+
+// Body mesh definition.
+// A particle is created for each vertex, a triangle fixture for each triangle 
+// and a tetrahedron fixture for each tetrahedron.
+// The mesh must not contain duplicate triangles or tetrahedra.
+struct b3BodyMeshDef
+{
+	b3BodyMeshDef()
+	{
+		vertexCount = 0;
+		vertices = nullptr;
+		triangleCount = 0;
+		triangles = nullptr;
+		tetrahedronCount = 0;
+		tetrahedrons = nullptr;
+		particleType = e_dynamicParticle;
+		massDamping = scalar(0);
+		createSpheres = true;
+		radius = scalar(0);
+		friction = scalar(0.3);
+		triangleDensity = scalar(0);
+		tetrahedronDensity = scalar(0);
+		createTriangleForces = false;
+		triangleForceType = e_stretchForce;
+		stretchingStiffness = scalar(0);
+		stretchStiffnessDamping = scalar(0);
+		triangleYoungModulus = scalar(500);
+		triangleShearModulus = scalar(500);
+		trianglePoissonRatio = scalar(0.3);
+		triangleStiffnessDamping = scalar(0);
+		createTetrahedronForces = false;
+		tetrahedronYoungModulus = scalar(1000);
+		tetrahedronPoissonRatio = scalar(0.3);
+		tetrahedronStiffnessDamping = scalar(0);
+	}
+
+	// Rest vertices. These are also the initial particle positions.
+	u32 vertexCount;
+	const b3Vec3* vertices;
+
+	// Vertex indices. Three per triangle.
+	u32 triangleCount;
+	const u32* triangles;
+
+	// Vertex indices. Four per tetrahedron.
+	u32 tetrahedronCount;
+	const u32* tetrahedrons;
+
+	// Particle type and coefficient of mass damping.
+	b3ParticleType particleType;
+	scalar massDamping;
+
+	// Create a sphere fixture for each particle.
+	bool createSpheres;
+
+	// Radius and coefficient of friction of all fixtures.
+	scalar radius;
+	scalar friction;
+
+	// Density of the triangles and tetrahedra. 
+	// These determine the particle masses.
+	scalar triangleDensity;
+	scalar tetrahedronDensity;
+
+	// Create a force for each triangle. 
+	// The type must be e_stretchForce or e_triangleElementForce.
+	bool createTriangleForces;
+	b3ForceType triangleForceType;
+
+	// Stretch force parameters.
+	scalar stretchingStiffness;
+	scalar stretchStiffnessDamping;
+
+	// Triangle element force parameters.
+	scalar triangleYoungModulus;
+	scalar triangleShearModulus;
+	scalar trianglePoissonRatio;
+	scalar triangleStiffnessDamping;
+
+	// Create a tetrahedron element force for each tetrahedron.
+	bool createTetrahedronForces;
+
+	// Tetrahedron element force parameters.
+	scalar tetrahedronYoungModulus;
+	scalar tetrahedronPoissonRatio;
+	scalar tetrahedronStiffnessDamping;
+};
+
+// The objects created from a body mesh. 
+// The objects of each type are stored contiguously in one allocation owned by the body 
+// and ordered like the mesh elements, so element i maps to index i. 
+// Objects can still be destroyed individually. 
+// Their memory is released when the mesh is destroyed.
+class b3BodyMesh
+{
+public:
+	// Get the number of particles. This is the number of vertices.
+	u32 GetParticleCount() const { return m_particleCount; }
+
+	// Get the particle of a vertex.
+	b3Particle* GetParticle(u32 index);
+	const b3Particle* GetParticle(u32 index) const;
+
+	// Get the number of sphere fixtures. This is either zero or the number of vertices.
+	u32 GetSphereCount() const { return m_sphereCount; }
+
+	// Get the sphere fixture of a vertex.
+	b3SphereFixture* GetSphere(u32 index);
+	const b3SphereFixture* GetSphere(u32 index) const;
+
+	// Get the number of triangle fixtures.
+	u32 GetTriangleCount() const { return m_triangleCount; }
+
+	// Get the fixture of a triangle.
+	b3TriangleFixture* GetTriangle(u32 index);
+	const b3TriangleFixture* GetTriangle(u32 index) const;
+
+	// Get the number of tetrahedron fixtures.
+	u32 GetTetrahedronCount() const { return m_tetrahedronCount; }
+
+	// Get the fixture of a tetrahedron.
+	b3TetrahedronFixture* GetTetrahedron(u32 index);
+	const b3TetrahedronFixture* GetTetrahedron(u32 index) const;
+
+	// Get the number of triangle forces. This is either zero or the number of triangles.
+	u32 GetTriangleForceCount() const { return m_triangleForceCount; }
+
+	// Get the force of a triangle.
+	b3Force* GetTriangleForce(u32 index);
+	const b3Force* GetTriangleForce(u32 index) const;
+
+	// Get the number of tetrahedron forces. This is either zero or the number of tetrahedra.
+	u32 GetTetrahedronForceCount() const { return m_tetrahedronForceCount; }
+
+	// Get the force of a tetrahedron.
+	b3Force* GetTetrahedronForce(u32 index);
+	const b3Force* GetTetrahedronForce(u32 index) const;
+
+	// Get the next mesh in the body list of meshes.
+	b3BodyMesh* GetNext() { return m_next; }
+	const b3BodyMesh* GetNext() const { return m_next; }
+private:
+	friend class b3Body;
+	friend class b3List<b3BodyMesh>;
+
+	// Storage of all objects
+	void* m_memory;
+
+	// Arrays in the storage
+	b3Particle* m_particles;
+	u32 m_particleCount;
+
+	// False if a particle was destroyed.
+	bool* m_activeParticles;
+
+	b3SphereFixture* m_spheres;
+	u32 m_sphereCount;
+
+	b3TriangleFixture* m_triangles;
+	u32 m_triangleCount;
+
+	b3TetrahedronFixture* m_tetrahedrons;
+	u32 m_tetrahedronCount;
+
+	b3Force** m_triangleForces;
+	u32 m_triangleForceCount;
+
+	b3Force** m_tetrahedronForces;
+	u32 m_tetrahedronForceCount;
+
+	// Links to the body list.
+	b3BodyMesh* m_prev;
+	b3BodyMesh* m_next;
+};
+
+inline b3Particle* b3BodyMesh::GetParticle(u32 index)
+{
+	B3_ASSERT(index < m_particleCount);
+	return m_particles + index;
+}
+
+inline const b3Particle* b3BodyMesh::GetParticle(u32 index) const
+{
+	B3_ASSERT(index < m_particleCount);
+	return m_particles + index;
+}
+
+inline b3SphereFixture* b3BodyMesh::GetSphere(u32 index)
+{
+	B3_ASSERT(index < m_sphereCount);
+	return m_spheres + index;
+}
+
+inline const b3SphereFixture* b3BodyMesh::GetSphere(u32 index) const
+{
+	B3_ASSERT(index < m_sphereCount);
+	return m_spheres + index;
+}
+
+inline b3TriangleFixture* b3BodyMesh::GetTriangle(u32 index)
+{
+	B3_ASSERT(index < m_triangleCount);
+	return m_triangles + index;
+}
+
+inline const b3TriangleFixture* b3BodyMesh::GetTriangle(u32 index) const
+{
+	B3_ASSERT(index < m_triangleCount);
+	return m_triangles + index;
+}
+
+inline b3TetrahedronFixture* b3BodyMesh::GetTetrahedron(u32 index)
+{
+	B3_ASSERT(index < m_tetrahedronCount);
+	return m_tetrahedrons + index;
+}
+
+inline const b3TetrahedronFixture* b3BodyMesh::GetTetrahedron(u32 index) const
+{
+	B3_ASSERT(index < m_tetrahedronCount);
+	return m_tetrahedrons + index;
+}
+
+inline b3Force* b3BodyMesh::GetTriangleForce(u32 index)
+{
+	B3_ASSERT(index < m_triangleForceCount);
+	return m_triangleForces[index];
+}
+
+inline const b3Force* b3BodyMesh::GetTriangleForce(u32 index) const
+{
+	B3_ASSERT(index < m_triangleForceCount);
+	return m_triangleForces[index];
+}
+
+inline b3Force* b3BodyMesh::GetTetrahedronForce(u32 index)
+{
+	B3_ASSERT(index < m_tetrahedronForceCount);
+	return m_tetrahedronForces[index];
+}
+
+inline const b3Force* b3BodyMesh::GetTetrahedronForce(u32 index) const
+{
+	B3_ASSERT(index < m_tetrahedronForceCount);
+	return m_tetrahedronForces[index];
+}
+
+#endif
\ No newline at end of file
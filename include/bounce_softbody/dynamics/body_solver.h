@@ -26,15 +26,23 @@ class b3StackAllocator;
 class b3Particle;
 class b3Force;
 class b3SphereAndShapeContact;
+class b3ThreadPool;
 
 struct b3TimeStep;
+struct b3ParticleStorage;
+struct b3ForceSolverCache;
+struct b3SolverStats;
 
 struct b3BodySolverDef
 {
 	b3StackAllocator* stack;
-	u32 particleCapacity;
+	b3ParticleStorage* particles;
 	u32 forceCapacity;
 	u32 shapeContactCapacity;
+	b3ForceSolverCache* cache;
+	bool buildPattern;
+	b3ThreadPool* threadPool;
+	b3SolverStats* stats;
 };
 
 class b3BodySolver
@@ -43,7 +51,6 @@ public:
 	b3BodySolver(const b3BodySolverDef& def);
 	~b3BodySolver();
 	
-	void Add(b3Particle* p);
 	void Add(b3Force* f);
 	void Add(b3SphereAndShapeContact* c);
 	
@@ -51,9 +58,7 @@ public:
 private:
 	b3StackAllocator* m_stack;
 
-	u32 m_particleCapacity;
-	u32 m_particleCount;
-	b3Particle** m_particles;
+	b3ParticleStorage* m_particles;
 
 	u32 m_forceCapacity;
 	u32 m_forceCount;
@@ -62,6 +67,13 @@ private:
 	u32 m_shapeContactCapacity;
 	u32 m_shapeContactCount;
 	b3SphereAndShapeContact** m_shapeContacts;
+
+	b3ForceSolverCache* m_cache;
+	bool m_buildPattern;
+
+	b3ThreadPool* m_threadPool;
+
+	b3SolverStats* m_stats;
 };
 
 #endif
\ No newline at end of file
@@ -19,6 +19,7 @@
 #ifndef B3_SPHERE_AND_SHAPE_CONTACT_H
 #define B3_SPHERE_AND_SHAPE_CONTACT_H
 
+#include <bounce_softbody/dynamics/particle.h>
 #include <bounce_softbody/common/template/list.h>
 #include <bounce_softbody/common/math/vec3.h>
 
@@ -46,6 +47,7 @@ public:
 	bool m_active;
 	b3Vec3 m_tangent1, m_tangent2;
 	scalar m_normalForce;
+	b3ParticleEdge<b3SphereAndShapeContact> m_edge;
 	b3SphereAndShapeContact* m_prev;
 	b3SphereAndShapeContact* m_next;
 };
@@ -22,6 +22,7 @@
 #include <bounce_softbody/common/math/math.h>
 
 class b3Body;
+class b3BodyMesh;
 
 enum b3FixtureType
 {
@@ -75,7 +76,8 @@ public:
 	scalar GetRadius() const;
 
 	// Set the fixture density. This will not automatically adjust the mass 
-	// of the particles. Set this to zero to disable fixture mass contribution.
+	// of the particles. Call b3Body::ResetMass to do so. 
+	// Set this to zero to disable fixture mass contribution.
 	void SetDensity(scalar density);
 
 	// Get the fixture density.
@@ -113,6 +115,9 @@ protected:
 
 	// Feature index into mesh 
 	u32 m_meshIndex;
+
+	// Mesh that owns the memory of this fixture or nullptr.
+	b3BodyMesh* m_mesh;
 };
 
 inline b3Fixture::b3Fixture(const b3FixtureDef& def, b3Body* body)
@@ -122,6 +127,7 @@ inline b3Fixture::b3Fixture(const b3FixtureDef& def, b3Body* body)
 	m_friction = def.friction;
 	m_density = def.density;
 	m_meshIndex = def.meshIndex;
+	m_mesh = nullptr;
 }
 
 inline b3FixtureType b3Fixture::GetType() const
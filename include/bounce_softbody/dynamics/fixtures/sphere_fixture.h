@@ -21,10 +21,9 @@
 
 #include <bounce_softbody/dynamics/fixtures/fixture.h>
 #include <bounce_softbody/collision/geometry/aabb.h>
+#include <bounce_softbody/dynamics/particle.h>
 #include <bounce_softbody/common/template/list.h>
 
-class b3Particle;
-
 // Sphere fixture definition.
 struct b3SphereFixtureDef : public b3FixtureDef
 {
@@ -68,6 +67,9 @@ private:
 	// Particle
 	b3Particle* m_p;
 
+	// Link to the particle list.
+	b3ParticleEdge<b3SphereFixture> m_edge;
+
 	// Links to the body list.
 	b3SphereFixture* m_prev;
 	b3SphereFixture* m_next;
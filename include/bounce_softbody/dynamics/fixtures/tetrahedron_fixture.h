@@ -21,10 +21,9 @@
 
 #include <bounce_softbody/dynamics/fixtures/fixture.h>
 #include <bounce_softbody/collision/geometry/aabb.h>
+#include <bounce_softbody/dynamics/particle.h>
 #include <bounce_softbody/common/template/list.h>
 
-class b3Particle;
-
 // Tetrahedron fixture definition.
 struct b3TetrahedronFixtureDef : public b3FixtureDef
 {
@@ -79,9 +78,15 @@ private:
 	b3Particle* m_p3;
 	b3Particle* m_p4;
 
+	// Links to the particle lists.
+	b3ParticleEdge<b3TetrahedronFixture> m_edges[4];
+
 	// Rest volume. Used for computing the mass of the particles.
 	scalar m_volume;
 
+	// Mass added to each particle
+	scalar m_particleMass;
+
 	// Links to the body list.
 	b3TetrahedronFixture* m_prev;
 	b3TetrahedronFixture* m_next;
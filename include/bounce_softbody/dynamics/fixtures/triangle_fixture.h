@@ -21,13 +21,12 @@
 
 #include <bounce_softbody/dynamics/fixtures/fixture.h>
 #include <bounce_softbody/collision/geometry/aabb.h>
+#include <bounce_softbody/dynamics/particle.h>
 #include <bounce_softbody/common/template/list.h>
 
 struct b3RayCastInput;
 struct b3RayCastOutput;
 
-class b3Particle;
-
 // Triangle fixture definition.
 struct b3TriangleFixtureDef : public b3FixtureDef
 {
@@ -87,9 +86,15 @@ private:
 	b3Particle* m_p2;
 	b3Particle* m_p3;
 
+	// Links to the particle lists.
+	b3ParticleEdge<b3TriangleFixture> m_edges[3];
+
 	// Rest area. Used for computing the mass of the particles.
 	scalar m_area;
 
+	// Mass added to each particle
+	scalar m_particleMass;
+
 	// Dynamic tree proxy.
 	u32 m_proxyId;
 
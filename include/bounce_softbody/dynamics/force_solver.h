@@ -20,23 +20,93 @@
 #define B3_FORCE_SOLVER_H
 
 #include <bounce_softbody/dynamics/time_step.h>
-#include <bounce_softbody/common/math/vec3.h>
+#include <bounce_softbody/dynamics/solver_stats.h>
+#include <bounce_softbody/sparse/sparse_force_solver.h>
+#include <bounce_softbody/dynamics/forces/stretch_force_batch.h>
 
 class b3StackAllocator;
 class b3Particle;
 class b3Force;
+class b3TetrahedronElementForce;
 class b3SphereAndShapeContact;
+class b3ThreadPool;
+
+struct b3ParticleStorage;
+
+// Number of consecutive elements in a chunk of a force coloring.
+// This is a multiple of the number of forces evaluated together in SIMD lanes.
+#define B3_FORCE_CHUNK_SIZE 64
+
+// The maximum number of colors of a force coloring. 
+// Chunks that don't fit in these colors are evaluated serially.
+#define B3_MAX_FORCE_COLORS 64
+
+// Chunks of consecutive force elements grouped by color. No two chunks of a color share a particle,
+// so the chunks of a color can be evaluated in parallel without races.
+// Chunks keep the elements of a mesh region together, which keeps the memory accesses local.
+// The colors are evaluated in order, also by a single thread, so the sums don't depend on the number of threads.
+struct b3ForceColoring
+{
+	b3ForceColoring();
+	~b3ForceColoring();
+
+	// Color the given elements. Each element has a fixed number of particle solver identifiers. 
+	// Unused identifiers are set to B3_MAX_U32.
+	void Create(const u32* particles, u32 particlesPerElement, u32 elementCount, u32 particleCount);
+
+	void Destroy();
+
+	// Get the elements of a chunk.
+	void GetChunk(u32 chunk, u32* begin, u32* end) const
+	{
+		*begin = chunk * B3_FORCE_CHUNK_SIZE;
+		*end = b3Min(*begin + B3_FORCE_CHUNK_SIZE, elementCount);
+	}
+
+	u32 elementCount;
+	u32 chunkCount;
+	u32* chunks; // chunks sorted by color
+	u32 colorCount; // number of colors including the serial group
+	u32 colorOffsets[B3_MAX_FORCE_COLORS + 2]; // first chunk of each color and the end of the last color
+	bool serial; // is the last color a group of chunks that share particles?
+};
+
+// Buffers kept by the body for the force solver across time steps.
+// The initial state and the translations are read from the body arrays.
+struct b3ForceSolverCache
+{
+	b3ForceSolverCache();
+	~b3ForceSolverCache();
+
+	b3DenseVec3 fe, x, v, z;
+	b3DiagMat33 M, S;
+	b3SolveBECache solverCache;
+	
+	b3StretchForceBatch stretchBatch; // stretch forces
+	b3ForceColoring stretchColoring;
+
+	u32 tetrahedronCount;
+	b3TetrahedronElementForce** tetrahedra; // tetrahedron element forces in the body order
+	b3ForceColoring tetrahedronColoring;
+
+	u32 forceCount;
+	b3Force** forces; // other forces in the body order
+	b3ForceColoring forceColoring;
+};
 
 struct b3ForceSolverDef
 {
 	b3TimeStep step;
 	b3StackAllocator* stack;
-	u32 particleCount;
-	b3Particle** particles;
+	b3ParticleStorage* particles;
 	u32 forceCount;
 	b3Force** forces;
 	b3SphereAndShapeContact** shapeContacts;
 	u32 shapeContactCount;
+	b3ForceSolverCache* cache;
+	bool buildPattern;
+	b3ThreadPool* threadPool;
+	b3SolverStats* stats;
 };
 
 class b3ForceSolver
@@ -47,10 +117,17 @@ public:
 
 	void Solve(const b3Vec3& gravity);
 private:
+	// Build the Jacobian sparsity pattern and the force coloring from the particles and forces.
+	void BuildPattern();
+
+	// Get the B3_MAX_FORCE_PARTICLES particle solver identifiers of a force. Unused identifiers are set to B3_MAX_U32.
+	static void GetParticles(u32* ids, const b3Force* force);
+
 	b3TimeStep m_step;
 
 	b3StackAllocator* m_stack;
 
+	b3ParticleStorage* m_storage;
 	u32 m_particleCount;
 	b3Particle** m_particles;
 
@@ -59,6 +136,13 @@ private:
 
 	u32 m_shapeContactCount;
 	b3SphereAndShapeContact** m_shapeContacts;
+
+	b3ForceSolverCache* m_cache;
+	bool m_buildPattern;
+
+	b3ThreadPool* m_threadPool;
+
+	b3SolverStats* m_stats;
 };
 
 #endif
\ No newline at end of file
@@ -19,12 +19,14 @@
 #ifndef B3_FORCE_H
 #define B3_FORCE_H
 
+#include <bounce_softbody/dynamics/particle.h>
 #include <bounce_softbody/common/template/list.h>
 
-class b3BlockAllocator;
-class b3Particle;
-
 struct b3SparseForceSolverData;
+class b3BodyMesh;
+
+// The maximum number of particles a force can act on.
+#define B3_MAX_FORCE_PARTICLES 4
 
 // Force types
 enum b3ForceType
@@ -75,9 +77,13 @@ protected:
 	friend class b3ForceSolver;
 	friend class b3ForceModel;
 
-	// Factory create and destroy.
-	static b3Force* Create(const b3ForceDef* def, b3BlockAllocator* allocator);
-	static void Destroy(b3Force* force, b3BlockAllocator* allocator);
+	// Factory create and destroy. 
+	// The memory is owned by the caller and must hold GetSize(def->type) bytes.
+	static b3Force* Create(const b3ForceDef* def, void* memory);
+	static void Destroy(b3Force* force);
+
+	// Get the size of a force type in bytes.
+	static u32 GetSize(b3ForceType type);
 
 	virtual ~b3Force() { }
 
@@ -87,12 +93,27 @@ protected:
 	// Compute forces and Jacobians.
 	virtual void ComputeForces(const b3SparseForceSolverData* data) = 0;
 
+	// Get the particles this force acts on. Return the number of particles.
+	// This is used for building the Jacobian sparsity pattern.
+	virtual u32 GetParticles(b3Particle* particles[B3_MAX_FORCE_PARTICLES]) const = 0;
+
 	// Force type.
 	b3ForceType m_type;
 	
 	// Feature index into mesh.
 	u32 m_meshIndex;
 
+	// Mesh that owns the memory of this force or nullptr.
+	b3BodyMesh* m_mesh;
+
+	// Indices of the Jacobian values coupling the particles returned by GetParticles.
+	// Block (i, j) couples particle i and particle j. 
+	// These are set by the force solver when the sparsity pattern is built.
+	u32 m_slots[B3_MAX_FORCE_PARTICLES][B3_MAX_FORCE_PARTICLES];
+
+	// Links to the lists of the particles returned by GetParticles.
+	b3ParticleEdge<b3Force> m_edges[B3_MAX_FORCE_PARTICLES];
+
 	// Links to body list.
 	b3Force* m_prev;
 	b3Force* m_next;
@@ -100,6 +100,8 @@ private:
 	void ClearForces();
 	void ComputeForces(const b3SparseForceSolverData* data);
 
+	u32 GetParticles(b3Particle* particles[B3_MAX_FORCE_PARTICLES]) const;
+
 	// Particle 1
 	b3Particle* m_p1;
 
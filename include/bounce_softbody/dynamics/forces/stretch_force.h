@@ -20,6 +20,7 @@
 #define B3_STRETCH_FORCE_H
 
 #include <bounce_softbody/dynamics/forces/force.h>
+#include <bounce_softbody/dynamics/forces/stretch_force_batch.h>
 #include <bounce_softbody/common/math/vec3.h>
 
 // Stretch force definition.
@@ -88,6 +89,7 @@ struct b3StretchForceDef : public b3ForceDef
 // This maintains the triangle edge lengths in the (u, v) 
 // frame of reference at a given desired normalized rest distance 
 // in the direction of the u and v coordinates.
+// The solver evaluates the stretch forces of a body together in a b3StretchForceBatch.
 class b3StretchForce : public b3Force
 {
 public:
@@ -152,12 +154,18 @@ public:
 	b3Vec3 GetActionForce3() const;
 private:
 	friend class b3Force;
+	friend class b3StretchForceBatch;
 
 	b3StretchForce(const b3StretchForceDef* def);
+
+	// Copy the parameters to the batch.
+	void SynchronizeBatch();
 	
 	void ClearForces();
 	void ComputeForces(const b3SparseForceSolverData* data);
 
+	u32 GetParticles(b3Particle* particles[B3_MAX_FORCE_PARTICLES]) const;
+
 	// Particle 1
 	b3Particle* m_p1;
 
@@ -196,14 +204,27 @@ private:
 	// Desired strechiness in v direction
 	scalar m_b_v;
 
-	// Action forces
+	// Action forces if this force is not in a batch
 	b3Vec3 m_f1, m_f2, m_f3;
+
+	// Batch containing this force
+	b3StretchForceBatch* m_batch;
+	u32 m_batchIndex;
 };
 
+inline void b3StretchForce::SynchronizeBatch()
+{
+	if (m_batch)
+	{
+		m_batch->SetParameters(m_batchIndex, this);
+	}
+}
+
 inline void b3StretchForce::SetStiffnessU(scalar stiffness)
 {
 	B3_ASSERT(stiffness >= scalar(0));
 	m_ks_u = stiffness;
+	SynchronizeBatch();
 }
 
 inline scalar b3StretchForce::GetStiffnessU() const
@@ -215,6 +236,7 @@ inline void b3StretchForce::SetDampingStiffnessU(scalar dampingStiffness)
 {
 	B3_ASSERT(dampingStiffness >= scalar(0));
 	m_kd_u = dampingStiffness;
+	SynchronizeBatch();
 }
 
 inline scalar b3StretchForce::GetDampingStiffnessU() const
@@ -226,6 +248,7 @@ inline void b3StretchForce::SetBU(scalar b)
 {
 	B3_ASSERT(b >= scalar(0) && b <= scalar(1));
 	m_b_u = b;
+	SynchronizeBatch();
 }
 
 inline scalar b3StretchForce::GetBU() const
@@ -237,6 +260,7 @@ inline void b3StretchForce::SetStiffnessV(scalar stiffness)
 {
 	B3_ASSERT(stiffness >= scalar(0));
 	m_ks_v = stiffness;
+	SynchronizeBatch();
 }
 
 inline scalar b3StretchForce::GetStiffnessV() const
@@ -248,6 +272,7 @@ inline void b3StretchForce::SetDampingStiffnessV(scalar dampingStiffness)
 {
 	B3_ASSERT(dampingStiffness >= scalar(0));
 	m_kd_v = dampingStiffness;
+	SynchronizeBatch();
 }
 
 inline scalar b3StretchForce::GetDampingStiffnessV() const
@@ -259,6 +284,7 @@ inline void b3StretchForce::SetBV(scalar b)
 {
 	B3_ASSERT(b >= scalar(0) && b <= scalar(1));
 	m_b_v = b;
+	SynchronizeBatch();
 }
 
 inline scalar b3StretchForce::GetBV() const
@@ -268,16 +294,28 @@ inline scalar b3StretchForce::GetBV() const
 
 inline b3Vec3 b3StretchForce::GetActionForce1() const
 {
+	if (m_batch)
+	{
+		return m_batch->GetActionForce(m_batchIndex, 0);
+	}
 	return m_f1;
 }
 
 inline b3Vec3 b3StretchForce::GetActionForce2() const
 {
+	if (m_batch)
+	{
+		return m_batch->GetActionForce(m_batchIndex, 1);
+	}
 	return m_f2;
 }
 
 inline b3Vec3 b3StretchForce::GetActionForce3() const
 {
+	if (m_batch)
+	{
+		return m_batch->GetActionForce(m_batchIndex, 2);
+	}
 	return m_f3;
 }
 
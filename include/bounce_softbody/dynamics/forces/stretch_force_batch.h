@@ -0,0 +1,105 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_STRETCH_FORCE_BATCH_H
+#define B3_STRETCH_FORCE_BATCH_H
+
+#include <bounce_softbody/common/math/vec3.h>
+
+class b3StretchForce;
+struct b3SparseForceSolverData;
+
+// The stretch forces of a body stored as a structure of arrays. 
+// The forces are evaluated in groups of four, one force per SIMD lane.
+// A b3StretchForce in a batch keeps its parameters and reads its action forces from the batch.
+// The batch is built by the force solver when the topology changes.
+class b3StretchForceBatch
+{
+public:
+	b3StretchForceBatch();
+	~b3StretchForceBatch();
+
+	// Gather the given forces. The particle solver identifiers and the Jacobian slots must be set.
+	void Create(b3StretchForce** forces, u32 count);
+
+	// Free the arrays. This doesn't touch the forces because they can be destroyed already.
+	void Destroy();
+
+	// Get the number of forces.
+	u32 GetCount() const { return m_count; }
+
+	// Get the particle solver identifiers of a force.
+	void GetParticles(u32 index, u32 particles[3]) const;
+
+	// Copy the parameters of a force in the batch.
+	void SetParameters(u32 index, const b3StretchForce* force);
+
+	// Clear the action forces of a force.
+	void ClearForces(u32 index);
+
+	// Get the action force acting on a vertex of a force.
+	b3Vec3 GetActionForce(u32 index, u32 vertex) const;
+
+	// Compute forces and Jacobians of the forces [begin, end). 
+	// The first force must be the first of a group.
+	void ComputeForces(const b3SparseForceSolverData* data, u32 begin, u32 end);
+private:
+	// Compute forces and Jacobians of the group of four forces starting at a given force.
+	void ComputeGroup(const b3SparseForceSolverData* data, u32 first);
+
+	u32 m_count;
+	u32 m_capacity; // number of forces rounded up to a multiple of four
+
+	// Particle solver identifiers
+	u32* m_i1;
+	u32* m_i2;
+	u32* m_i3;
+
+	// Jacobian slots. Nine per force.
+	u32* m_slots;
+
+	// Area
+	scalar* m_alpha;
+
+	// (u, v) matrix
+	scalar* m_du1;
+	scalar* m_dv1;
+	scalar* m_du2;
+	scalar* m_dv2;
+	scalar* m_inv_det;
+
+	// dwudx, dwvdx
+	scalar* m_dwudx[3];
+	scalar* m_dwvdx[3];
+
+	// Stiffnesses and rest lengths
+	scalar* m_ks_u;
+	scalar* m_kd_u;
+	scalar* m_b_u;
+	scalar* m_ks_v;
+	scalar* m_kd_v;
+	scalar* m_b_v;
+
+	// Scalar arrays allocated in one block
+	scalar* m_scalars;
+
+	// Action forces. Three per force.
+	b3Vec3* m_f;
+};
+
+#endif
\ No newline at end of file
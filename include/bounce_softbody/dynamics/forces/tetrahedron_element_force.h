@@ -113,6 +113,7 @@ public:
 	scalar GetStiffnessDamping() const;
 private:
 	friend class b3Force;
+	friend class b3ForceModel;
 	
 	b3TetrahedronElementForce(const b3TetrahedronElementForceDef* def);
 
@@ -125,6 +126,15 @@ private:
 	// Compute element forces.
 	void ComputeForces(const b3SparseForceSolverData* data);
 
+	// Compute the forces of many elements. 
+	// The rotations are extracted and applied to the stiffness matrices four elements at a time.
+	static void ComputeForces(b3TetrahedronElementForce** forces, u32 count, const b3SparseForceSolverData* data);
+
+	// Apply the element forces given the rotation and the rotated stiffness matrix.
+	void ApplyForces(const b3SparseForceSolverData* data, const b3Mat33& R, const b3Mat33 K[16]);
+
+	u32 GetParticles(b3Particle* particles[B3_MAX_FORCE_PARTICLES]) const;
+
 	// Particle 1
 	b3Particle* m_p1;
 	
@@ -114,6 +114,8 @@ private:
 	// Compute element forces.
 	void ComputeForces(const b3SparseForceSolverData* data);
 
+	u32 GetParticles(b3Particle* particles[B3_MAX_FORCE_PARTICLES]) const;
+
 	// Particle 1
 	b3Particle* m_p1;
 
@@ -26,9 +26,12 @@ class b3StackAllocator;
 class b3Particle;
 class b3SphereAndShapeContact;
 
+struct b3ParticleStorage;
+
 struct b3FrictionSolverDef
 {
 	b3TimeStep step;
+	b3ParticleStorage* particles;
 	u32 shapeContactCount;
 	b3SphereAndShapeContact** shapeContacts;
 };
@@ -48,6 +51,7 @@ public:
 protected:
 	b3TimeStep m_step;
 	b3StackAllocator* m_allocator;
+	b3ParticleStorage* m_particles;
 	u32 m_shapeContactCount;
 	b3SphereAndShapeContact** m_shapeContacts;
 };
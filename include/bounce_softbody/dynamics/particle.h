@@ -21,11 +21,29 @@
 
 #include <bounce_softbody/common/template/list.h>
 #include <bounce_softbody/common/math/vec3.h>
+#include <bounce_softbody/dynamics/particle_storage.h>
 
 class b3Body;
+class b3BodyMesh;
+class b3SphereFixture;
+class b3TriangleFixture;
+class b3TetrahedronFixture;
+class b3Force;
+class b3SphereAndShapeContact;
 
 struct b3SparseForceSolverData;
 
+// An edge links a particle to a fixture, force or contact acting on it.
+// The owner keeps one edge for each of its particles. 
+// This lets a particle visit the objects touching it in time proportional to its valence.
+template<class T>
+struct b3ParticleEdge
+{
+	T* owner;
+	b3ParticleEdge* m_prev;
+	b3ParticleEdge* m_next;
+};
+
 // Static particle: Zero mass. Can be moved manually.
 // Kinematic particle: Zero mass. Non-zero velocity, can be moved by the solver.
 // Dynamic particle: Non-zero mass. Non-zero velocity determined by force, can be moved by the solver.
@@ -68,7 +86,7 @@ struct b3ParticleDef
 	void* userData;
 };
 
-// A particle.
+// A particle. The state of a particle is stored in the body arrays.
 class b3Particle
 {
 public:
@@ -84,25 +102,25 @@ public:
 	void SetPosition(const b3Vec3& position);
 
 	// Get the particle position.
-	const b3Vec3& GetPosition() const;
+	b3Vec3 GetPosition() const;
 
 	// Set the particle velocity.
 	void SetVelocity(const b3Vec3& velocity);
 
 	// Get the particle velocity.
-	const b3Vec3& GetVelocity() const;
+	b3Vec3 GetVelocity() const;
 
 	// Get the particle mass.
 	scalar GetMass() const;
 
 	// Get the applied force.
-	const b3Vec3& GetForce() const;
+	b3Vec3 GetForce() const;
 
 	// Apply a force.
 	void ApplyForce(const b3Vec3& force);
 
 	// Get the applied translation.
-	const b3Vec3& GetTranslation() const;
+	b3Vec3 GetTranslation() const;
 
 	// Apply a translation.
 	void ApplyTranslation(const b3Vec3& translation);
@@ -128,6 +146,7 @@ public:
 	const b3Particle* GetNext() const;
 private:
 	friend class b3List<b3Particle>;
+	friend struct b3ParticleStorage;
 	friend class b3Body;
 	friend class b3ContactManager;
 	friend class b3BodySolver;
@@ -140,6 +159,7 @@ private:
 	friend class b3SphereAndShapeContact;
 	friend class b3Force;
 	friend class b3StretchForce;
+	friend class b3StretchForceBatch;
 	friend class b3ShearForce;
 	friend class b3SpringForce;
 	friend class b3MouseForce;
@@ -163,26 +183,21 @@ private:
 	// Compute forces due to particle.
 	void ComputeForces(const b3SparseForceSolverData* data);
 
-	// Type
-	b3ParticleType m_type;
-
-	// Position
-	b3Vec3 m_position;
-
-	// Velocity
-	b3Vec3 m_velocity;
+	// Add or remove the mass of a triangle or tetrahedron.
+	void AddFixtureMass(scalar mass);
+	void RemoveFixtureMass(scalar mass);
 
-	// Applied external force
-	b3Vec3 m_force;
+	// Set the mass from the type and the fixture mass.
+	void UpdateMass();
 
-	// Applied translation
-	b3Vec3 m_translation;
+	// Type
+	b3ParticleType m_type;
 
-	// Mass
-	scalar m_mass;
+	// Mass of the triangles and tetrahedra
+	scalar m_fixtureMass;
 
-	// Inverse mass
-	scalar m_invMass;
+	// Number of triangles and tetrahedra contributing to the mass
+	u32 m_fixtureCount;
 
 	// Coefficient of mass damping.
 	scalar m_massDamping;
@@ -190,15 +205,31 @@ private:
 	// Mesh index. 
 	u32 m_meshIndex;
 
-	// Solver temp identifier
+	// Mesh that owns the memory of this particle or nullptr.
+	b3BodyMesh* m_mesh;
+
+	// Index of the state in the body arrays. This is also the solver identifier.
 	u32 m_solverId;
 
+	// Index of the diagonal block in the Jacobian values
+	u32 m_solverSlot;
+
 	// User data
 	void* m_userData;
 
 	// Body
 	b3Body* m_body;
 
+	// Body particle state
+	b3ParticleStorage* m_storage;
+
+	// Lists of the objects acting on this particle
+	b3List<b3ParticleEdge<b3SphereFixture>> m_sphereEdges;
+	b3List<b3ParticleEdge<b3TriangleFixture>> m_triangleEdges;
+	b3List<b3ParticleEdge<b3TetrahedronFixture>> m_tetrahedronEdges;
+	b3List<b3ParticleEdge<b3Force>> m_forceEdges;
+	b3List<b3ParticleEdge<b3SphereAndShapeContact>> m_contactEdges;
+
 	// Links to the body particle list.
 	b3Particle* m_prev;
 	b3Particle* m_next;
@@ -211,14 +242,14 @@ inline b3ParticleType b3Particle::GetType() const
 
 inline void b3Particle::SetPosition(const b3Vec3& position)
 {
-	m_position = position;
-	m_translation.SetZero();
+	m_storage->positions[m_solverId] = position;
+	m_storage->translations[m_solverId].SetZero();
 	SynchronizeFixtures();
 }
 
-inline const b3Vec3& b3Particle::GetPosition() const
+inline b3Vec3 b3Particle::GetPosition() const
 {
-	return m_position;
+	return m_storage->positions[m_solverId];
 }
 
 inline void b3Particle::SetVelocity(const b3Vec3& velocity)
@@ -227,22 +258,22 @@ inline void b3Particle::SetVelocity(const b3Vec3& velocity)
 	{
 		return;
 	}
-	m_velocity = velocity;
+	m_storage->velocities[m_solverId] = velocity;
 }
 
-inline const b3Vec3& b3Particle::GetVelocity() const
+inline b3Vec3 b3Particle::GetVelocity() const
 {
-	return m_velocity;
+	return m_storage->velocities[m_solverId];
 }
 
 inline scalar b3Particle::GetMass() const
 {
-	return m_mass;
+	return m_storage->masses[m_solverId];
 }
 
-inline const b3Vec3& b3Particle::GetForce() const
+inline b3Vec3 b3Particle::GetForce() const
 {
-	return m_force;
+	return m_storage->forces[m_solverId];
 }
 
 inline void b3Particle::ApplyForce(const b3Vec3& force)
@@ -251,17 +282,17 @@ inline void b3Particle::ApplyForce(const b3Vec3& force)
 	{
 		return;
 	}
-	m_force += force;
+	m_storage->forces[m_solverId] += force;
 }
 
-inline const b3Vec3& b3Particle::GetTranslation() const
+inline b3Vec3 b3Particle::GetTranslation() const
 {
-	return m_translation;
+	return m_storage->translations[m_solverId];
 }
 
 inline void b3Particle::ApplyTranslation(const b3Vec3& translation)
 {
-	m_translation += translation;
+	m_storage->translations[m_solverId] += translation;
 }
 
 inline void b3Particle::SetMassDamping(scalar damping)
@@ -0,0 +1,58 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_PARTICLE_STORAGE_H
+#define B3_PARTICLE_STORAGE_H
+
+#include <bounce_softbody/sparse/dense_vec3.h>
+
+class b3Particle;
+
+// The state of the particles of a body in structure-of-arrays form.
+// A particle is a handle to the elements at its solver identifier, 
+// so the solvers read and write the state in place.
+// The arrays grow geometrically. The vectors hold the number of particles 
+// but have room for the capacity.
+// Removing a particle moves the last particle into its place.
+struct b3ParticleStorage
+{
+	b3ParticleStorage();
+	~b3ParticleStorage();
+
+	// Make room for a given number of particles.
+	void Reserve(u32 capacity);
+
+	// Add a particle to the end of the arrays and return its index. 
+	// The state of the particle is undefined.
+	u32 Add(b3Particle* particle);
+
+	// Remove the particle at a given index.
+	void Remove(u32 index);
+
+	u32 count;
+	u32 capacity;
+	b3Particle** particles; // handles
+	b3DenseVec3 positions;
+	b3DenseVec3 velocities;
+	b3DenseVec3 forces; // applied external forces
+	b3DenseVec3 translations; // applied translations
+	scalar* masses; // zero for static and kinematic particles
+	scalar* invMasses;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,79 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef B3_SOLVER_STATS_H
+#define B3_SOLVER_STATS_H
+
+#include <bounce_softbody/common/settings.h>
+
+// The maximum number of force iterations recorded in the iteration history.
+#define B3_MAX_SOLVER_STATS_ITERATIONS 32
+
+// Statistics of the last time step of a body.
+// Times are in milliseconds.
+struct b3SolverStats
+{
+	b3SolverStats()
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		iterations = 0;
+		subIterations = 0;
+		minSubIterations = 0;
+		maxSubIterations = 0;
+		savedSubIterations = 0;
+		forceTime = 0.0;
+		assemblyTime = 0.0;
+		solveTime = 0.0;
+		synchronizeTime = 0.0;
+		stepTime = 0.0;
+		allocCount = 0;
+	}
+
+	// Return the number of force iterations in the history.
+	u32 GetHistoryCount() const
+	{
+		return iterations < B3_MAX_SOLVER_STATS_ITERATIONS ? iterations : B3_MAX_SOLVER_STATS_ITERATIONS;
+	}
+
+	u32 iterations; // number of force (Newton) iterations
+	u32 subIterations; // total number of sub-solver iterations
+	u32 minSubIterations; // min of sub-solver iterations per force iteration
+	u32 maxSubIterations; // max of sub-solver iterations per force iteration
+	i32 savedSubIterations; // sub-solver iterations saved by warm starting. This is only computed if the comparison with a cold start is enabled
+
+	u32 subIterationHistory[B3_MAX_SOLVER_STATS_ITERATIONS]; // sub-solver iterations of the first force iterations
+	scalar errorHistory[B3_MAX_SOLVER_STATS_ITERATIONS]; // squared velocity correction of the first force iterations. units: m^2/s^2
+
+	scalar64 forceTime; // computing forces and Jacobians
+	scalar64 assemblyTime; // assembling the linear systems
+	scalar64 solveTime; // solving the linear systems
+	scalar64 synchronizeTime; // synchronizing fixtures and finding new contacts
+	scalar64 stepTime; // the whole time step
+
+	// Number of b3Alloc calls made by the thread calling b3Body::Step during the step. 
+	// Calls made by the worker threads are not counted. The workers only fill memory 
+	// that the calling thread allocated, so this is zero once the caches are warm.
+	u32 allocCount;
+};
+
+#endif
\ No newline at end of file
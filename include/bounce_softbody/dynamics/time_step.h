@@ -19,7 +19,9 @@
 #ifndef B3_TIME_STEP_H
 #define B3_TIME_STEP_H
 
-#include <bounce_softbody/common/settings.h>
+#include <bounce_softbody/sparse/sparse_solver.h>
+
+struct b3Profile;
 
 // Time step parameters
 struct b3TimeStep
@@ -28,6 +30,13 @@ struct b3TimeStep
 	scalar inv_dt;
 	u32 forceIterations;
 	u32 forceSubIterations;
+	bool matrixFree;
+	bool warmStart;
+	bool compareColdStart;
+	bool adaptiveSubTolerance;
+	b3LinearSolverType linearSolver;
+	b3PreconditionerType preconditioner;
+	b3Profile* profile;
 };
 
 #endif
\ No newline at end of file
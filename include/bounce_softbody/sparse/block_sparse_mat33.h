@@ -0,0 +1,351 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_BLOCK_SPARSE_MAT_33_H
+#define B3_BLOCK_SPARSE_MAT_33_H
+
+#include <bounce_softbody/sparse/sparse_mat33.h>
+#include <bounce_softbody/common/math/simd.h>
+
+// A sparse matrix in compressed block sparse row (BSR) format.
+// The non-zero blocks of all rows are stored contiguously in a single array.
+// The blocks of a row are sorted by column index.
+// The value array is padded for SIMD loads.
+// The sparsity pattern is fixed after creation. Use b3SparseMat33
+// for building a matrix with an unknown pattern and compress it into this matrix.
+struct b3BlockSparseMat33
+{
+	b3BlockSparseMat33();
+
+	b3BlockSparseMat33(const b3SparseMat33& m);
+
+	b3BlockSparseMat33(const b3BlockSparseMat33& m);
+
+	~b3BlockSparseMat33();
+
+	b3BlockSparseMat33& operator=(const b3BlockSparseMat33& m);
+
+	// Compress a given sparse matrix into this matrix.
+	void Create(const b3SparseMat33& m);
+
+	// Copy the pattern and the values of a given matrix.
+	void Copy(const b3BlockSparseMat33& m);
+
+	void Destroy();
+
+	// Set the values to zero. This keeps the sparsity pattern.
+	void SetZero();
+
+	// Return the index of a block in the value array
+	// or B3_MAX_U32 if the block is not in the pattern.
+	u32 GetIndex(u32 i, u32 j) const;
+
+	b3Mat33* Search(u32 i, u32 j);
+
+	const b3Mat33* Search(u32 i, u32 j) const;
+
+	// The block must be in the sparsity pattern.
+	b3Mat33& operator()(u32 i, u32 j);
+
+	b3Mat33 operator()(u32 i, u32 j) const;
+
+	u32 rowCount;
+	u32 blockCount;
+	u32* rowPtrs;
+	u32* columns;
+	b3Mat33* values;
+};
+
+inline b3BlockSparseMat33::b3BlockSparseMat33()
+{
+	rowCount = 0;
+	blockCount = 0;
+	rowPtrs = nullptr;
+	columns = nullptr;
+	values = nullptr;
+}
+
+inline b3BlockSparseMat33::b3BlockSparseMat33(const b3SparseMat33& m)
+{
+	rowCount = 0;
+	blockCount = 0;
+	rowPtrs = nullptr;
+	columns = nullptr;
+	values = nullptr;
+
+	Create(m);
+}
+
+inline b3BlockSparseMat33::b3BlockSparseMat33(const b3BlockSparseMat33& m)
+{
+	rowCount = 0;
+	blockCount = 0;
+	rowPtrs = nullptr;
+	columns = nullptr;
+	values = nullptr;
+
+	Copy(m);
+}
+
+inline b3BlockSparseMat33::~b3BlockSparseMat33()
+{
+	Destroy();
+}
+
+inline b3BlockSparseMat33& b3BlockSparseMat33::operator=(const b3BlockSparseMat33& m)
+{
+	if (m.values == values)
+	{
+		return *this;
+	}
+
+	Copy(m);
+
+	return *this;
+}
+
+inline void b3BlockSparseMat33::Destroy()
+{
+	if (rowPtrs)
+	{
+		b3Free(rowPtrs);
+		rowPtrs = nullptr;
+	}
+
+	if (columns)
+	{
+		b3Free(columns);
+		columns = nullptr;
+	}
+
+	if (values)
+	{
+		b3Free(values);
+		values = nullptr;
+	}
+
+	rowCount = 0;
+	blockCount = 0;
+}
+
+inline void b3BlockSparseMat33::Create(const b3SparseMat33& m)
+{
+	Destroy();
+
+	rowCount = m.rowCount;
+	rowPtrs = (u32*)b3Alloc((rowCount + 1) * sizeof(u32));
+
+	blockCount = 0;
+	for (u32 i = 0; i < rowCount; ++i)
+	{
+		rowPtrs[i] = blockCount;
+		blockCount += m.rows[i].count;
+	}
+	rowPtrs[rowCount] = blockCount;
+
+	columns = (u32*)b3Alloc(blockCount * sizeof(u32));
+	values = (b3Mat33*)b3Alloc(b3GetBlockArraySize(blockCount));
+
+	for (u32 i = 0; i < rowCount; ++i)
+	{
+		u32 begin = rowPtrs[i];
+		u32 end = begin;
+
+		// Insertion sort by column. Rows are short.
+		for (b3RowEntry* e = m.rows[i].head; e; e = e->next)
+		{
+			u32 k = end;
+			while (k > begin && columns[k - 1] > e->column)
+			{
+				columns[k] = columns[k - 1];
+				values[k] = values[k - 1];
+				--k;
+			}
+
+			columns[k] = e->column;
+			values[k] = e->value;
+
+			++end;
+		}
+
+		B3_ASSERT(end == rowPtrs[i + 1]);
+	}
+}
+
+inline void b3BlockSparseMat33::Copy(const b3BlockSparseMat33& m)
+{
+	if (rowCount != m.rowCount || blockCount != m.blockCount)
+	{
+		Destroy();
+
+		rowCount = m.rowCount;
+		blockCount = m.blockCount;
+		rowPtrs = (u32*)b3Alloc((rowCount + 1) * sizeof(u32));
+		columns = (u32*)b3Alloc(blockCount * sizeof(u32));
+		values = (b3Mat33*)b3Alloc(b3GetBlockArraySize(blockCount));
+	}
+
+	memcpy(rowPtrs, m.rowPtrs, (rowCount + 1) * sizeof(u32));
+	memcpy(columns, m.columns, blockCount * sizeof(u32));
+	memcpy(values, m.values, blockCount * sizeof(b3Mat33));
+}
+
+inline void b3BlockSparseMat33::SetZero()
+{
+	for (u32 i = 0; i < blockCount; ++i)
+	{
+		values[i].SetZero();
+	}
+}
+
+inline u32 b3BlockSparseMat33::GetIndex(u32 i, u32 j) const
+{
+	B3_ASSERT(i < rowCount);
+	B3_ASSERT(j < rowCount);
+
+	// Binary search
+	u32 low = rowPtrs[i];
+	u32 high = rowPtrs[i + 1];
+	while (low < high)
+	{
+		u32 mid = low + (high - low) / 2;
+
+		if (columns[mid] < j)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+
+	if (low < rowPtrs[i + 1] && columns[low] == j)
+	{
+		return low;
+	}
+
+	return B3_MAX_U32;
+}
+
+inline b3Mat33* b3BlockSparseMat33::Search(u32 i, u32 j)
+{
+	u32 index = GetIndex(i, j);
+	if (index != B3_MAX_U32)
+	{
+		return values + index;
+	}
+	return nullptr;
+}
+
+inline const b3Mat33* b3BlockSparseMat33::Search(u32 i, u32 j) const
+{
+	u32 index = GetIndex(i, j);
+	if (index != B3_MAX_U32)
+	{
+		return values + index;
+	}
+	return nullptr;
+}
+
+inline b3Mat33& b3BlockSparseMat33::operator()(u32 i, u32 j)
+{
+	u32 index = GetIndex(i, j);
+	B3_ASSERT(index != B3_MAX_U32);
+	return values[index];
+}
+
+inline b3Mat33 b3BlockSparseMat33::operator()(u32 i, u32 j) const
+{
+	const b3Mat33* v = Search(i, j);
+	if (v)
+	{
+		return *v;
+	}
+	return b3Mat33_zero;
+}
+
+// Compute the rows [begin, end) of out = A * v.
+inline void b3Mul(b3DenseVec3& out, const b3BlockSparseMat33& A, const b3DenseVec3& v, u32 begin, u32 end)
+{
+	B3_ASSERT(A.rowCount == out.n);
+	B3_ASSERT(A.rowCount == v.n);
+	B3_ASSERT(begin <= end && end <= A.rowCount);
+
+#if defined(B3_SIMD_AVX2)
+	// Two blocks per instruction.
+	for (u32 i = begin; i < end; ++i)
+	{
+		u32 k = A.rowPtrs[i];
+		u32 rowEnd = A.rowPtrs[i + 1];
+
+		__m256 sum2 = _mm256_setzero_ps();
+		for (; k + 1 < rowEnd; k += 2)
+		{
+			sum2 = _mm256_add_ps(sum2, b3Mul8(A.values[k], v[A.columns[k]], A.values[k + 1], v[A.columns[k + 1]]));
+		}
+
+		__m128 sum = b3AddHalves(sum2);
+		if (k < rowEnd)
+		{
+			sum = _mm_add_ps(sum, b3Mul4(A.values[k], v[A.columns[k]]));
+		}
+
+		b3Store3(out[i], sum);
+	}
+#elif defined(B3_SIMD_SSE)
+	for (u32 i = begin; i < end; ++i)
+	{
+		__m128 sum = _mm_setzero_ps();
+
+		for (u32 k = A.rowPtrs[i]; k < A.rowPtrs[i + 1]; ++k)
+		{
+			sum = _mm_add_ps(sum, b3Mul4(A.values[k], v[A.columns[k]]));
+		}
+
+		b3Store3(out[i], sum);
+	}
+#else
+	for (u32 i = begin; i < end; ++i)
+	{
+		b3Vec3 sum;
+		sum.SetZero();
+
+		for (u32 k = A.rowPtrs[i]; k < A.rowPtrs[i + 1]; ++k)
+		{
+			sum += A.values[k] * v[A.columns[k]];
+		}
+
+		out[i] = sum;
+	}
+#endif
+}
+
+inline void b3Mul(b3DenseVec3& out, const b3BlockSparseMat33& A, const b3DenseVec3& v)
+{
+	b3Mul(out, A, v, 0, A.rowCount);
+}
+
+inline b3DenseVec3 operator*(const b3BlockSparseMat33& A, const b3DenseVec3& v)
+{
+	b3DenseVec3 result(v.n);
+	b3Mul(result, A, v);
+	return result;
+}
+
+#endif
\ No newline at end of file
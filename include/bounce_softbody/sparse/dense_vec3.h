@@ -23,15 +23,24 @@
 
 struct b3DenseVec3
 {
+	b3DenseVec3()
+	{
+		n = 0;
+		capacity = 0;
+		v = nullptr;
+	}
+
 	b3DenseVec3(u32 _n)
 	{
 		n = _n;
+		capacity = _n;
 		v = (b3Vec3*)b3Alloc(n * sizeof(b3Vec3));
 	}
 
 	b3DenseVec3(const b3DenseVec3& _v)
 	{
 		n = _v.n;
+		capacity = _v.n;
 		v = (b3Vec3*)b3Alloc(n * sizeof(b3Vec3));
 
 		Copy(_v);
@@ -39,7 +48,10 @@ struct b3DenseVec3
 
 	~b3DenseVec3()
 	{
-		b3Free(v);
+		if (v)
+		{
+			b3Free(v);
+		}
 	}
 
 	const b3Vec3& operator[](u32 i) const
@@ -61,20 +73,76 @@ struct b3DenseVec3
 			return *this;
 		}
 		
-		if (n == _v.n)
+		Resize(_v.n);
+		Copy(_v);
+
+		return *this;
+	}
+
+	void operator+=(const b3DenseVec3& _v)
+	{
+		B3_ASSERT(n == _v.n);
+		for (u32 i = 0; i < n; ++i)
 		{
-			Copy(_v);
-			return *this;
+			v[i] += _v.v[i];
 		}
+	}
 
-		b3Free(v);
+	void operator-=(const b3DenseVec3& _v)
+	{
+		B3_ASSERT(n == _v.n);
+		for (u32 i = 0; i < n; ++i)
+		{
+			v[i] -= _v.v[i];
+		}
+	}
 
-		n = _v.n;
-		v = (b3Vec3*)b3Alloc(n * sizeof(b3Vec3));
-		
-		Copy(_v);
+	void operator*=(scalar s)
+	{
+		for (u32 i = 0; i < n; ++i)
+		{
+			v[i] *= s;
+		}
+	}
 
-		return *this;
+	// Set the number of elements. 
+	// Memory is reallocated only if the number of elements exceeds the capacity.
+	// The values are undefined after a reallocation.
+	void Resize(u32 _n)
+	{
+		if (_n > capacity)
+		{
+			if (v)
+			{
+				b3Free(v);
+			}
+
+			capacity = _n;
+			v = (b3Vec3*)b3Alloc(capacity * sizeof(b3Vec3));
+		}
+
+		n = _n;
+	}
+
+	// Make room for a given number of elements. 
+	// This keeps the values of the elements.
+	void Reserve(u32 _capacity)
+	{
+		if (_capacity <= capacity)
+		{
+			return;
+		}
+
+		b3Vec3* oldV = v;
+		
+		capacity = _capacity;
+		v = (b3Vec3*)b3Alloc(capacity * sizeof(b3Vec3));
+		
+		if (oldV)
+		{
+			memcpy(v, oldV, n * sizeof(b3Vec3));
+			b3Free(oldV);
+		}
 	}
 
 	void Copy(const b3DenseVec3& _v)
@@ -111,6 +179,7 @@ struct b3DenseVec3
 
 	b3Vec3* v;
 	u32 n;
+	u32 capacity;
 };
 
 inline void b3Add(b3DenseVec3& out, const b3DenseVec3& a, const b3DenseVec3& b)
@@ -143,6 +212,18 @@ inline void b3Mul(b3DenseVec3& out, scalar a, const b3DenseVec3& b)
 	}
 }
 
+// out = a * x + y
+// The output can be one of the inputs.
+inline void b3Axpy(b3DenseVec3& out, scalar a, const b3DenseVec3& x, const b3DenseVec3& y)
+{
+	B3_ASSERT(out.n == x.n && x.n == y.n);
+
+	for (u32 i = 0; i < x.n; ++i)
+	{
+		out[i] = a * x[i] + y[i];
+	}
+}
+
 inline void b3Negate(b3DenseVec3& out, const b3DenseVec3& v)
 {
 	b3Mul(out, scalar(-1), v);
@@ -19,30 +19,39 @@
 #ifndef B3_DIAG_MAT_33_H
 #define B3_DIAG_MAT_33_H
 
-#include <bounce_softbody/common/math/mat33.h>
+#include <bounce_softbody/common/math/simd.h>
 #include <bounce_softbody/sparse/dense_vec3.h>
 
 // Diagonal matrix storing only the diagonal elements of the 
-// original matrix.
+// original matrix. The element array is padded for SIMD loads.
 struct b3DiagMat33
 {
+	b3DiagMat33()
+	{
+		n = 0;
+		v = nullptr;
+	}
+
 	b3DiagMat33(u32 _n)
 	{
 		n = _n;
-		v = (b3Mat33*)b3Alloc(n * sizeof(b3Mat33));
+		v = (b3Mat33*)b3Alloc(b3GetBlockArraySize(n));
 	}
 
 	b3DiagMat33(const b3DiagMat33& _v)
 	{
 		n = _v.n;
-		v = (b3Mat33*)b3Alloc(n * sizeof(b3Mat33));
+		v = (b3Mat33*)b3Alloc(b3GetBlockArraySize(n));
 
 		Copy(_v);
 	}
 
 	~b3DiagMat33()
 	{
-		b3Free(v);
+		if (v)
+		{
+			b3Free(v);
+		}
 	}
 
 	const b3Mat33& operator[](u32 i) const
@@ -70,16 +79,38 @@ struct b3DiagMat33
 			return *this;
 		}
 
-		b3Free(v);
+		if (v)
+		{
+			b3Free(v);
+		}
 
 		n = _v.n;
-		v = (b3Mat33*)b3Alloc(n * sizeof(b3Mat33));
+		v = (b3Mat33*)b3Alloc(b3GetBlockArraySize(n));
 
 		Copy(_v);
 
 		return *this;
 	}
 
+	// Set the number of elements. 
+	// Memory is reallocated only if the number of elements changes.
+	// The values are undefined after a reallocation.
+	void Resize(u32 _n)
+	{
+		if (n == _n)
+		{
+			return;
+		}
+
+		if (v)
+		{
+			b3Free(v);
+		}
+
+		n = _n;
+		v = (b3Mat33*)b3Alloc(b3GetBlockArraySize(n));
+	}
+
 	void Copy(const b3DiagMat33& _v)
 	{
 		B3_ASSERT(n == _v.n);
@@ -150,10 +181,30 @@ inline void b3Mul(b3DenseVec3& out, const b3DiagMat33& a, const b3DenseVec3& b)
 {
 	B3_ASSERT(out.n == a.n && a.n == b.n);
 
+#if defined(B3_SIMD_AVX2)
+	u32 i = 0;
+	for (; i + 1 < b.n; i += 2)
+	{
+		__m256 ab = b3Mul8(a[i], b[i], a[i + 1], b[i + 1]);
+		b3Store3(out[i], _mm256_castps256_ps128(ab));
+		b3Store3(out[i + 1], _mm256_extractf128_ps(ab, 1));
+	}
+
+	if (i < b.n)
+	{
+		b3Store3(out[i], b3Mul4(a[i], b[i]));
+	}
+#elif defined(B3_SIMD_SSE)
+	for (u32 i = 0; i < b.n; ++i)
+	{
+		b3Store3(out[i], b3Mul4(a[i], b[i]));
+	}
+#else
 	for (u32 i = 0; i < b.n; ++i)
 	{
 		out[i] = a[i] * b[i];
 	}
+#endif
 }
 
 inline void b3Negate(b3DiagMat33& out, const b3DiagMat33& v)
@@ -19,23 +19,25 @@
 #ifndef B3_SPARSE_FORCE_SOLVER_H
 #define B3_SPARSE_FORCE_SOLVER_H
 
-#include <bounce_softbody/common/settings.h>
+#include <bounce_softbody/sparse/block_sparse_mat33.h>
+#include <bounce_softbody/sparse/sparse_solver.h>
+#include <bounce_softbody/sparse/sparse_multigrid.h>
+#include <bounce_softbody/sparse/sparse_incomplete_cholesky.h>
+#include <bounce_softbody/sparse/sparse_ldlt.h>
 
-struct b3Vec3;
-struct b3Mat33;
-struct b3DenseVec3;
-struct b3DiagMat33;
-struct b3SparseMat33;
+struct b3Profile;
 
 // Output of force model.
+// The Jacobians share the sparsity pattern, so an index into the values of one 
+// is also an index into the values of the other.
 struct b3SparseForceSolverData
 {
 	scalar h, inv_h;
 	b3DenseVec3* x;
 	b3DenseVec3* v;
 	b3DenseVec3* f;
-	b3SparseMat33* dfdx;
-	b3SparseMat33* dfdv;
+	b3BlockSparseMat33* dfdx;
+	b3BlockSparseMat33* dfdv;
 };
 
 // An implementation for this class must provide forces and derivatives to the integrator.
@@ -48,6 +50,50 @@ public:
 	virtual void ComputeForces(const b3SparseForceSolverData* data) = 0;
 };
 
+// Storage kept by the Backward Euler integrator across iterations and time steps.
+// The Jacobians and the system matrix share a fixed sparsity pattern. 
+// The pattern must contain the diagonal blocks and every block written by the force model.
+// Only the values are reset on each iteration.
+// The system matrix is only allocated if it is assembled.
+// The multigrid hierarchy and the symbolic factorizations 
+// are built on first use and kept until the pattern changes.
+// The work vectors are reallocated only when the number of degrees of freedom changes.
+struct b3SolveBECache
+{
+	// Set the sparsity pattern of all matrices. Values are set to zero.
+	void Create(const b3SparseMat33& pattern)
+	{
+		dfdx.Create(pattern);
+		dfdv.Copy(dfdx);
+		A.Destroy();
+		lastDv.Resize(0);
+		multigrid.Destroy();
+		incompleteCholesky.Destroy();
+		ldlt.Destroy();
+	}
+
+	b3BlockSparseMat33 dfdx; // force Jacobian with respect to positions
+	b3BlockSparseMat33 dfdv; // force Jacobian with respect to velocities
+	b3BlockSparseMat33 A; // system matrix. This is not used in the matrix-free mode
+
+	b3DenseVec3 f; // internal forces
+	b3DenseVec3 b; // right hand side
+	b3DenseVec3 pb; // filtered right hand side
+	b3DenseVec3 dx; // position change for the right hand side
+	b3DenseVec3 t; // temporary product
+	b3DenseVec3 py; // sub-solver solution
+	b3DenseVec3 dv; // velocity change
+	b3DenseVec3 sp; // filtered direction for matrix-free products
+
+	b3DenseVec3 lastDv; // velocity change of the last step for warm starting
+	b3DenseVec3 coldPy; // sub-solver solution from a zero initial guess for comparison
+
+	b3SolveCGCache subCache; // sub-solver work vectors
+	b3SparseMultigrid multigrid; // sub-solver multigrid hierarchy
+	b3SparseIncompleteCholesky incompleteCholesky; // sub-solver incomplete Cholesky factorization
+	b3SparseLDLT ldlt; // direct solver factorization
+};
+
 // Input for Backward Euler integrator.
 struct b3SolveBEInput
 {
@@ -58,6 +104,14 @@ struct b3SolveBEInput
 		tolerance = B3_EPSILON;
 		maxSubIterations = 20;
 		subTolerance = B3_EPSILON;
+		adaptiveSubTolerance = false;
+		matrixFree = false;
+		threadPool = nullptr;
+		warmStart = false;
+		compareColdStart = false;
+		preconditioner = e_jacobiPreconditioner;
+		linearSolver = e_cgLinearSolver;
+		profile = nullptr;
 	}
 
 	scalar h; // time-step
@@ -65,6 +119,8 @@ struct b3SolveBEInput
 
 	b3SparseForceModel* forceModel; // force callback
 
+	b3SolveBECache* cache; // matrix storage with the Jacobian sparsity pattern
+
 	u32 dofCount; // number of degrees of freedom 
 
 	const b3DenseVec3* x0; // initial position x(t)
@@ -80,6 +136,20 @@ struct b3SolveBEInput
 	
 	u32 maxSubIterations; // max of inner iterations
 	scalar subTolerance; // inner tolerance. units: m^2/s^2
+	bool adaptiveSubTolerance; // loosen the inner tolerance while the outer error is large. The last outer iteration always uses the inner tolerance
+
+	bool matrixFree; // compute products with A from the Jacobians instead of assembling A
+
+	b3ThreadPool* threadPool; // optional worker threads for the sub-solver
+
+	bool warmStart; // use the velocity change of the last step as the initial guess of the sub-solver
+	bool compareColdStart; // also solve the first sub-problem from a zero initial guess to measure the saved iterations. This is slow
+
+	b3LinearSolverType linearSolver; // linear solver. LDLT falls back to CG in the matrix-free mode
+
+	b3PreconditionerType preconditioner; // sub-solver preconditioner. Multigrid and incomplete Cholesky fall back to block Jacobi in the matrix-free mode
+
+	b3Profile* profile; // optional phase times. These are only recorded if B3_ENABLE_PROFILE is defined
 };
 
 // Output of Backward Euler integrator.
@@ -91,6 +161,14 @@ struct b3SolveBEOutput
 	scalar error; // error
 	u32 minSubIterations; // min of inner iterations
 	u32 maxSubIterations; // max of inner iterations
+	u32 subIterations; // total number of inner iterations
+	i32 savedSubIterations; // inner iterations saved by warm starting. This is only computed if requested
+	u32 historyCapacity; // capacity of the history arrays
+	u32* subIterationHistory; // optional inner iterations of each outer iteration
+	scalar* errorHistory; // optional error of each outer iteration
+	scalar64 forceTime; // time spent computing forces and Jacobians in milliseconds
+	scalar64 assemblyTime; // time spent assembling the systems in milliseconds
+	scalar64 solveTime; // time spent solving the systems in milliseconds
 };
 
 // Integrate F = ma over [t, t + h] using Backward Euler.
@@ -0,0 +1,92 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_SPARSE_INCOMPLETE_CHOLESKY_H
+#define B3_SPARSE_INCOMPLETE_CHOLESKY_H
+
+#include <bounce_softbody/sparse/block_sparse_mat33.h>
+#include <bounce_softbody/sparse/diag_mat33.h>
+
+// A block incomplete Cholesky preconditioner with zero fill-in, IC(0).
+// The system matrix is factorized as A ~= U^T * D * U, where U is block unit 
+// upper triangular with the upper pattern of A and D is block diagonal.
+// The symbolic factorization is computed once per sparsity pattern. 
+// Only the numeric factorization is recomputed for each system.
+// The matrix must have a symmetric pattern that contains the diagonal blocks.
+class b3SparseIncompleteCholesky
+{
+public:
+	b3SparseIncompleteCholesky();
+	~b3SparseIncompleteCholesky();
+
+	// Compute the symbolic factorization from the sparsity pattern of a given matrix.
+	void Create(const b3BlockSparseMat33& A);
+
+	// Destroy the factorization.
+	void Destroy();
+
+	// Return the number of block rows or zero if the factorization is not created.
+	u32 GetRowCount() const;
+
+	// Compute the numeric factorization of a given matrix.
+	// The matrix must have the sparsity pattern used for creating the factorization.
+	// If the factorization breaks down then the diagonal is shifted until it succeeds.
+	// Return false if it still breaks down after the last shift. 
+	// Then the factorization must not be applied.
+	bool Update(const b3BlockSparseMat33& A);
+
+	// Return the diagonal shift used in the last factorization relative to the diagonal.
+	scalar GetShift() const;
+
+	// Solve U^T * D * U * out = r.
+	// The CG solver also applies this to the right hand side for the initial error.
+	void Apply(b3DenseVec3& out, const b3DenseVec3& r) const;
+private:
+	// Compute the numeric factorization of A + shift * diag(A).
+	// Return false if a pivot is not positive definite.
+	bool Factorize(const b3BlockSparseMat33& A, scalar shift);
+
+	// Upper triangular factor. The diagonal blocks hold D.
+	b3BlockSparseMat33 m_U;
+
+	// Inverse of D
+	b3DiagMat33 m_invD;
+
+	// Index of the diagonal block of each row of A.
+	u32* m_diagonals;
+
+	// Index in U updated by each pair of blocks in a row of U, or B3_MAX_U32 
+	// if the pair is outside the pattern and dropped. The pairs of a row start 
+	// at m_pairPtrs[row].
+	u32* m_pairPtrs;
+	u32* m_targets;
+
+	scalar m_shift;
+};
+
+inline u32 b3SparseIncompleteCholesky::GetRowCount() const
+{
+	return m_U.rowCount;
+}
+
+inline scalar b3SparseIncompleteCholesky::GetShift() const
+{
+	return m_shift;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,96 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_SPARSE_LDLT_H
+#define B3_SPARSE_LDLT_H
+
+#include <bounce_softbody/sparse/block_sparse_mat33.h>
+
+// A direct solver for symmetric positive definite 3x3 block systems.
+// The matrix is factorized as P * A * P^T = L * D * L^T, where P is a 
+// fill-reducing permutation, L is block unit lower triangular and D is 
+// block diagonal. The 3x3 blocks are the dense units of the factorization.
+// The ordering and the pattern of L are computed once per sparsity pattern. 
+// Only the numeric factorization is recomputed for each system.
+// This is intended for small and medium systems because L fills in.
+class b3SparseLDLT
+{
+public:
+	b3SparseLDLT();
+	~b3SparseLDLT();
+
+	// Compute the ordering and the symbolic factorization from the sparsity pattern of a given matrix.
+	// The matrix must have a symmetric pattern that contains the diagonal blocks.
+	void Create(const b3BlockSparseMat33& A);
+
+	// Destroy the factorization.
+	void Destroy();
+
+	// Return the number of block rows or zero if the factorization is not created.
+	u32 GetRowCount() const;
+
+	// Return the number of blocks in L below the diagonal.
+	u32 GetBlockCount() const;
+
+	// Compute the numeric factorization of a given matrix.
+	// The matrix must have the sparsity pattern used for creating the factorization.
+	void Factorize(const b3BlockSparseMat33& A);
+
+	// Solve A * x = b using the numeric factorization.
+	void Solve(b3DenseVec3& x, const b3DenseVec3& b);
+private:
+	// Compute a minimum degree ordering and the pattern of L.
+	void Order(const b3BlockSparseMat33& A);
+
+	u32 m_rowCount;
+
+	// Permutation. m_permutation[new index] = old index.
+	u32* m_permutation;
+	u32* m_inversePermutation;
+
+	// L in compressed block column format with sorted rows.
+	u32 m_blockCount;
+	u32* m_columnPtrs;
+	u32* m_rows;
+	b3Mat33* m_L;
+
+	// D and its inverse
+	b3Mat33* m_D;
+	b3Mat33* m_invD;
+
+	// Numeric factorization workspace
+	b3Mat33* m_work;
+	u32* m_next;
+	u32* m_heads;
+	u32* m_links;
+
+	// Permuted solution
+	b3DenseVec3 m_y;
+};
+
+inline u32 b3SparseLDLT::GetRowCount() const
+{
+	return m_rowCount;
+}
+
+inline u32 b3SparseLDLT::GetBlockCount() const
+{
+	return m_blockCount;
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,129 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B3_SPARSE_MULTIGRID_H
+#define B3_SPARSE_MULTIGRID_H
+
+#include <bounce_softbody/sparse/block_sparse_mat33.h>
+#include <bounce_softbody/sparse/diag_mat33.h>
+
+// Maximum number of levels in a multigrid hierarchy.
+#define B3_MAX_MULTIGRID_LEVELS 16
+
+// Levels with at most this number of block rows are solved directly.
+#define B3_MULTIGRID_COARSE_SIZE 64
+
+// A level in a multigrid hierarchy.
+struct b3MultigridLevel
+{
+	const b3BlockSparseMat33* A; // operator. This points to the input matrix on the finest level
+	b3BlockSparseMat33 coarseA; // operator storage on the coarse levels
+	b3DiagMat33 invD; // inverse diagonal blocks of the operator
+	u32* diagonals; // index of the diagonal block of each row of the operator
+	
+	// These are only used if there is a coarser level.
+	b3BlockSparseMat33 P; // smoothed prolongator from the coarser level
+	b3BlockSparseMat33 AP; // A * P
+	u32* aggregates; // aggregate of each row
+	scalar* weights; // tentative prolongator value of each row
+
+	// Indices of the blocks updated while computing the operators, so that 
+	// the numeric update doesn't search the patterns. The products are 
+	// stored in the order they are computed.
+	u32* tentativeSlots; // index in P of the tentative block of each row
+	u32* prolongatorSlots; // index in P updated by each block of A
+	u32* productSlots; // index in A * P updated by each product of a block of A and a block of P
+	u32* galerkinSlots; // index in the coarse operator updated by each product of a block of P and a block of A * P
+
+	b3DenseVec3 x; // solution
+	b3DenseVec3 b; // right hand side
+	b3DenseVec3 r; // residual
+};
+
+// A smoothed aggregation algebraic multigrid preconditioner for the 3x3 block systems.
+// See "Smoothed aggregation multigrid for cloth simulation", Tamstorf et al.
+// The aggregates are built from the sparsity pattern of the system matrix, 
+// that is, from the particle graph. The near null space is spanned by the 
+// translations, so every coarse level is also a 3x3 block matrix.
+// The hierarchy is built once per sparsity pattern. Only the numeric values 
+// of the operators are recomputed for each system.
+class b3SparseMultigrid
+{
+public:
+	b3SparseMultigrid();
+	~b3SparseMultigrid();
+
+	// Build the hierarchy from the sparsity pattern of a given matrix.
+	void Create(const b3BlockSparseMat33& A);
+
+	// Destroy the hierarchy.
+	void Destroy();
+
+	// Return the number of block rows of the finest level or zero if the hierarchy is not built.
+	u32 GetRowCount() const;
+
+	// Return the number of levels.
+	u32 GetLevelCount() const;
+
+	// Compute the operators of all levels from a given matrix.
+	// The matrix must have the sparsity pattern used for building the hierarchy.
+	// It must be kept alive while the preconditioner is applied.
+	void Update(const b3BlockSparseMat33& A);
+
+	// Apply a V-cycle to a given residual, that is, out ~= A^-1 * r.
+	void Apply(b3DenseVec3& out, const b3DenseVec3& r);
+private:
+	// Compute the aggregates of a level and return the number of aggregates.
+	u32 Aggregate(b3MultigridLevel* level);
+
+	// Create the sparsity patterns of the prolongator of a level and the operator of the next level.
+	void CreateProlongator(b3MultigridLevel* level, u32 coarseCount);
+
+	// Factorize the operator of the coarsest level.
+	void Factorize();
+
+	// Solve the system of the coarsest level.
+	void SolveCoarse(b3DenseVec3& x, const b3DenseVec3& b);
+
+	// Run a V-cycle on a given level.
+	void Cycle(u32 index, b3DenseVec3& x, const b3DenseVec3& b);
+
+	b3MultigridLevel m_levels[B3_MAX_MULTIGRID_LEVELS];
+	u32 m_levelCount;
+
+	// Dense Cholesky factor of the coarsest operator. 
+	// This is null if the coarsest level is too large.
+	scalar* m_factor;
+	u32 m_factorSize;
+};
+
+inline u32 b3SparseMultigrid::GetRowCount() const
+{
+	if (m_levelCount == 0)
+	{
+		return 0;
+	}
+	return m_levels[0].r.n;
+}
+
+inline u32 b3SparseMultigrid::GetLevelCount() const
+{
+	return m_levelCount;
+}
+
+#endif
\ No newline at end of file
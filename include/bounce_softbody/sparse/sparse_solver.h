@@ -19,18 +19,76 @@
 #ifndef B3_SPARSE_SOLVER_H
 #define B3_SPARSE_SOLVER_H
 
-#include <bounce_softbody/common/settings.h>
+#include <bounce_softbody/sparse/diag_mat33.h>
+#include <bounce_softbody/common/template/array.h>
 
-struct b3DenseVec3;
-struct b3SparseMat33;
+// Number of rows processed by a thread at a time.
+// Reductions are summed per chunk and then pairwise in a fixed order,
+// so changing this changes the rounding of the results.
+#define B3_SOLVER_CHUNK_SIZE 256
+
+struct b3BlockSparseMat33;
+class b3ThreadPool;
+class b3SparseMultigrid;
+class b3SparseIncompleteCholesky;
+
+// Preconditioner types for the CG solver.
+enum b3PreconditionerType
+{
+	e_jacobiPreconditioner, // inverse of the diagonal entries
+	e_blockJacobiPreconditioner, // inverse of the 3x3 diagonal blocks
+	e_multigridPreconditioner, // smoothed aggregation multigrid V-cycle. This requires an assembled matrix
+	e_incompleteCholeskyPreconditioner, // block incomplete Cholesky factorization. This requires an assembled matrix
+};
+
+// Linear solver types for the Newton iterations.
+enum b3LinearSolverType
+{
+	e_cgLinearSolver, // preconditioned conjugate gradient
+	e_ldltLinearSolver, // direct sparse LDLT. This requires an assembled matrix
+};
+
+// A symmetric positive-definite linear operator for the matrix-free CG solver.
+// Use this when the system matrix is not stored explicitly.
+class b3SparseOperator
+{
+public:
+	// Return the number of block rows.
+	virtual u32 GetRowCount() const = 0;
+
+	// Compute out = A * x.
+	virtual void Multiply(b3DenseVec3& out, const b3DenseVec3& x) const = 0;
+
+	// Get the diagonal blocks of A.
+	virtual void GetDiagonal(b3DiagMat33& out) const = 0;
+};
+
+// Work vectors kept by the CG solver across calls.
+// Memory is reallocated only when the system size changes.
+struct b3SolveCGCache
+{
+	b3DiagMat33 invP; // inverse preconditioner
+	b3DenseVec3 r; // residual
+	b3DenseVec3 c; // search direction
+	b3DenseVec3 q; // A * c
+	b3DenseVec3 s; // preconditioned residual
+	b3StackArray<scalar, 256> partials; // partial sums of the reductions
+};
 
 // Input for CG solver.
 struct b3SolveCGInput
 {
-	const b3SparseMat33* A; // A in Ax = b
+	const b3BlockSparseMat33* A; // A in Ax = b. If this is null then op is used
+	const b3SparseOperator* op; // A in Ax = b for the matrix-free mode
 	const b3DenseVec3* b; // b in Ax = b
 	u32 maxIterations; // maximum CG iterations
-	scalar tolerance; // allowed error
+	scalar tolerance; // allowed preconditioned residual r^T * P^-1 * r relative to b^T * P * b for the Jacobi preconditioners and to b^T * P^-1 * b for the others
+	scalar residualTolerance; // allowed preconditioned residual relative to the initial one. Zero to disable
+	b3SolveCGCache* cache; // work vectors
+	b3ThreadPool* threadPool; // optional worker threads
+	b3PreconditionerType preconditioner; // preconditioner type
+	b3SparseMultigrid* multigrid; // hierarchy built from the pattern of A for the multigrid preconditioner
+	b3SparseIncompleteCholesky* incompleteCholesky; // symbolic factorization of A for the incomplete Cholesky preconditioner
 };
 
 // Output of CG solver.
@@ -38,12 +96,14 @@ struct b3SolveCGOutput
 {
 	b3DenseVec3* x; // solution. it must be initialized with an initial guess.
 	u32 iterations; // number of CG iterations
-	scalar error; // error
+	scalar error; // preconditioned residual r^T * P^-1 * r
 };
 
 // Solve Ax = b using a preconditioned Conjugate Gradient method.
 // The system matrix A must be a positive-definite matrix.
-// This solver uses Jacobi preconditioner.
+// The preconditioner is selected in the input.
+// If the incomplete Cholesky factorization of A fails then the block Jacobi 
+// preconditioner is used for this system.
 bool b3SparseSolveCG(b3SolveCGOutput* output, const b3SolveCGInput* input);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,109 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <bounce_softbody/bounce_softbody.h>
+#include <bounce_softbody/sparse/block_sparse_mat33.h>
+#include <bounce_softbody/sparse/diag_mat33.h>
+#include <bounce_softbody/sparse/sparse_solver.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+// Benchmark settings shared by all suites.
+struct Settings
+{
+	u32 gridSize; // number of nodes along a side of the sparse test grid
+	u32 elementCount; // number of forces of each type
+	u32 repetitions; // number of calls per batch
+	u32 batches; // number of timed batches. The median batch is reported
+	u32 threadCount; // number of threads of the bodies
+};
+
+// Random numbers are generated from a fixed seed so runs are repeatable.
+inline scalar RandomScalar()
+{
+	return scalar(rand()) / scalar(RAND_MAX) - scalar(0.5);
+}
+
+inline b3Vec3 RandomVec3()
+{
+	return b3Vec3(RandomScalar(), RandomScalar(), RandomScalar());
+}
+
+inline b3Mat33 RandomMat33()
+{
+	return b3Mat33(RandomVec3(), RandomVec3(), RandomVec3());
+}
+
+inline scalar MaxDifference(const b3DenseVec3& a, const b3DenseVec3& b)
+{
+	scalar result = scalar(0);
+	for (u32 i = 0; i < a.n; ++i)
+	{
+		b3Vec3 d = a[i] - b[i];
+		result = b3Max(result, b3Max(b3Abs(d.x), b3Max(b3Abs(d.y), b3Abs(d.z))));
+	}
+	return result;
+}
+
+#define MAX_BATCHES 64
+
+// Return the time of the given function in milliseconds per call.
+// The function is called once to warm up the caches. Then the calls are timed 
+// in batches and the median batch is taken, which is robust against interruptions.
+template<class T>
+inline double Time(T& function, const Settings& settings)
+{
+	function();
+
+	u32 batchCount = b3Min(b3Max(settings.batches, 1u), u32(MAX_BATCHES));
+	u32 repetitions = b3Max(settings.repetitions, 1u);
+
+	double times[MAX_BATCHES];
+	for (u32 i = 0; i < batchCount; ++i)
+	{
+		b3Timer timer;
+		for (u32 j = 0; j < repetitions; ++j)
+		{
+			function();
+		}
+		times[i] = timer.GetMilliseconds() / double(repetitions);
+	}
+
+	std::sort(times, times + batchCount);
+
+	return times[batchCount / 2];
+}
+
+// Build a pattern coupling each node of a N x N grid with its 3x3 neighborhood as in a cloth.
+// The blocks are random.
+void BuildGridMatrix(b3SparseMat33& out, u32 N);
+
+void RunSparseBenchmarks(const Settings& settings);
+
+void RunDenseBenchmarks(const Settings& settings);
+
+void RunSolverBenchmarks(const Settings& settings);
+
+void RunForceBenchmarks(const Settings& settings);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,111 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "benchmark.h"
+
+// Measures the dense vector operations used by the solvers.
+
+enum DenseOperation
+{
+	e_copy,
+	e_setZero,
+	e_add,
+	e_sub,
+	e_scale,
+	e_axpy,
+	e_addAssign,
+	e_dot,
+	e_lengthSquared,
+};
+
+static volatile scalar s_sink;
+
+struct DenseKernel
+{
+	void operator()()
+	{
+		switch (operation)
+		{
+		case e_copy: out->Copy(*a); break;
+		case e_setZero: out->SetZero(); break;
+		case e_add: b3Add(*out, *a, *b); break;
+		case e_sub: b3Sub(*out, *a, *b); break;
+		case e_scale: b3Mul(*out, s, *a); break;
+		case e_axpy: b3Axpy(*out, s, *a, *b); break;
+		case e_addAssign: *out += *a; break;
+		case e_dot: s_sink = b3Dot(*a, *b); break;
+		case e_lengthSquared: s_sink = b3LengthSquared(*a); break;
+		default: break;
+		}
+	}
+
+	DenseOperation operation;
+	scalar s;
+	const b3DenseVec3* a;
+	const b3DenseVec3* b;
+	b3DenseVec3* out;
+};
+
+void RunDenseBenchmarks(const Settings& settings)
+{
+	srand(0);
+
+	u32 n = settings.gridSize * settings.gridSize;
+
+	b3DenseVec3 a(n), b(n), out(n);
+	for (u32 i = 0; i < n; ++i)
+	{
+		a[i] = RandomVec3();
+		b[i] = RandomVec3();
+	}
+
+	printf("dense: rows: %u\n", n);
+
+	struct Entry
+	{
+		const char* name;
+		DenseOperation operation;
+	};
+
+	const Entry entries[] =
+	{
+		{ "copy", e_copy },
+		{ "set zero", e_setZero },
+		{ "add", e_add },
+		{ "sub", e_sub },
+		{ "scale", e_scale },
+		{ "axpy", e_axpy },
+		{ "add assign", e_addAssign },
+		{ "dot", e_dot },
+		{ "length squared", e_lengthSquared },
+	};
+
+	for (u32 i = 0; i < sizeof(entries) / sizeof(Entry); ++i)
+	{
+		DenseKernel kernel;
+		kernel.operation = entries[i].operation;
+		kernel.s = scalar(0.5);
+		kernel.a = &a;
+		kernel.b = &b;
+		kernel.out = &out;
+
+		double ms = Time(kernel, settings);
+
+		printf("%-22s %10.3f ms %10.2f ns/row\n", entries[i].name, ms, 1.0e6 * ms / double(n));
+	}
+}
\ No newline at end of file
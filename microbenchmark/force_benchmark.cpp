@@ -0,0 +1,318 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "benchmark.h"
+
+// Measures the force and Jacobian evaluation of each force type.
+// b3Force::ComputeForces is not public, so each force type is evaluated by stepping a body 
+// that only contains forces of that type and reading the force time from the solver statistics.
+// The time of a body with the same particles and no forces is subtracted. 
+// This removes the cost of clearing the Jacobians and of the particle forces.
+
+// Return the smallest grid side such that a cloth grid has the given number of triangles.
+static u32 GetClothSide(u32 triangleCount)
+{
+	u32 N = 2;
+	while (2 * (N - 1) * (N - 1) < triangleCount)
+	{
+		++N;
+	}
+	return N;
+}
+
+// Return the smallest grid side such that a grid of cubes split in six tetrahedra has the given number of tetrahedra.
+static u32 GetTetSide(u32 tetrahedronCount)
+{
+	u32 N = 2;
+	while (6 * (N - 1) * (N - 1) * (N - 1) < tetrahedronCount)
+	{
+		++N;
+	}
+	return N;
+}
+
+// Create a grid of dynamic particles and return the rest positions.
+static void CreateParticles(b3Body* body, b3Particle** particles, b3Vec3* positions, u32 countX, u32 countY, u32 countZ)
+{
+	for (u32 i = 0; i < countX; ++i)
+	{
+		for (u32 j = 0; j < countY; ++j)
+		{
+			for (u32 k = 0; k < countZ; ++k)
+			{
+				u32 index = (i * countY + j) * countZ + k;
+
+				b3ParticleDef pd;
+				pd.type = e_dynamicParticle;
+				pd.position.Set(scalar(i), scalar(j), scalar(k));
+
+				positions[index] = pd.position;
+				particles[index] = body->CreateParticle(pd);
+			}
+		}
+	}
+}
+
+// Move the particles away from the rest state so the forces are non-zero.
+static void Perturb(b3Particle** particles, const b3Vec3* positions, u32 count)
+{
+	for (u32 i = 0; i < count; ++i)
+	{
+		particles[i]->SetPosition(positions[i] + scalar(0.2) * RandomVec3());
+	}
+}
+
+static void CreateClothForces(b3Body* body, b3ForceType type, b3Particle** particles, const b3Vec3* positions, u32 N, u32 count)
+{
+	u32 created = 0;
+	for (u32 i = 0; i + 1 < N && created < count; ++i)
+	{
+		for (u32 j = 0; j + 1 < N && created < count; ++j)
+		{
+			u32 v1 = i * N + j;
+			u32 v2 = (i + 1) * N + j;
+			u32 v3 = (i + 1) * N + j + 1;
+			u32 v4 = i * N + j + 1;
+
+			// Each cell is split in two triangles. The springs are the edges of the cell and a diagonal.
+			u32 triangles[2][3] = { { v1, v2, v3 }, { v3, v4, v1 } };
+			u32 edges[3][2] = { { v1, v2 }, { v1, v4 }, { v1, v3 } };
+
+			u32 elementCount = type == e_springForce ? 3 : 2;
+			for (u32 k = 0; k < elementCount && created < count; ++k, ++created)
+			{
+				if (type == e_springForce)
+				{
+					b3Particle* p1 = particles[edges[k][0]];
+					b3Particle* p2 = particles[edges[k][1]];
+
+					b3SpringForceDef def;
+					def.Initialize(p1, p2, scalar(1000), scalar(10));
+
+					body->CreateForce(def);
+					continue;
+				}
+
+				u32 i1 = triangles[k][0], i2 = triangles[k][1], i3 = triangles[k][2];
+
+				if (type == e_stretchForce)
+				{
+					b3StretchForceDef def;
+					def.p1 = particles[i1];
+					def.p2 = particles[i2];
+					def.p3 = particles[i3];
+					def.Initialize(positions[i1], positions[i2], positions[i3]);
+					def.stiffness_u = scalar(1000);
+					def.damping_stiffness_u = scalar(10);
+					def.stiffness_v = scalar(1000);
+					def.damping_stiffness_v = scalar(10);
+
+					body->CreateForce(def);
+				}
+				else if (type == e_shearForce)
+				{
+					b3ShearForceDef def;
+					def.p1 = particles[i1];
+					def.p2 = particles[i2];
+					def.p3 = particles[i3];
+					def.Initialize(positions[i1], positions[i2], positions[i3]);
+					def.stiffness = scalar(1000);
+					def.dampingStiffness = scalar(10);
+
+					body->CreateForce(def);
+				}
+				else
+				{
+					b3TriangleElementForceDef def;
+					def.p1 = particles[i1];
+					def.p2 = particles[i2];
+					def.p3 = particles[i3];
+					def.v1 = positions[i1];
+					def.v2 = positions[i2];
+					def.v3 = positions[i3];
+					def.stiffnessDamping = scalar(0.01);
+
+					body->CreateForce(def);
+				}
+			}
+		}
+	}
+}
+
+static void CreateTetrahedronForces(b3Body* body, b3Particle** particles, const b3Vec3* positions, u32 N, u32 count)
+{
+	// Split each cube along the main diagonal from corner 0 to corner 7.
+	// Corner c has the offsets (c & 1, (c >> 1) & 1, (c >> 2) & 1).
+	const u32 tetrahedra[6][4] = 
+	{
+		{ 0, 1, 3, 7 }, { 0, 5, 1, 7 }, { 0, 3, 2, 7 },
+		{ 0, 2, 6, 7 }, { 0, 4, 5, 7 }, { 0, 6, 4, 7 }
+	};
+
+	u32 created = 0;
+	for (u32 i = 0; i + 1 < N && created < count; ++i)
+	{
+		for (u32 j = 0; j + 1 < N && created < count; ++j)
+		{
+			for (u32 k = 0; k + 1 < N && created < count; ++k)
+			{
+				u32 corners[8];
+				for (u32 c = 0; c < 8; ++c)
+				{
+					u32 ci = i + (c & 1);
+					u32 cj = j + ((c >> 1) & 1);
+					u32 ck = k + ((c >> 2) & 1);
+					corners[c] = (ci * N + cj) * N + ck;
+				}
+
+				for (u32 t = 0; t < 6 && created < count; ++t, ++created)
+				{
+					u32 i1 = corners[tetrahedra[t][0]];
+					u32 i2 = corners[tetrahedra[t][1]];
+					u32 i3 = corners[tetrahedra[t][2]];
+					u32 i4 = corners[tetrahedra[t][3]];
+
+					b3TetrahedronElementForceDef def;
+					def.p1 = particles[i1];
+					def.p2 = particles[i2];
+					def.p3 = particles[i3];
+					def.p4 = particles[i4];
+					def.v1 = positions[i1];
+					def.v2 = positions[i2];
+					def.v3 = positions[i3];
+					def.v4 = positions[i4];
+					def.stiffnessDamping = scalar(0.01);
+
+					body->CreateForce(def);
+				}
+			}
+		}
+	}
+}
+
+// Return the median force time of a step in milliseconds.
+// The sub-solver is disabled so the particles stay in the same state.
+static double TimeForces(b3Body* body, const Settings& settings)
+{
+	const scalar dt = scalar(1) / scalar(60);
+
+	body->Step(dt, 1, 0);
+
+	u32 batchCount = b3Min(b3Max(settings.batches, 1u), u32(MAX_BATCHES));
+	u32 repetitions = b3Max(settings.repetitions, 1u);
+
+	double times[MAX_BATCHES];
+	for (u32 i = 0; i < batchCount; ++i)
+	{
+		double sum = 0.0;
+		for (u32 j = 0; j < repetitions; ++j)
+		{
+			body->Step(dt, 1, 0);
+			sum += body->GetSolverStats().forceTime;
+		}
+		times[i] = sum / double(repetitions);
+	}
+
+	std::sort(times, times + batchCount);
+
+	return times[batchCount / 2];
+}
+
+static double TimeForces(b3ForceType type, u32 count, const Settings& settings)
+{
+	bool tetrahedra = type == e_tetrahedronElementForce;
+	
+	u32 N = tetrahedra ? GetTetSide(count) : GetClothSide(count);
+	u32 particleCount = tetrahedra ? N * N * N : N * N;
+
+	b3Particle** particles = (b3Particle**)b3Alloc(particleCount * sizeof(b3Particle*));
+	b3Vec3* positions = (b3Vec3*)b3Alloc(particleCount * sizeof(b3Vec3));
+
+	// Time the particles alone first.
+	double baseline;
+	{
+		srand(0);
+
+		b3Body body;
+		body.SetGravity(b3Vec3_zero);
+		body.SetThreadCount(settings.threadCount);
+
+		CreateParticles(&body, particles, positions, N, N, tetrahedra ? N : 1);
+		Perturb(particles, positions, particleCount);
+
+		baseline = TimeForces(&body, settings);
+	}
+
+	double result;
+	{
+		srand(0);
+
+		b3Body body;
+		body.SetGravity(b3Vec3_zero);
+		body.SetThreadCount(settings.threadCount);
+
+		CreateParticles(&body, particles, positions, N, N, tetrahedra ? N : 1);
+
+		if (tetrahedra)
+		{
+			CreateTetrahedronForces(&body, particles, positions, N, count);
+		}
+		else
+		{
+			CreateClothForces(&body, type, particles, positions, N, count);
+		}
+
+		Perturb(particles, positions, particleCount);
+
+		result = TimeForces(&body, settings);
+	}
+
+	b3Free(positions);
+	b3Free(particles);
+
+	return b3Max(result - baseline, 0.0);
+}
+
+void RunForceBenchmarks(const Settings& settings)
+{
+	u32 count = settings.elementCount;
+
+	printf("forces: elements: %u\n", count);
+
+	struct Entry
+	{
+		const char* name;
+		b3ForceType type;
+	};
+
+	const Entry entries[] =
+	{
+		{ "stretch", e_stretchForce },
+		{ "shear", e_shearForce },
+		{ "spring", e_springForce },
+		{ "triangle element", e_triangleElementForce },
+		{ "tetrahedron element", e_tetrahedronElementForce },
+	};
+
+	for (u32 i = 0; i < sizeof(entries) / sizeof(Entry); ++i)
+	{
+		double ms = TimeForces(entries[i].type, count, settings);
+
+		printf("%-22s %10.3f ms %10.2f ns/element\n", entries[i].name, ms, 1.0e6 * ms / double(count));
+	}
+}
\ No newline at end of file
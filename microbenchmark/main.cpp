@@ -0,0 +1,143 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "benchmark.h"
+
+#include <string.h>
+
+// Isolated benchmarks of the hot kernels. 
+// Each suite prints the median time of a call over several batches.
+// All inputs are generated from a fixed seed so runs are repeatable.
+
+static void PrintUsage()
+{
+	printf("usage: microbenchmark [suite...] [options]\n");
+	printf("suites: sparse dense cg forces all (default)\n");
+	printf("options:\n");
+	printf("  --size <n>         nodes along a side of the sparse test grid (default 256)\n");
+	printf("  --elements <n>     number of forces of each type (default 100000)\n");
+	printf("  --repetitions <n>  calls per batch (default 10)\n");
+	printf("  --batches <n>      timed batches. The median is reported (default 5)\n");
+	printf("  --threads <n>      threads for the force evaluation (default 1)\n");
+}
+
+int main(int argc, char** argv)
+{
+	Settings settings;
+	settings.gridSize = 256;
+	settings.elementCount = 100000;
+	settings.repetitions = 10;
+	settings.batches = 5;
+	settings.threadCount = 1;
+
+	bool sparse = false;
+	bool dense = false;
+	bool cg = false;
+	bool forces = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+
+		if (strcmp(arg, "--size") == 0 && i + 1 < argc)
+		{
+			settings.gridSize = atoi(argv[++i]);
+		}
+		else if (strcmp(arg, "--elements") == 0 && i + 1 < argc)
+		{
+			settings.elementCount = atoi(argv[++i]);
+		}
+		else if (strcmp(arg, "--repetitions") == 0 && i + 1 < argc)
+		{
+			settings.repetitions = atoi(argv[++i]);
+		}
+		else if (strcmp(arg, "--batches") == 0 && i + 1 < argc)
+		{
+			settings.batches = atoi(argv[++i]);
+		}
+		else if (strcmp(arg, "--threads") == 0 && i + 1 < argc)
+		{
+			settings.threadCount = atoi(argv[++i]);
+		}
+		else if (strcmp(arg, "--help") == 0)
+		{
+			PrintUsage();
+			return 0;
+		}
+		else if (strcmp(arg, "sparse") == 0)
+		{
+			sparse = true;
+		}
+		else if (strcmp(arg, "dense") == 0)
+		{
+			dense = true;
+		}
+		else if (strcmp(arg, "cg") == 0)
+		{
+			cg = true;
+		}
+		else if (strcmp(arg, "forces") == 0)
+		{
+			forces = true;
+		}
+		else if (strcmp(arg, "all") == 0)
+		{
+			sparse = dense = cg = forces = true;
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (!sparse && !dense && !cg && !forces)
+	{
+		sparse = dense = cg = forces = true;
+	}
+
+	if (settings.gridSize < 2 || settings.elementCount == 0 || settings.threadCount == 0)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	printf("repetitions: %u batches: %u threads: %u\n", settings.repetitions, settings.batches, settings.threadCount);
+
+	if (sparse)
+	{
+		RunSparseBenchmarks(settings);
+	}
+
+	if (dense)
+	{
+		RunDenseBenchmarks(settings);
+	}
+
+	if (cg)
+	{
+		RunSolverBenchmarks(settings);
+	}
+
+	if (forces)
+	{
+		RunForceBenchmarks(settings);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,166 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "benchmark.h"
+#include <bounce_softbody/sparse/sparse_multigrid.h>
+#include <bounce_softbody/sparse/sparse_incomplete_cholesky.h>
+
+// Measures the CG solver on a synthetic symmetric positive-definite system.
+// The system has the structure of an implicit cloth step: a mass diagonal plus 
+// a stiffness matrix built from rank one springs between the grid neighbors.
+
+static void BuildSystem(b3SparseMat33& out, u32 N, scalar mass, scalar stiffness)
+{
+	u32 n = N * N;
+	B3_ASSERT(out.rowCount == n);
+
+	for (u32 i = 0; i < n; ++i)
+	{
+		out(i, i) = b3Mat33Diagonal(mass);
+	}
+
+	for (u32 i = 0; i < N; ++i)
+	{
+		for (u32 j = 0; j < N; ++j)
+		{
+			u32 row = i * N + j;
+
+			// Couple with the forward half of the 3x3 neighborhood once.
+			const u32 offsets[4][2] = { { 0, 1 }, { 1, 0 }, { 1, 1 }, { 1, u32(-1) } };
+			for (u32 k = 0; k < 4; ++k)
+			{
+				u32 ni = i + offsets[k][0];
+				u32 nj = j + offsets[k][1];
+				if (ni >= N || nj >= N)
+				{
+					continue;
+				}
+
+				u32 column = ni * N + nj;
+
+				b3Vec3 d = RandomVec3();
+				d.Normalize();
+
+				b3Mat33 K = stiffness * b3Outer(d, d);
+
+				out(row, row) += K;
+				out(column, column) += K;
+				out(row, column) -= K;
+				out(column, row) -= K;
+			}
+		}
+	}
+}
+
+struct SolverKernel
+{
+	void operator()()
+	{
+		x->SetZero();
+
+		b3SolveCGOutput output;
+		output.x = x;
+
+		b3SparseSolveCG(&output, input);
+
+		iterations = output.iterations;
+	}
+
+	const b3SolveCGInput* input;
+	b3DenseVec3* x;
+	u32 iterations;
+};
+
+void RunSolverBenchmarks(const Settings& settings)
+{
+	srand(0);
+
+	u32 N = settings.gridSize;
+	u32 n = N * N;
+
+	b3SparseMat33 system(n);
+	BuildSystem(system, N, scalar(1), scalar(100));
+
+	b3BlockSparseMat33 A(system);
+
+	b3DenseVec3 b(n);
+	for (u32 i = 0; i < n; ++i)
+	{
+		b[i] = RandomVec3();
+	}
+
+	b3DenseVec3 x(n);
+
+	b3SolveCGCache cache;
+
+	b3SparseMultigrid multigrid;
+	multigrid.Create(A);
+
+	b3SparseIncompleteCholesky incompleteCholesky;
+	incompleteCholesky.Create(A);
+
+	printf("cg: rows: %u blocks: %u\n", n, A.blockCount);
+
+	// A solve is long enough to be timed on its own.
+	Settings solverSettings = settings;
+	solverSettings.repetitions = 1;
+
+	struct Entry
+	{
+		const char* name;
+		b3PreconditionerType preconditioner;
+	};
+
+	const Entry entries[] =
+	{
+		{ "cg jacobi", e_jacobiPreconditioner },
+		{ "cg block jacobi", e_blockJacobiPreconditioner },
+		{ "cg multigrid", e_multigridPreconditioner },
+		{ "cg incomplete cholesky", e_incompleteCholeskyPreconditioner },
+	};
+
+	for (u32 i = 0; i < sizeof(entries) / sizeof(Entry); ++i)
+	{
+		b3SolveCGInput input;
+		input.A = &A;
+		input.op = nullptr;
+		input.b = &b;
+		input.maxIterations = 1000;
+		input.tolerance = scalar(0);
+		input.residualTolerance = scalar(1.0e-3);
+		input.cache = &cache;
+		input.threadPool = nullptr;
+		input.preconditioner = entries[i].preconditioner;
+		input.multigrid = &multigrid;
+		input.incompleteCholesky = &incompleteCholesky;
+
+		SolverKernel kernel;
+		kernel.input = &input;
+		kernel.x = &x;
+		kernel.iterations = 0;
+
+		double ms = Time(kernel, solverSettings);
+
+		b3DenseVec3 r(n);
+		b3Mul(r, A, x);
+		r -= b;
+
+		printf("%-22s %10.3f ms %10.3f ms/iteration  iterations: %4u  residual: %g\n", 
+			entries[i].name, ms, ms / double(b3Max(kernel.iterations, 1u)), kernel.iterations, b3Length(r) / b3Length(b));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,287 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "benchmark.h"
+
+// Measures the sparse matrix kernels. The block products are compared against the plain scalar code.
+
+static const char* GetInstructionSet()
+{
+#if defined(B3_SIMD_AVX2)
+	return "AVX2";
+#elif defined(B3_SIMD_SSE)
+	return "SSE";
+#else
+	return "scalar";
+#endif
+}
+
+void BuildGridMatrix(b3SparseMat33& out, u32 N)
+{
+	B3_ASSERT(out.rowCount == N * N);
+
+	for (u32 i = 0; i < N; ++i)
+	{
+		for (u32 j = 0; j < N; ++j)
+		{
+			u32 row = i * N + j;
+			for (u32 di = 0; di < 3; ++di)
+			{
+				for (u32 dj = 0; dj < 3; ++dj)
+				{
+					u32 ni = i + di - 1;
+					u32 nj = j + dj - 1;
+					if (ni < N && nj < N)
+					{
+						out(row, ni * N + nj) = RandomMat33();
+					}
+				}
+			}
+		}
+	}
+}
+
+// The scalar product one block at a time.
+static void ScalarMul(b3DenseVec3& out, const b3BlockSparseMat33& A, const b3DenseVec3& v)
+{
+	for (u32 i = 0; i < A.rowCount; ++i)
+	{
+		b3Vec3 sum;
+		sum.SetZero();
+
+		for (u32 k = A.rowPtrs[i]; k < A.rowPtrs[i + 1]; ++k)
+		{
+			sum += A.values[k] * v[A.columns[k]];
+		}
+
+		out[i] = sum;
+	}
+}
+
+static void ScalarMul(b3DenseVec3& out, const b3DiagMat33& A, const b3DenseVec3& v)
+{
+	for (u32 i = 0; i < A.n; ++i)
+	{
+		out[i] = A[i] * v[i];
+	}
+}
+
+// Build a new matrix through operator(), as the force solver does for the sparsity pattern.
+struct AssemblyKernel
+{
+	void operator()()
+	{
+		b3SparseMat33 A(N * N);
+
+		for (u32 i = 0; i < N; ++i)
+		{
+			for (u32 j = 0; j < N; ++j)
+			{
+				u32 row = i * N + j;
+				for (u32 di = 0; di < 3; ++di)
+				{
+					for (u32 dj = 0; dj < 3; ++dj)
+					{
+						u32 ni = i + di - 1;
+						u32 nj = j + dj - 1;
+						if (ni < N && nj < N)
+						{
+							A(row, ni * N + nj) += block;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	u32 N;
+	b3Mat33 block;
+};
+
+// Accumulate into the blocks of an existing matrix, as a force does into the Jacobians.
+template<class T>
+struct AccumulateKernel
+{
+	void operator()()
+	{
+		for (u32 i = 0; i < N; ++i)
+		{
+			for (u32 j = 0; j < N; ++j)
+			{
+				u32 row = i * N + j;
+				for (u32 di = 0; di < 3; ++di)
+				{
+					for (u32 dj = 0; dj < 3; ++dj)
+					{
+						u32 ni = i + di - 1;
+						u32 nj = j + dj - 1;
+						if (ni < N && nj < N)
+						{
+							(*A)(row, ni * N + nj) += block;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	T* A;
+	u32 N;
+	b3Mat33 block;
+};
+
+struct SparseKernel
+{
+	void operator()() { b3Mul(*out, *A, *v); }
+
+	const b3BlockSparseMat33* A;
+	const b3DenseVec3* v;
+	b3DenseVec3* out;
+};
+
+struct SparseScalarKernel
+{
+	void operator()() { ScalarMul(*out, *A, *v); }
+
+	const b3BlockSparseMat33* A;
+	const b3DenseVec3* v;
+	b3DenseVec3* out;
+};
+
+struct DiagKernel
+{
+	void operator()() { b3Mul(*out, *A, *v); }
+
+	const b3DiagMat33* A;
+	const b3DenseVec3* v;
+	b3DenseVec3* out;
+};
+
+struct DiagScalarKernel
+{
+	void operator()() { ScalarMul(*out, *A, *v); }
+
+	const b3DiagMat33* A;
+	const b3DenseVec3* v;
+	b3DenseVec3* out;
+};
+
+static void Report(const char* name, double ms, u32 blockCount)
+{
+	printf("%-22s %10.3f ms %10.2f ns/block\n", name, ms, 1.0e6 * ms / double(blockCount));
+}
+
+static void ReportSimd(const char* name, double scalarMs, double simdMs, u32 blockCount, scalar error)
+{
+	double scalarRate = double(blockCount) / (scalarMs * 1000.0);
+	double simdRate = double(blockCount) / (simdMs * 1000.0);
+
+	printf("%-22s scalar: %8.3f ms (%7.1f Mblocks/s)  %s: %8.3f ms (%7.1f Mblocks/s)  speedup: %.2fx  max error: %g\n",
+		name, scalarMs, scalarRate, GetInstructionSet(), simdMs, simdRate, scalarMs / simdMs, error);
+}
+
+void RunSparseBenchmarks(const Settings& settings)
+{
+	srand(0);
+
+	u32 N = settings.gridSize;
+	u32 n = N * N;
+
+	b3SparseMat33 pattern(n);
+	BuildGridMatrix(pattern, N);
+
+	b3BlockSparseMat33 A(pattern);
+
+	b3DiagMat33 D(n);
+	for (u32 i = 0; i < n; ++i)
+	{
+		D[i] = RandomMat33();
+	}
+
+	b3DenseVec3 v(n);
+	for (u32 i = 0; i < n; ++i)
+	{
+		v[i] = RandomVec3();
+	}
+
+	b3DenseVec3 out1(n), out2(n);
+
+	printf("sparse: rows: %u blocks: %u\n", n, A.blockCount);
+
+	b3Mat33 block = RandomMat33();
+
+	{
+		AssemblyKernel kernel;
+		kernel.N = N;
+		kernel.block = block;
+
+		Report("assembly (new)", Time(kernel, settings), A.blockCount);
+	}
+
+	{
+		AccumulateKernel<b3SparseMat33> kernel;
+		kernel.A = &pattern;
+		kernel.N = N;
+		kernel.block = block;
+
+		Report("assembly (list)", Time(kernel, settings), A.blockCount);
+	}
+
+	{
+		AccumulateKernel<b3BlockSparseMat33> kernel;
+		kernel.A = &A;
+		kernel.N = N;
+		kernel.block = block;
+
+		Report("assembly (bsr)", Time(kernel, settings), A.blockCount);
+	}
+
+	{
+		SparseScalarKernel scalarKernel;
+		scalarKernel.A = &A;
+		scalarKernel.v = &v;
+		scalarKernel.out = &out1;
+
+		SparseKernel kernel;
+		kernel.A = &A;
+		kernel.v = &v;
+		kernel.out = &out2;
+
+		double scalarMs = Time(scalarKernel, settings);
+		double simdMs = Time(kernel, settings);
+
+		ReportSimd("spmv", scalarMs, simdMs, A.blockCount, MaxDifference(out1, out2));
+	}
+
+	{
+		DiagScalarKernel scalarKernel;
+		scalarKernel.A = &D;
+		scalarKernel.v = &v;
+		scalarKernel.out = &out1;
+
+		DiagKernel kernel;
+		kernel.A = &D;
+		kernel.v = &v;
+		kernel.out = &out2;
+
+		double scalarMs = Time(scalarKernel, settings);
+		double simdMs = Time(kernel, settings);
+
+		ReportSimd("diag", scalarMs, simdMs, n, MaxDifference(out1, out2));
+	}
+}
\ No newline at end of file
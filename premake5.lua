@@ -17,6 +17,18 @@ bin_dir = "/bin/"
 -- or "" to make --help work
 action = _ACTION or ""
 
+newoption 
+{
+	trigger = "avx2",
+	description = "Compile the SIMD kernels with AVX2 and FMA instructions"
+}
+
+newoption 
+{
+	trigger = "profile",
+	description = "Time the phases of the body time step"
+}
+
 -- premake main
 workspace(solution_name)
 	configurations { "debug", "release" }
@@ -35,6 +47,19 @@ workspace(solution_name)
 		cppdialect "C++11"
 	
 	filter {}
+
+	filter "options:avx2"
+		vectorextensions "AVX2"
+		
+	filter { "options:avx2", "system:linux" }
+		buildoptions { "-mfma" }
+	
+	filter {}
+
+	filter "options:profile"
+		defines { "B3_ENABLE_PROFILE" }
+	
+	filter {}
 	
 	filter "configurations:debug"
 		defines { "DEBUG" }
@@ -61,6 +86,11 @@ workspace(solution_name)
 			bounce_softbody_inc_dir .. "/bounce_softbody/**.inl",
 			bounce_softbody_src_dir .. "/bounce_softbody/**.cpp" 
 		}
+
+		filter "system:linux" 
+			buildoptions { "-pthread" }
+
+		filter {}
 			
 	project "glad"
 		kind "StaticLib"
@@ -192,3 +222,46 @@ workspace(solution_name)
 		filter {}
 		
 		links { "glad", "glfw", "imgui", "bounce_softbody" }
+		
+	project "microbenchmark"
+		kind "ConsoleApp"
+		language "C++"
+		location ( solution_dir .. action )
+		includedirs { bounce_softbody_inc_dir }
+		
+		files 
+		{ 
+			"microbenchmark/**.h",
+			"microbenchmark/**.cpp",
+		}
+		
+		filter "system:linux" 
+			links { "pthread" }
+		
+		filter {}
+		
+		links { "bounce_softbody" }
+		
+	project "benchmark"
+		kind "ConsoleApp"
+		language "C++"
+		location ( solution_dir .. action )
+		includedirs { working_dir .. "/testbed", bounce_softbody_inc_dir }
+		
+		files 
+		{ 
+			"benchmark/**.h",
+			"benchmark/**.cpp",
+			"testbed/uniform_body.h",
+			"testbed/uniform_body.cpp",
+		}
+		
+		filter "system:windows" 
+			links { "psapi" }
+			
+		filter "system:linux" 
+			links { "pthread" }
+		
+		filter {}
+		
+		links { "bounce_softbody" }
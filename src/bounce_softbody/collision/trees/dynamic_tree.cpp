@@ -127,6 +127,150 @@ u32 b3DynamicTree::CreateProxy(const b3AABB& aabb, void* userData)
 	return proxyId;
 }
 
+void b3DynamicTree::Reserve(u32 capacity)
+{
+	if (capacity <= m_nodeCapacity)
+	{
+		return;
+	}
+
+	u32 oldCapacity = m_nodeCapacity;
+	u32 oldFreeList = m_freeList;
+
+	b3Node* oldNodes = m_nodes;
+	m_nodeCapacity = capacity;
+	m_nodes = (b3Node*)b3Alloc(m_nodeCapacity * sizeof(b3Node));
+	memcpy(m_nodes, oldNodes, oldCapacity * sizeof(b3Node));
+	b3Free(oldNodes);
+
+	// Link the new nodes and keep the old free nodes after them.
+	AddToFreeList(oldCapacity);
+	m_nodes[m_nodeCapacity - 1].next = oldFreeList;
+}
+
+u32 b3DynamicTree::BuildSubtree(u32* leaves, b3Vec3* centers, u32 count)
+{
+	B3_ASSERT(count > 0);
+
+	if (count == 1)
+	{
+		return leaves[0];
+	}
+
+	// Split along the longest axis of the bounds of the leaf centers.
+	b3Vec3 lower = centers[0];
+	b3Vec3 upper = centers[0];
+	for (u32 i = 1; i < count; ++i)
+	{
+		lower = b3Min(lower, centers[i]);
+		upper = b3Max(upper, centers[i]);
+	}
+
+	b3Vec3 extents = upper - lower;
+	u32 axis = 0;
+	if (extents.y > extents[axis])
+	{
+		axis = 1;
+	}
+	if (extents.z > extents[axis])
+	{
+		axis = 2;
+	}
+
+	// Partially sort the leaves such that the first half is on the lower side of the median.
+	i32 median = i32(count / 2);
+	i32 low = 0, high = i32(count) - 1;
+	while (low < high)
+	{
+		scalar pivot = centers[(low + high) / 2][axis];
+
+		i32 i = low, j = high;
+		while (i <= j)
+		{
+			while (centers[i][axis] < pivot)
+			{
+				++i;
+			}
+
+			while (centers[j][axis] > pivot)
+			{
+				--j;
+			}
+
+			if (i <= j)
+			{
+				b3Swap(leaves[i], leaves[j]);
+				b3Swap(centers[i], centers[j]);
+				++i;
+				--j;
+			}
+		}
+
+		if (median <= j)
+		{
+			high = j;
+		}
+		else if (median >= i)
+		{
+			low = i;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	u32 child1 = BuildSubtree(leaves, centers, u32(median));
+	u32 child2 = BuildSubtree(leaves + median, centers + median, count - u32(median));
+
+	u32 node = AllocateNode();
+	m_nodes[node].child1 = child1;
+	m_nodes[node].child2 = child2;
+	m_nodes[node].aabb = b3Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
+	m_nodes[node].height = 1 + b3Max(m_nodes[child1].height, m_nodes[child2].height);
+	m_nodes[child1].parent = node;
+	m_nodes[child2].parent = node;
+
+	return node;
+}
+
+void b3DynamicTree::CreateProxies(u32* proxyIds, const b3AABB* aabbs, void* const* userData, u32 count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	// The subtree has one node less than twice the number of leaves. 
+	// Inserting it creates one more node.
+	Reserve(m_nodeCount + 2 * count);
+
+	u32* leaves = (u32*)b3Alloc(count * sizeof(u32));
+	b3Vec3* centers = (b3Vec3*)b3Alloc(count * sizeof(b3Vec3));
+
+	b3Vec3 r(B3_AABB_EXTENSION, B3_AABB_EXTENSION, B3_AABB_EXTENSION);
+	for (u32 i = 0; i < count; ++i)
+	{
+		u32 proxyId = AllocateNode();
+		m_nodes[proxyId].aabb.lowerBound = aabbs[i].lowerBound - r;
+		m_nodes[proxyId].aabb.upperBound = aabbs[i].upperBound + r;
+		m_nodes[proxyId].userData = userData[i];
+		m_nodes[proxyId].height = 0;
+
+		proxyIds[i] = proxyId;
+		leaves[i] = proxyId;
+		centers[i] = aabbs[i].GetCenter();
+	}
+
+	u32 root = BuildSubtree(leaves, centers, count);
+
+	b3Free(centers);
+	b3Free(leaves);
+
+	// Insert the subtree as a whole.
+	InsertLeaf(root);
+}
+
 void b3DynamicTree::DestroyProxy(u32 proxyId)
 {
 	// Remove from the tree.
@@ -297,7 +441,7 @@ void b3DynamicTree::InsertLeaf(u32 leaf)
 	m_nodes[leaf].parent = newParent;
 	m_nodes[newParent].userData = nullptr;
 	m_nodes[newParent].aabb = b3Combine(leafAabb, m_nodes[sibling].aabb);
-	m_nodes[newParent].height = m_nodes[sibling].height + 1;
+	m_nodes[newParent].height = 1 + b3Max(m_nodes[sibling].height, m_nodes[leaf].height);
 
 	if (oldParent != B3_NULL_NODE_D)
 	{
@@ -0,0 +1,117 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <bounce_softbody/common/profile.h>
+#include <bounce_softbody/common/timer.h>
+
+b3ProfileScope::b3ProfileScope(b3Profile* profile, scalar64* time, const char* name)
+{
+	m_profile = profile;
+	m_time = time;
+	m_name = name;
+	m_begin = profile ? b3GetTime() : 0.0;
+}
+
+b3ProfileScope::~b3ProfileScope()
+{
+	if (m_profile == nullptr)
+	{
+		return;
+	}
+
+	scalar64 duration = b3GetTime() - m_begin;
+
+	*m_time += duration;
+
+	// Events that don't fit are still accumulated in the phase times.
+	if (m_profile->eventCount < B3_MAX_PROFILE_EVENTS)
+	{
+		b3ProfileEvent* event = m_profile->events + m_profile->eventCount;
+		event->name = m_name;
+		event->begin = m_begin - m_profile->begin;
+		event->duration = duration;
+		++m_profile->eventCount;
+	}
+}
+
+b3ChromeTraceWriter::b3ChromeTraceWriter()
+{
+	m_file = nullptr;
+	m_eventCount = 0;
+}
+
+b3ChromeTraceWriter::~b3ChromeTraceWriter()
+{
+	Close();
+}
+
+bool b3ChromeTraceWriter::Open(const char* path)
+{
+	Close();
+
+	m_file = fopen(path, "w");
+	if (m_file == nullptr)
+	{
+		return false;
+	}
+
+	m_eventCount = 0;
+
+	fprintf(m_file, "{\"traceEvents\":[\n");
+
+	return true;
+}
+
+void b3ChromeTraceWriter::Write(const b3Profile& profile, u32 threadId)
+{
+	B3_ASSERT(m_file != nullptr);
+
+	// Complete events with times in microseconds.
+	for (u32 i = 0; i < profile.eventCount; ++i)
+	{
+		const b3ProfileEvent& event = profile.events[i];
+
+		if (m_eventCount > 0)
+		{
+			fprintf(m_file, ",\n");
+		}
+
+		fprintf(m_file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+			event.name, threadId, 1000.0 * (profile.begin + event.begin), 1000.0 * event.duration);
+
+		++m_eventCount;
+	}
+}
+
+void b3ChromeTraceWriter::Close()
+{
+	if (m_file == nullptr)
+	{
+		return;
+	}
+
+	fprintf(m_file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	fclose(m_file);
+	m_file = nullptr;
+}
+
+bool b3ChromeTraceWriter::IsOpen() const
+{
+	return m_file != nullptr;
+}
\ No newline at end of file
@@ -24,12 +24,14 @@
 
 u32 b3_allocCalls = 0;
 u32 b3_maxAllocCalls = 0;
+thread_local u32 b3_threadAllocCalls = 0;
 
 b3Version b3_version = { 0, 0, 0 };
 
 void* b3Alloc(u32 size) 
 {
 	++b3_allocCalls;
+	++b3_threadAllocCalls;
 	b3_maxAllocCalls = b3Max(b3_maxAllocCalls, b3_allocCalls);
 	return malloc(size);
 }
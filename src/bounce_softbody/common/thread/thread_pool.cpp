@@ -0,0 +1,240 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce_softbody/common/thread/thread_pool.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Threading primitives. These are kept out of the header.
+struct b3ThreadPoolData
+{
+	b3ThreadPoolData()
+	{
+		workers = nullptr;
+		workerCount = 0;
+		generation = 0;
+		busyCount = 0;
+		quit = false;
+		nextChunk = 0;
+	}
+
+	static void WorkerMain(b3ThreadPool* pool, u32 generation)
+	{
+		pool->WorkerMain(generation);
+	}
+
+	std::thread* workers;
+	u32 workerCount;
+
+	std::mutex mutex;
+	std::condition_variable startCondition;
+	std::condition_variable doneCondition;
+
+	// Incremented for each new job.
+	u32 generation;
+
+	// Number of workers still executing the current job.
+	u32 busyCount;
+
+	bool quit;
+
+	std::atomic<u32> nextChunk;
+};
+
+b3ThreadPool::b3ThreadPool()
+{
+	m_threadCount = 1;
+
+	void* mem = b3Alloc(sizeof(b3ThreadPoolData));
+	m_data = new (mem) b3ThreadPoolData();
+
+	m_task = nullptr;
+	m_count = 0;
+	m_chunkSize = 0;
+	m_chunkCount = 0;
+}
+
+b3ThreadPool::~b3ThreadPool()
+{
+	SetThreadCount(1);
+
+	m_data->~b3ThreadPoolData();
+	b3Free(m_data);
+}
+
+void b3ThreadPool::SetThreadCount(u32 count)
+{
+	if (count == 0)
+	{
+		count = 1;
+	}
+
+	if (count == m_threadCount)
+	{
+		return;
+	}
+
+	b3ThreadPoolData* data = m_data;
+
+	// Stop the current workers.
+	if (data->workerCount > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(data->mutex);
+			data->quit = true;
+		}
+		data->startCondition.notify_all();
+
+		for (u32 i = 0; i < data->workerCount; ++i)
+		{
+			data->workers[i].join();
+			data->workers[i].~thread();
+		}
+
+		b3Free(data->workers);
+		data->workers = nullptr;
+		data->workerCount = 0;
+		data->quit = false;
+	}
+
+	m_threadCount = count;
+
+	// Start the new workers.
+	if (count > 1)
+	{
+		// The workers must not run the jobs executed before they were started.
+		// The generation is read here because a worker could read the generation 
+		// of the next job if it read it at startup.
+		u32 generation = data->generation;
+
+		data->workerCount = count - 1;
+		data->workers = (std::thread*)b3Alloc(data->workerCount * sizeof(std::thread));
+		for (u32 i = 0; i < data->workerCount; ++i)
+		{
+			new (data->workers + i) std::thread(b3ThreadPoolData::WorkerMain, this, generation);
+		}
+	}
+}
+
+u32 b3ThreadPool::GetThreadCount() const
+{
+	return m_threadCount;
+}
+
+void b3ThreadPool::ExecuteChunks()
+{
+	b3ThreadPoolData* data = m_data;
+
+	for (;;)
+	{
+		u32 chunk = data->nextChunk.fetch_add(1);
+		if (chunk >= m_chunkCount)
+		{
+			break;
+		}
+
+		u32 begin = chunk * m_chunkSize;
+		u32 end = b3Min(begin + m_chunkSize, m_count);
+		m_task->Execute(chunk, begin, end);
+	}
+}
+
+void b3ThreadPool::WorkerMain(u32 generation)
+{
+	b3ThreadPoolData* data = m_data;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(data->mutex);
+			while (data->quit == false && data->generation == generation)
+			{
+				data->startCondition.wait(lock);
+			}
+
+			if (data->quit)
+			{
+				return;
+			}
+
+			generation = data->generation;
+		}
+
+		ExecuteChunks();
+
+		{
+			std::lock_guard<std::mutex> lock(data->mutex);
+			--data->busyCount;
+			if (data->busyCount == 0)
+			{
+				data->doneCondition.notify_one();
+			}
+		}
+	}
+}
+
+void b3ThreadPool::Execute(b3ThreadTask* task, u32 count, u32 chunkSize)
+{
+	B3_ASSERT(chunkSize > 0);
+
+	u32 chunkCount = b3GetChunkCount(count, chunkSize);
+
+	b3ThreadPoolData* data = m_data;
+
+	// Don't wake up the workers if there is not enough work.
+	if (data->workerCount == 0 || chunkCount < 2)
+	{
+		for (u32 i = 0; i < chunkCount; ++i)
+		{
+			u32 begin = i * chunkSize;
+			u32 end = b3Min(begin + chunkSize, count);
+			task->Execute(i, begin, end);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(data->mutex);
+
+		m_task = task;
+		m_count = count;
+		m_chunkSize = chunkSize;
+		m_chunkCount = chunkCount;
+
+		data->nextChunk = 0;
+		data->busyCount = data->workerCount;
+		++data->generation;
+	}
+	data->startCondition.notify_all();
+
+	// The calling thread helps.
+	ExecuteChunks();
+
+	// Wait for the workers.
+	{
+		std::unique_lock<std::mutex> lock(data->mutex);
+		while (data->busyCount > 0)
+		{
+			data->doneCondition.wait(lock);
+		}
+	}
+
+	m_task = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <bounce_softbody/common/timer.h>
+#include <chrono>
+
+// Return the current time of the monotonic clock in nanoseconds.
+static u64 b3GetTicks()
+{
+	std::chrono::steady_clock::duration time = std::chrono::steady_clock::now().time_since_epoch();
+	return u64(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count());
+}
+
+b3Timer::b3Timer()
+{
+	m_start = b3GetTicks();
+}
+
+void b3Timer::Reset()
+{
+	m_start = b3GetTicks();
+}
+
+scalar64 b3Timer::GetMilliseconds() const
+{
+	return scalar64(b3GetTicks() - m_start) * 1.0e-6;
+}
+
+scalar64 b3GetTime()
+{
+	return scalar64(b3GetTicks()) * 1.0e-6;
+}
\ No newline at end of file
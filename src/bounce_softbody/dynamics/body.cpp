@@ -17,15 +17,20 @@
 */
 
 #include <bounce_softbody/dynamics/body.h>
+#include <bounce_softbody/dynamics/body_mesh.h>
 #include <bounce_softbody/dynamics/particle.h>
 #include <bounce_softbody/dynamics/time_step.h>
 #include <bounce_softbody/dynamics/body_solver.h>
-#include <bounce_softbody/dynamics/forces/force.h>
+#include <bounce_softbody/dynamics/forces/stretch_force.h>
+#include <bounce_softbody/dynamics/forces/triangle_element_force.h>
+#include <bounce_softbody/dynamics/forces/tetrahedron_element_force.h>
 #include <bounce_softbody/dynamics/fixtures/sphere_fixture.h>
 #include <bounce_softbody/dynamics/fixtures/triangle_fixture.h>
 #include <bounce_softbody/dynamics/fixtures/tetrahedron_fixture.h>
 #include <bounce_softbody/dynamics/fixtures/world_fixture.h>
 #include <bounce_softbody/common/draw.h>
+#include <bounce_softbody/common/timer.h>
+#include <bounce_softbody/common/profile.h>
 
 b3Body::b3Body()
 {
@@ -33,11 +38,45 @@ b3Body::b3Body()
 	m_contactManager.m_allocator = &m_blockAllocator;
 	
 	m_gravity.SetZero();
+	m_matrixFree = false;
+	m_warmStart = false;
+	m_compareColdStart = false;
+	m_adaptiveSubTolerance = false;
+	m_linearSolver = e_cgLinearSolver;
+	m_preconditioner = e_jacobiPreconditioner;
+
+	m_topologyVersion = 0;
+	m_solverCacheVersion = B3_MAX_U32;
 }
 
 b3Body::~b3Body()
 {
-	// None of the objects use b3Alloc.
+	// The block allocator releases its blocks when it is destroyed. 
+	// However, it allocates objects larger than b3_maxBlockSize with b3Alloc. 
+	// Some forces are that large, so free the forces explicitly.
+	b3Force* f = m_forceList.m_head;
+	while (f)
+	{
+		b3Force* f0 = f;
+		f = f->m_next;
+
+		u32 size = b3Force::GetSize(f0->m_type);
+		b3BodyMesh* mesh = f0->m_mesh;
+		b3Force::Destroy(f0);
+		Free(f0, size, mesh);
+	}
+
+	// Free the mesh storage.
+	b3BodyMesh* mesh = m_meshList.m_head;
+	while (mesh)
+	{
+		b3BodyMesh* mesh0 = mesh;
+		mesh = mesh->m_next;
+
+		void* memory = mesh0->m_memory;
+		mesh0->~b3BodyMesh();
+		b3Free(memory);
+	}
 }
 
 b3Particle* b3Body::CreateParticle(const b3ParticleDef& def)
@@ -45,12 +84,20 @@ b3Particle* b3Body::CreateParticle(const b3ParticleDef& def)
 	void* mem = m_blockAllocator.Allocate(sizeof(b3Particle));
 	b3Particle* p = new(mem) b3Particle(def, this);
 
-	// Add to body list.
-	m_particleList.PushFront(p);
+	AddParticle(p);
+
+	// The sparsity pattern changes.
+	++m_topologyVersion;
 
 	return p;
 }
 
+void b3Body::AddParticle(b3Particle* particle)
+{
+	// Add to body list.
+	m_particleList.PushFront(particle);
+}
+
 void b3Body::DestroyParticle(b3Particle* particle)
 {
 	// Delete the attached objects.
@@ -60,29 +107,50 @@ void b3Body::DestroyParticle(b3Particle* particle)
 
 	// Remove from body list.
 	m_particleList.Remove(particle);
+
+	// Remove from the body arrays. This moves the last particle to the removed index.
+	m_particleStorage.Remove(particle->m_solverId);
 	
+	b3BodyMesh* mesh = particle->m_mesh;
+	if (mesh)
+	{
+		mesh->m_activeParticles[particle - mesh->m_particles] = false;
+	}
+
 	particle->~b3Particle();
-	m_blockAllocator.Free(particle, sizeof(b3Particle));
+	Free(particle, sizeof(b3Particle), mesh);
+
+	++m_topologyVersion;
 }
 
 b3SphereFixture* b3Body::CreateSphere(const b3SphereFixtureDef& def)
 {
 	// Check if the fixture exists.
-	for (b3SphereFixture* s = m_sphereList.m_head; s; s = s->m_next)
+	const void* key[1] = { def.p };
+	b3SphereFixture* s0 = m_sphereTable.Find(key);
+	if (s0)
 	{
-		if (s->m_p == def.p)
-		{
-			return s;
-		}
+		return s0;
 	}
 	
 	void* mem = m_blockAllocator.Allocate(sizeof(b3SphereFixture));
 	b3SphereFixture* s = new (mem)b3SphereFixture(def, this);
 	
+	AddSphere(s);
+
+	return s;
+}
+
+void b3Body::AddSphere(b3SphereFixture* s)
+{
 	// Add to body list.
+	const void* key[1] = { s->m_p };
 	m_sphereList.PushFront(s);
+	m_sphereTable.Insert(key, s);
 
-	return s;
+	// Add to the particle list.
+	s->m_edge.owner = s;
+	s->m_p->m_sphereEdges.PushFront(&s->m_edge);
 }
 
 void b3Body::DestroySphere(b3SphereFixture* fixture)
@@ -90,27 +158,27 @@ void b3Body::DestroySphere(b3SphereFixture* fixture)
 	// Destroy attached objects.
 	fixture->DestroyContacts();
 
+	// Remove from the particle list.
+	fixture->m_p->m_sphereEdges.Remove(&fixture->m_edge);
+
 	// Remove from body list.
+	const void* key[1] = { fixture->m_p };
+	m_sphereTable.Remove(key);
 	m_sphereList.Remove(fixture);
 	
+	b3BodyMesh* mesh = fixture->m_mesh;
 	fixture->~b3SphereFixture();
-	m_blockAllocator.Free(fixture, sizeof(b3SphereFixture));
+	Free(fixture, sizeof(b3SphereFixture), mesh);
 }
 
 b3TriangleFixture* b3Body::CreateTriangle(const b3TriangleFixtureDef& def)
 {
 	// Check if the fixture exists.
-	b3Particle * p1 = def.p1, * p2 = def.p2, * p3 = def.p3;
-	for (b3TriangleFixture* t = m_triangleList.m_head; t; t = t->m_next)
+	const void* key[3] = { def.p1, def.p2, def.p3 };
+	b3TriangleFixture* t0 = m_triangleTable.Find(key);
+	if (t0)
 	{
-		bool hasP1 = t->m_p1 == p1 || t->m_p2 == p1 || t->m_p3 == p1;
-		bool hasP2 = t->m_p1 == p2 || t->m_p2 == p2 || t->m_p3 == p2;
-		bool hasP3 = t->m_p1 == p3 || t->m_p2 == p3 || t->m_p3 == p3;
-
-		if (hasP1 && hasP2 && hasP3)
-		{
-			return t;
-		}
+		return t0;
 	}
 	
 	void* mem = m_blockAllocator.Allocate(sizeof(b3TriangleFixture));
@@ -120,88 +188,492 @@ b3TriangleFixture* b3Body::CreateTriangle(const b3TriangleFixtureDef& def)
 	b3AABB aabb = t->ComputeAABB();
 	t->m_proxyId = m_tree.CreateProxy(aabb, t);
 
-	// Add to body list.
-	m_triangleList.PushFront(t);
-
-	// Reset the body mass
-	ResetMass();
+	AddTriangle(t);
 
 	return t;
 }
 
+void b3Body::AddTriangle(b3TriangleFixture* t)
+{
+	// Add to body list.
+	const void* key[3] = { t->m_p1, t->m_p2, t->m_p3 };
+	m_triangleList.PushFront(t);
+	m_triangleTable.Insert(key, t);
+
+	// Add to the particle lists.
+	t->m_edges[0].owner = t;
+	t->m_edges[1].owner = t;
+	t->m_edges[2].owner = t;
+	t->m_p1->m_triangleEdges.PushFront(&t->m_edges[0]);
+	t->m_p2->m_triangleEdges.PushFront(&t->m_edges[1]);
+	t->m_p3->m_triangleEdges.PushFront(&t->m_edges[2]);
+
+	// Add the fixture mass to the particles.
+	t->m_particleMass = (scalar(1) / scalar(3)) * (t->m_density * t->m_area);
+	t->m_p1->AddFixtureMass(t->m_particleMass);
+	t->m_p2->AddFixtureMass(t->m_particleMass);
+	t->m_p3->AddFixtureMass(t->m_particleMass);
+}
+
 void b3Body::DestroyTriangle(b3TriangleFixture* fixture)
 {
 	// Destroy tree proxy.
 	m_tree.DestroyProxy(fixture->m_proxyId);
 
+	// Remove the fixture mass from the particles.
+	fixture->m_p1->RemoveFixtureMass(fixture->m_particleMass);
+	fixture->m_p2->RemoveFixtureMass(fixture->m_particleMass);
+	fixture->m_p3->RemoveFixtureMass(fixture->m_particleMass);
+
+	// Remove from the particle lists.
+	fixture->m_p1->m_triangleEdges.Remove(&fixture->m_edges[0]);
+	fixture->m_p2->m_triangleEdges.Remove(&fixture->m_edges[1]);
+	fixture->m_p3->m_triangleEdges.Remove(&fixture->m_edges[2]);
+
 	// Remove from body list.
+	const void* key[3] = { fixture->m_p1, fixture->m_p2, fixture->m_p3 };
+	m_triangleTable.Remove(key);
 	m_triangleList.Remove(fixture);
 	
+	b3BodyMesh* mesh = fixture->m_mesh;
 	fixture->~b3TriangleFixture();
-	m_blockAllocator.Free(fixture, sizeof(b3TriangleFixture));
-
-	// Reset the body mass
-	ResetMass();
+	Free(fixture, sizeof(b3TriangleFixture), mesh);
 }
 
 b3TetrahedronFixture* b3Body::CreateTetrahedron(const b3TetrahedronFixtureDef& def)
 {
 	// Check if the fixture exists.
-	b3Particle * p1 = def.p1, * p2 = def.p2, * p3 = def.p3, * p4 = def.p4;
-	for (b3TetrahedronFixture* t = m_tetrahedronList.m_head; t; t = t->m_next)
+	const void* key[4] = { def.p1, def.p2, def.p3, def.p4 };
+	b3TetrahedronFixture* t0 = m_tetrahedronTable.Find(key);
+	if (t0)
 	{
-		bool hasP1 = t->m_p1 == p1 || t->m_p2 == p1 || t->m_p3 == p1 || t->m_p4 == p1;
-		bool hasP2 = t->m_p1 == p2 || t->m_p2 == p2 || t->m_p3 == p2 || t->m_p4 == p2;
-		bool hasP3 = t->m_p1 == p3 || t->m_p2 == p3 || t->m_p3 == p3 || t->m_p4 == p3;
-		bool hasP4 = t->m_p1 == p4 || t->m_p2 == p4 || t->m_p3 == p4 || t->m_p4 == p4;
-
-		if (hasP1 && hasP2 && hasP3 && hasP4)
-		{
-			return t;
-		}
+		return t0;
 	}
 
 	void* mem = m_blockAllocator.Allocate(sizeof(b3TetrahedronFixture));
 	b3TetrahedronFixture* t = new (mem)b3TetrahedronFixture(def, this);
 
-	// Add to body list.
-	m_tetrahedronList.PushFront(t);
-
-	// Reset the body mass.
-	ResetMass();
+	AddTetrahedron(t);
 
 	return t;
 }
 
+void b3Body::AddTetrahedron(b3TetrahedronFixture* t)
+{
+	// Add to body list.
+	const void* key[4] = { t->m_p1, t->m_p2, t->m_p3, t->m_p4 };
+	m_tetrahedronList.PushFront(t);
+	m_tetrahedronTable.Insert(key, t);
+
+	// Add to the particle lists.
+	t->m_edges[0].owner = t;
+	t->m_edges[1].owner = t;
+	t->m_edges[2].owner = t;
+	t->m_edges[3].owner = t;
+	t->m_p1->m_tetrahedronEdges.PushFront(&t->m_edges[0]);
+	t->m_p2->m_tetrahedronEdges.PushFront(&t->m_edges[1]);
+	t->m_p3->m_tetrahedronEdges.PushFront(&t->m_edges[2]);
+	t->m_p4->m_tetrahedronEdges.PushFront(&t->m_edges[3]);
+
+	// Add the fixture mass to the particles.
+	t->m_particleMass = (scalar(1) / scalar(4)) * (t->m_density * t->m_volume);
+	t->m_p1->AddFixtureMass(t->m_particleMass);
+	t->m_p2->AddFixtureMass(t->m_particleMass);
+	t->m_p3->AddFixtureMass(t->m_particleMass);
+	t->m_p4->AddFixtureMass(t->m_particleMass);
+}
+
 void b3Body::DestroyTetrahedron(b3TetrahedronFixture* fixture)
 {
+	// Remove the fixture mass from the particles.
+	fixture->m_p1->RemoveFixtureMass(fixture->m_particleMass);
+	fixture->m_p2->RemoveFixtureMass(fixture->m_particleMass);
+	fixture->m_p3->RemoveFixtureMass(fixture->m_particleMass);
+	fixture->m_p4->RemoveFixtureMass(fixture->m_particleMass);
+
+	// Remove from the particle lists.
+	fixture->m_p1->m_tetrahedronEdges.Remove(&fixture->m_edges[0]);
+	fixture->m_p2->m_tetrahedronEdges.Remove(&fixture->m_edges[1]);
+	fixture->m_p3->m_tetrahedronEdges.Remove(&fixture->m_edges[2]);
+	fixture->m_p4->m_tetrahedronEdges.Remove(&fixture->m_edges[3]);
+
 	// Remove from body list.
+	const void* key[4] = { fixture->m_p1, fixture->m_p2, fixture->m_p3, fixture->m_p4 };
+	m_tetrahedronTable.Remove(key);
 	m_tetrahedronList.Remove(fixture);
 	
+	b3BodyMesh* mesh = fixture->m_mesh;
 	fixture->~b3TetrahedronFixture();
-	m_blockAllocator.Free(fixture, sizeof(b3TetrahedronFixture));
-
-	// Reset the body mass
-	ResetMass();
+	Free(fixture, sizeof(b3TetrahedronFixture), mesh);
 }
 
 b3Force* b3Body::CreateForce(const b3ForceDef& def)
 {
 	// Call the factory.
-	b3Force* f = b3Force::Create(&def, &m_blockAllocator);
+	void* mem = m_blockAllocator.Allocate(b3Force::GetSize(def.type));
+	b3Force* f = b3Force::Create(&def, mem);
 	
+	AddForce(f);
+
+	++m_topologyVersion;
+
+	return f;
+}
+
+void b3Body::AddForce(b3Force* f)
+{
 	// Add to body list.
 	m_forceList.PushFront(f);
-	return f;
+
+	// Add to the particle lists.
+	b3Particle* ps[B3_MAX_FORCE_PARTICLES];
+	u32 count = f->GetParticles(ps);
+	for (u32 i = 0; i < count; ++i)
+	{
+		f->m_edges[i].owner = f;
+		ps[i]->m_forceEdges.PushFront(&f->m_edges[i]);
+	}
 }
 
 void b3Body::DestroyForce(b3Force* force)
 {
+	// Remove from the particle lists.
+	b3Particle* ps[B3_MAX_FORCE_PARTICLES];
+	u32 count = force->GetParticles(ps);
+	for (u32 i = 0; i < count; ++i)
+	{
+		ps[i]->m_forceEdges.Remove(&force->m_edges[i]);
+	}
+
 	// Remove from body list.
 	m_forceList.Remove(force);
 	
 	// Call the factory
-	b3Force::Destroy(force, &m_blockAllocator);
+	u32 size = b3Force::GetSize(force->m_type);
+	b3BodyMesh* mesh = force->m_mesh;
+	b3Force::Destroy(force);
+	Free(force, size, mesh);
+
+	++m_topologyVersion;
+}
+
+// Round a size up to a multiple of 16 bytes so each array in the mesh storage is aligned.
+static inline u32 b3AlignSize(u32 size)
+{
+	return (size + 15) & ~u32(15);
+}
+
+// Check that the elements of a mesh reference valid vertices and that no element is repeated.
+// The keys are the addresses of the particles in the mesh storage.
+template<u32 N>
+static bool b3ValidateElements(const b3Particle* particles, u32 vertexCount, const u32* elements, u32 elementCount)
+{
+	b3HashTable<const u32, N> table;
+	for (u32 i = 0; i < elementCount; ++i)
+	{
+		const u32* element = elements + N * i;
+
+		const void* key[N];
+		for (u32 j = 0; j < N; ++j)
+		{
+			if (element[j] >= vertexCount)
+			{
+				return false;
+			}
+
+			key[j] = particles + element[j];
+		}
+
+		if (table.Find(key))
+		{
+			return false;
+		}
+
+		table.Insert(key, element);
+	}
+
+	return true;
+}
+
+b3BodyMesh* b3Body::CreateMesh(const b3BodyMeshDef& def)
+{
+	B3_ASSERT(def.vertexCount > 0);
+	B3_ASSERT(def.triangleCount == 0 || def.triangles != nullptr);
+	B3_ASSERT(def.tetrahedronCount == 0 || def.tetrahedrons != nullptr);
+	B3_ASSERT(def.triangleForceType == e_stretchForce || def.triangleForceType == e_triangleElementForce);
+
+	u32 sphereCount = def.createSpheres ? def.vertexCount : 0;
+	u32 triangleForceCount = def.createTriangleForces ? def.triangleCount : 0;
+	u32 tetrahedronForceCount = def.createTetrahedronForces ? def.tetrahedronCount : 0;
+	u32 triangleForceSize = b3Force::GetSize(def.triangleForceType);
+	u32 tetrahedronForceSize = b3Force::GetSize(e_tetrahedronElementForce);
+
+	// Lay out all objects in one block.
+	u32 meshOffset = 0;
+	u32 particleOffset = meshOffset + b3AlignSize(sizeof(b3BodyMesh));
+	u32 sphereOffset = particleOffset + b3AlignSize(def.vertexCount * sizeof(b3Particle));
+	u32 triangleOffset = sphereOffset + b3AlignSize(sphereCount * sizeof(b3SphereFixture));
+	u32 tetrahedronOffset = triangleOffset + b3AlignSize(def.triangleCount * sizeof(b3TriangleFixture));
+	u32 triangleForceOffset = tetrahedronOffset + b3AlignSize(def.tetrahedronCount * sizeof(b3TetrahedronFixture));
+	u32 tetrahedronForceOffset = triangleForceOffset + b3AlignSize(triangleForceCount * triangleForceSize);
+	u32 triangleForcePointerOffset = tetrahedronForceOffset + b3AlignSize(tetrahedronForceCount * tetrahedronForceSize);
+	u32 tetrahedronForcePointerOffset = triangleForcePointerOffset + b3AlignSize(triangleForceCount * sizeof(b3Force*));
+	u32 activeParticleOffset = tetrahedronForcePointerOffset + b3AlignSize(tetrahedronForceCount * sizeof(b3Force*));
+	u32 memorySize = activeParticleOffset + b3AlignSize(def.vertexCount * sizeof(bool));
+
+	u8* memory = (u8*)b3Alloc(memorySize);
+
+	// Reject the mesh before creating any object.
+	b3Particle* particles = (b3Particle*)(memory + particleOffset);
+	if (b3ValidateElements<3>(particles, def.vertexCount, def.triangles, def.triangleCount) == false ||
+		b3ValidateElements<4>(particles, def.vertexCount, def.tetrahedrons, def.tetrahedronCount) == false)
+	{
+		b3Free(memory);
+		return nullptr;
+	}
+
+	b3BodyMesh* mesh = new (memory + meshOffset) b3BodyMesh;
+	mesh->m_memory = memory;
+	mesh->m_particles = particles;
+	mesh->m_particleCount = def.vertexCount;
+	mesh->m_activeParticles = (bool*)(memory + activeParticleOffset);
+	mesh->m_spheres = (b3SphereFixture*)(memory + sphereOffset);
+	mesh->m_sphereCount = sphereCount;
+	mesh->m_triangles = (b3TriangleFixture*)(memory + triangleOffset);
+	mesh->m_triangleCount = def.triangleCount;
+	mesh->m_tetrahedrons = (b3TetrahedronFixture*)(memory + tetrahedronOffset);
+	mesh->m_tetrahedronCount = def.tetrahedronCount;
+	mesh->m_triangleForces = (b3Force**)(memory + triangleForcePointerOffset);
+	mesh->m_triangleForceCount = triangleForceCount;
+	mesh->m_tetrahedronForces = (b3Force**)(memory + tetrahedronForcePointerOffset);
+	mesh->m_tetrahedronForceCount = tetrahedronForceCount;
+
+	m_meshList.PushFront(mesh);
+
+	// Create particles
+	m_particleStorage.Reserve(m_particleStorage.count + def.vertexCount);
+
+	for (u32 i = 0; i < def.vertexCount; ++i)
+	{
+		b3ParticleDef pd;
+		pd.type = def.particleType;
+		pd.position = def.vertices[i];
+		pd.massDamping = def.massDamping;
+		pd.meshIndex = i;
+
+		b3Particle* p = new (mesh->m_particles + i) b3Particle(pd, this);
+		p->m_mesh = mesh;
+		mesh->m_activeParticles[i] = true;
+		AddParticle(p);
+	}
+
+	// Create spheres
+	for (u32 i = 0; i < sphereCount; ++i)
+	{
+		b3SphereFixtureDef sd;
+		sd.p = mesh->m_particles + i;
+		sd.radius = def.radius;
+		sd.friction = def.friction;
+		sd.meshIndex = i;
+
+		b3SphereFixture* s = new (mesh->m_spheres + i) b3SphereFixture(sd, this);
+		s->m_mesh = mesh;
+		AddSphere(s);
+	}
+
+	// Create triangles
+	u8* triangleForceMemory = memory + triangleForceOffset;
+	for (u32 i = 0; i < def.triangleCount; ++i)
+	{
+		u32 v1 = def.triangles[3 * i + 0];
+		u32 v2 = def.triangles[3 * i + 1];
+		u32 v3 = def.triangles[3 * i + 2];
+
+		b3Particle* p1 = mesh->m_particles + v1;
+		b3Particle* p2 = mesh->m_particles + v2;
+		b3Particle* p3 = mesh->m_particles + v3;
+
+		b3TriangleFixtureDef td;
+		td.p1 = p1;
+		td.p2 = p2;
+		td.p3 = p3;
+		td.v1 = def.vertices[v1];
+		td.v2 = def.vertices[v2];
+		td.v3 = def.vertices[v3];
+		td.density = def.triangleDensity;
+		td.radius = def.radius;
+		td.friction = def.friction;
+		td.meshIndex = i;
+
+		b3TriangleFixture* t = new (mesh->m_triangles + i) b3TriangleFixture(td, this);
+		t->m_mesh = mesh;
+		AddTriangle(t);
+
+		if (def.createTriangleForces == false)
+		{
+			continue;
+		}
+
+		void* mem = triangleForceMemory + i * triangleForceSize;
+		b3Force* f = nullptr;
+		if (def.triangleForceType == e_stretchForce)
+		{
+			b3StretchForceDef fd;
+			fd.Initialize(td.v1, td.v2, td.v3);
+			fd.p1 = p1;
+			fd.p2 = p2;
+			fd.p3 = p3;
+			fd.stiffness_u = def.stretchingStiffness;
+			fd.damping_stiffness_u = def.stretchStiffnessDamping;
+			fd.b_u = scalar(1);
+			fd.stiffness_v = def.stretchingStiffness;
+			fd.damping_stiffness_v = def.stretchStiffnessDamping;
+			fd.b_v = scalar(1);
+			fd.meshIndex = i;
+
+			f = b3Force::Create(&fd, mem);
+		}
+		else
+		{
+			b3TriangleElementForceDef fd;
+			fd.p1 = p1;
+			fd.p2 = p2;
+			fd.p3 = p3;
+			fd.v1 = td.v1;
+			fd.v2 = td.v2;
+			fd.v3 = td.v3;
+			fd.youngModulusX = def.triangleYoungModulus;
+			fd.youngModulusY = def.triangleYoungModulus;
+			fd.shearModulus = def.triangleShearModulus;
+			fd.poissonRationXY = def.trianglePoissonRatio;
+			fd.poissonRationYX = def.trianglePoissonRatio;
+			fd.stiffnessDamping = def.triangleStiffnessDamping;
+			fd.meshIndex = i;
+
+			f = b3Force::Create(&fd, mem);
+		}
+
+		f->m_mesh = mesh;
+		mesh->m_triangleForces[i] = f;
+		AddForce(f);
+	}
+
+	// Create the tree proxies of all triangles at once.
+	if (def.triangleCount > 0)
+	{
+		b3AABB* aabbs = (b3AABB*)m_stackAllocator.Allocate(def.triangleCount * sizeof(b3AABB));
+		void** userData = (void**)m_stackAllocator.Allocate(def.triangleCount * sizeof(void*));
+		u32* proxyIds = (u32*)m_stackAllocator.Allocate(def.triangleCount * sizeof(u32));
+
+		for (u32 i = 0; i < def.triangleCount; ++i)
+		{
+			b3TriangleFixture* t = mesh->m_triangles + i;
+			aabbs[i] = t->ComputeAABB();
+			userData[i] = t;
+		}
+
+		m_tree.CreateProxies(proxyIds, aabbs, userData, def.triangleCount);
+
+		for (u32 i = 0; i < def.triangleCount; ++i)
+		{
+			mesh->m_triangles[i].m_proxyId = proxyIds[i];
+		}
+
+		m_stackAllocator.Free(proxyIds);
+		m_stackAllocator.Free(userData);
+		m_stackAllocator.Free(aabbs);
+	}
+
+	// Create tetrahedrons
+	u8* tetrahedronForceMemory = memory + tetrahedronForceOffset;
+	for (u32 i = 0; i < def.tetrahedronCount; ++i)
+	{
+		u32 v1 = def.tetrahedrons[4 * i + 0];
+		u32 v2 = def.tetrahedrons[4 * i + 1];
+		u32 v3 = def.tetrahedrons[4 * i + 2];
+		u32 v4 = def.tetrahedrons[4 * i + 3];
+
+		b3Particle* p1 = mesh->m_particles + v1;
+		b3Particle* p2 = mesh->m_particles + v2;
+		b3Particle* p3 = mesh->m_particles + v3;
+		b3Particle* p4 = mesh->m_particles + v4;
+
+		b3TetrahedronFixtureDef td;
+		td.p1 = p1;
+		td.p2 = p2;
+		td.p3 = p3;
+		td.p4 = p4;
+		td.v1 = def.vertices[v1];
+		td.v2 = def.vertices[v2];
+		td.v3 = def.vertices[v3];
+		td.v4 = def.vertices[v4];
+		td.density = def.tetrahedronDensity;
+		td.radius = def.radius;
+		td.friction = def.friction;
+		td.meshIndex = i;
+
+		b3TetrahedronFixture* t = new (mesh->m_tetrahedrons + i) b3TetrahedronFixture(td, this);
+		t->m_mesh = mesh;
+		AddTetrahedron(t);
+
+		if (def.createTetrahedronForces == false)
+		{
+			continue;
+		}
+
+		b3TetrahedronElementForceDef fd;
+		fd.p1 = p1;
+		fd.p2 = p2;
+		fd.p3 = p3;
+		fd.p4 = p4;
+		fd.v1 = td.v1;
+		fd.v2 = td.v2;
+		fd.v3 = td.v3;
+		fd.v4 = td.v4;
+		fd.youngModulus = def.tetrahedronYoungModulus;
+		fd.poissonRatio = def.tetrahedronPoissonRatio;
+		fd.stiffnessDamping = def.tetrahedronStiffnessDamping;
+		fd.meshIndex = i;
+
+		b3Force* f = b3Force::Create(&fd, tetrahedronForceMemory + i * tetrahedronForceSize);
+
+		f->m_mesh = mesh;
+		mesh->m_tetrahedronForces[i] = f;
+		AddForce(f);
+	}
+
+	++m_topologyVersion;
+
+	return mesh;
+}
+
+void b3Body::DestroyMesh(b3BodyMesh* mesh)
+{
+	// Destroying the particles destroys every fixture and force of the mesh.
+	for (u32 i = 0; i < mesh->m_particleCount; ++i)
+	{
+		if (mesh->m_activeParticles[i])
+		{
+			DestroyParticle(mesh->m_particles + i);
+		}
+	}
+
+	m_meshList.Remove(mesh);
+
+	void* memory = mesh->m_memory;
+	mesh->~b3BodyMesh();
+	b3Free(memory);
+}
+
+void b3Body::Free(void* memory, u32 size, const b3BodyMesh* mesh)
+{
+	if (mesh)
+	{
+		// The mesh owns the memory.
+		return;
+	}
+
+	m_blockAllocator.Free(memory, size);
 }
 
 b3WorldFixture* b3Body::CreateFixture(const b3WorldFixtureDef& def)
@@ -231,10 +703,12 @@ void b3Body::DestroyFixture(b3WorldFixture* fixture)
 
 scalar b3Body::GetEnergy() const
 {
+	const b3ParticleStorage& particles = m_particleStorage;
+	
 	scalar E = scalar(0);
-	for (b3Particle* p = m_particleList.m_head; p; p = p->m_next)
+	for (u32 i = 0; i < particles.count; ++i)
 	{
-		E += p->m_mass * b3Dot(p->m_velocity, p->m_velocity);
+		E += particles.masses[i] * b3Dot(particles.velocities[i], particles.velocities[i]);
 	}
 	return scalar(0.5) * E;
 }
@@ -245,71 +719,44 @@ void b3Body::ResetMass()
 	// Only touch fixture masses because there can be external particles.
 	for (b3TriangleFixture* t = m_triangleList.m_head; t; t = t->m_next)
 	{
-		t->m_p1->m_mass = scalar(0);
-		t->m_p2->m_mass = scalar(0);
-		t->m_p3->m_mass = scalar(0);
+		t->m_p1->m_fixtureMass = scalar(0);
+		t->m_p2->m_fixtureMass = scalar(0);
+		t->m_p3->m_fixtureMass = scalar(0);
+		t->m_p1->m_fixtureCount = 0;
+		t->m_p2->m_fixtureCount = 0;
+		t->m_p3->m_fixtureCount = 0;
 	}
 
 	for (b3TetrahedronFixture* t = m_tetrahedronList.m_head; t; t = t->m_next)
 	{
-		t->m_p1->m_mass = scalar(0);
-		t->m_p2->m_mass = scalar(0);
-		t->m_p3->m_mass = scalar(0);
-		t->m_p4->m_mass = scalar(0);
+		t->m_p1->m_fixtureMass = scalar(0);
+		t->m_p2->m_fixtureMass = scalar(0);
+		t->m_p3->m_fixtureMass = scalar(0);
+		t->m_p4->m_fixtureMass = scalar(0);
+		t->m_p1->m_fixtureCount = 0;
+		t->m_p2->m_fixtureCount = 0;
+		t->m_p3->m_fixtureCount = 0;
+		t->m_p4->m_fixtureCount = 0;
 	}
 
 	// Accumulate contribution of each fixture.
 	const scalar inv3 = scalar(1) / scalar(3);
 	for (b3TriangleFixture* t = m_triangleList.m_head; t; t = t->m_next)
 	{
-		b3Particle* p1 = t->m_p1;
-		b3Particle* p2 = t->m_p2;
-		b3Particle* p3 = t->m_p3;
-
-		scalar mass = t->m_density * t->m_area;
-
-		p1->m_mass += inv3 * mass;
-		p2->m_mass += inv3 * mass;
-		p3->m_mass += inv3 * mass;
+		t->m_particleMass = inv3 * (t->m_density * t->m_area);
+		t->m_p1->AddFixtureMass(t->m_particleMass);
+		t->m_p2->AddFixtureMass(t->m_particleMass);
+		t->m_p3->AddFixtureMass(t->m_particleMass);
 	}
 
 	const scalar inv4 = scalar(1) / scalar(4);
 	for (b3TetrahedronFixture* t = m_tetrahedronList.m_head; t; t = t->m_next)
 	{
-		b3Particle* p1 = t->m_p1;
-		b3Particle* p2 = t->m_p2;
-		b3Particle* p3 = t->m_p3;
-		b3Particle* p4 = t->m_p4;
-
-		scalar mass = t->m_density * t->m_volume;
-
-		p1->m_mass += inv4 * mass;
-		p2->m_mass += inv4 * mass;
-		p3->m_mass += inv4 * mass;
-		p4->m_mass += inv4 * mass;
-	}
-
-	// Invert
-	for (b3Particle* p = m_particleList.m_head; p; p = p->m_next)
-	{
-		// Static and kinematic particles have zero mass.
-		if (p->m_type == e_staticParticle || p->m_type == e_kinematicParticle)
-		{
-			p->m_mass = scalar(0);
-			p->m_invMass = scalar(0);
-			continue;
-		}
-
-		if (p->m_mass > scalar(0))
-		{
-			p->m_invMass = scalar(1) / p->m_mass;
-		}
-		else
-		{
-			// Force all dynamic particles to have non-zero mass.
-			p->m_mass = scalar(1);
-			p->m_invMass = scalar(1);
-		}
+		t->m_particleMass = inv4 * (t->m_density * t->m_volume);
+		t->m_p1->AddFixtureMass(t->m_particleMass);
+		t->m_p2->AddFixtureMass(t->m_particleMass);
+		t->m_p3->AddFixtureMass(t->m_particleMass);
+		t->m_p4->AddFixtureMass(t->m_particleMass);
 	}
 }
 
@@ -372,17 +819,16 @@ void b3Body::Solve(const b3TimeStep& step)
 {
 	b3BodySolverDef solverDef;
 	solverDef.stack = &m_stackAllocator;
-	solverDef.particleCapacity = m_particleList.m_count;
+	solverDef.particles = &m_particleStorage;
 	solverDef.forceCapacity = m_forceList.m_count;
 	solverDef.shapeContactCapacity = m_contactManager.m_shapeContactList.m_count;
+	solverDef.cache = &m_solverCache;
+	solverDef.buildPattern = m_solverCacheVersion != m_topologyVersion;
+	solverDef.threadPool = &m_threadPool;
+	solverDef.stats = &m_stats;
 	
 	b3BodySolver solver(solverDef);
 
-	for (b3Particle* p = m_particleList.m_head; p; p = p->m_next)
-	{
-		solver.Add(p);
-	}
-
 	for (b3Force* f = m_forceList.m_head; f; f = f->m_next)
 	{
 		solver.Add(f);
@@ -395,24 +841,53 @@ void b3Body::Solve(const b3TimeStep& step)
 
 	// Solve
 	solver.Solve(step, m_gravity);
+
+	m_solverCacheVersion = m_topologyVersion;
 }
 
 void b3Body::Step(scalar dt, u32 forceIterations, u32 forceSubIterations)
 {
+	m_stats.Reset();
+
+	b3Timer stepTimer;
+	// Only the allocations of this thread are counted.
+	u32 allocCalls = b3_threadAllocCalls;
+
 	// Time step parameters
 	b3TimeStep step;
 	step.dt = dt;
 	step.forceIterations = forceIterations;
 	step.forceSubIterations = forceSubIterations;
+	step.matrixFree = m_matrixFree;
+	step.warmStart = m_warmStart;
+	step.compareColdStart = m_compareColdStart;
+	step.adaptiveSubTolerance = m_adaptiveSubTolerance;
+	step.linearSolver = m_linearSolver;
+	step.preconditioner = m_preconditioner;
 	step.inv_dt = dt > scalar(0) ? scalar(1) / dt : scalar(0);
+	step.profile = &m_profile;
+
+#if defined(B3_ENABLE_PROFILE)
+	m_profile.Reset(b3GetTime());
+#endif
+
+	B3_PROFILE(step.profile, step, "Step");
 	
-	// Update contacts. This is where some contacts are ceased.
-	m_contactManager.UpdateContacts();
+	{
+		B3_PROFILE(step.profile, updateContacts, "Update Contacts");
+
+		// Update contacts. This is where some contacts are ceased.
+		m_contactManager.UpdateContacts();
+	}
 
-	// Clear internal forces before accumulating them inside the solver.
-	for (b3Force* f = m_forceList.m_head; f; f = f->m_next)
 	{
-		f->ClearForces();
+		B3_PROFILE(step.profile, clearForces, "Clear Forces");
+
+		// Clear internal forces before accumulating them inside the solver.
+		for (b3Force* f = m_forceList.m_head; f; f = f->m_next)
+		{
+			f->ClearForces();
+		}
 	}
 
 	// Integrate state, solve constraints. 
@@ -422,33 +897,44 @@ void b3Body::Step(scalar dt, u32 forceIterations, u32 forceSubIterations)
 	}
 
 	// Clear external forces and translations.
-	for (b3Particle* p = m_particleList.m_head; p; p = p->m_next)
-	{
-		p->m_force.SetZero();
-		p->m_translation.SetZero();
-	}
+	m_particleStorage.forces.SetZero();
+	m_particleStorage.translations.SetZero();
+
+	b3Timer synchronizeTimer;
 
-	// Synchronize triangles.
-	for (b3TriangleFixture* t = m_triangleList.m_head; t; t = t->m_next)
 	{
-		b3Particle* p1 = t->m_p1;
-		b3Particle* p2 = t->m_p2;
-		b3Particle* p3 = t->m_p3;
+		B3_PROFILE(step.profile, synchronize, "Synchronize");
+
+		// Synchronize triangles.
+		for (b3TriangleFixture* t = m_triangleList.m_head; t; t = t->m_next)
+		{
+			b3Particle* p1 = t->m_p1;
+			b3Particle* p2 = t->m_p2;
+			b3Particle* p3 = t->m_p3;
+
+			b3Vec3 v1 = p1->GetVelocity();
+			b3Vec3 v2 = p2->GetVelocity();
+			b3Vec3 v3 = p3->GetVelocity();
+
+			// Center velocity
+			b3Vec3 velocity = (v1 + v2 + v3) / scalar(3);
 
-		b3Vec3 v1 = p1->m_velocity;
-		b3Vec3 v2 = p2->m_velocity;
-		b3Vec3 v3 = p3->m_velocity;
+			b3Vec3 displacement = dt * velocity;
 
-		// Center velocity
-		b3Vec3 velocity = (v1 + v2 + v3) / scalar(3);
+			t->Synchronize(displacement);
+		}
+	}
 
-		b3Vec3 displacement = dt * velocity;
+	{
+		B3_PROFILE(step.profile, findContacts, "Find New Contacts");
 
-		t->Synchronize(displacement);
+		// Find new contacts
+		m_contactManager.FindNewContacts();
 	}
 
-	// Find new contacts
-	m_contactManager.FindNewContacts();
+	m_stats.synchronizeTime = synchronizeTimer.GetMilliseconds();
+	m_stats.stepTime = stepTimer.GetMilliseconds();
+	m_stats.allocCount = b3_threadAllocCalls - allocCalls;
 }
 
 void b3Body::Draw(b3Draw* draw) const
@@ -457,17 +943,17 @@ void b3Body::Draw(b3Draw* draw) const
 	{
 		if (p->m_type == e_staticParticle)
 		{
-			draw->DrawPoint(p->m_position, 4.0, b3Color_white);	
+			draw->DrawPoint(p->GetPosition(), 4.0, b3Color_white);	
 		}
 
 		if (p->m_type == e_kinematicParticle)
 		{
-			draw->DrawPoint(p->m_position, 4.0, b3Color_blue);
+			draw->DrawPoint(p->GetPosition(), 4.0, b3Color_blue);
 		}
 
 		if (p->m_type == e_dynamicParticle)
 		{
-			draw->DrawPoint(p->m_position, 4.0, b3Color_green);
+			draw->DrawPoint(p->GetPosition(), 4.0, b3Color_green);
 		}
 	}
 
@@ -477,9 +963,9 @@ void b3Body::Draw(b3Draw* draw) const
 		b3Particle* p2 = t->m_p2;
 		b3Particle* p3 = t->m_p3;
 
-		b3Vec3 v1 = p1->m_position;
-		b3Vec3 v2 = p2->m_position;
-		b3Vec3 v3 = p3->m_position;
+		b3Vec3 v1 = p1->GetPosition();
+		b3Vec3 v2 = p2->GetPosition();
+		b3Vec3 v3 = p3->GetPosition();
 
 		b3Vec3 c = (v1 + v2 + v3) / scalar(3);
 
@@ -544,10 +1030,10 @@ void b3Body::Draw(b3Draw* draw) const
 		b3Particle* p3 = t->m_p3;
 		b3Particle* p4 = t->m_p4;
 
-		b3Vec3 v1 = p1->m_position;
-		b3Vec3 v2 = p2->m_position;
-		b3Vec3 v3 = p3->m_position;
-		b3Vec3 v4 = p4->m_position;
+		b3Vec3 v1 = p1->GetPosition();
+		b3Vec3 v2 = p2->GetPosition();
+		b3Vec3 v3 = p3->GetPosition();
+		b3Vec3 v4 = p4->GetPosition();
 
 		b3Vec3 c = (v1 + v2 + v3 + v4) / scalar(4);
 
@@ -23,14 +23,13 @@
 #include <bounce_softbody/dynamics/time_step.h>
 #include <bounce_softbody/dynamics/particle.h>
 #include <bounce_softbody/common/memory/stack_allocator.h>
+#include <bounce_softbody/common/profile.h>
 
 b3BodySolver::b3BodySolver(const b3BodySolverDef& def)
 {
 	m_stack = def.stack;
 
-	m_particleCapacity = def.particleCapacity;
-	m_particleCount = 0;
-	m_particles = (b3Particle**)m_stack->Allocate(m_particleCapacity * sizeof(b3Particle*));
+	m_particles = def.particles;
 
 	m_forceCapacity = def.forceCapacity;
 	m_forceCount = 0;
@@ -39,19 +38,19 @@ b3BodySolver::b3BodySolver(const b3BodySolverDef& def)
 	m_shapeContactCapacity = def.shapeContactCapacity;
 	m_shapeContactCount = 0;
 	m_shapeContacts = (b3SphereAndShapeContact**)m_stack->Allocate(m_shapeContactCapacity * sizeof(b3SphereAndShapeContact*));
+
+	m_cache = def.cache;
+	m_buildPattern = def.buildPattern;
+
+	m_threadPool = def.threadPool;
+
+	m_stats = def.stats;
 }
 
 b3BodySolver::~b3BodySolver()
 {
 	m_stack->Free(m_shapeContacts);
 	m_stack->Free(m_forces);
-	m_stack->Free(m_particles);
-}
-
-void b3BodySolver::Add(b3Particle* p)
-{
-	p->m_solverId = m_particleCount;
-	m_particles[m_particleCount++] = p;
 }
 
 void b3BodySolver::Add(b3Force* f)
@@ -71,12 +70,15 @@ void b3BodySolver::Solve(const b3TimeStep& step, const b3Vec3& gravity)
 		b3ForceSolverDef forceSolverDef;
 		forceSolverDef.step = step;
 		forceSolverDef.stack = m_stack;
-		forceSolverDef.particleCount = m_particleCount;
 		forceSolverDef.particles = m_particles;
 		forceSolverDef.forceCount = m_forceCount;
 		forceSolverDef.forces = m_forces;
 		forceSolverDef.shapeContactCount = m_shapeContactCount;
 		forceSolverDef.shapeContacts = m_shapeContacts;
+		forceSolverDef.cache = m_cache;
+		forceSolverDef.buildPattern = m_buildPattern;
+		forceSolverDef.threadPool = m_threadPool;
+		forceSolverDef.stats = m_stats;
 
 		b3ForceSolver forceSolver(forceSolverDef);
 
@@ -84,9 +86,12 @@ void b3BodySolver::Solve(const b3TimeStep& step, const b3Vec3& gravity)
 	}
 
 	{
+		B3_PROFILE(step.profile, friction, "Friction");
+
 		// Solve friction constraints.
 		b3FrictionSolverDef frictionSolverDef;
 		frictionSolverDef.step = step;
+		frictionSolverDef.particles = m_particles;
 		frictionSolverDef.shapeContactCount = m_shapeContactCount;
 		frictionSolverDef.shapeContacts = m_shapeContacts;
 		
@@ -26,8 +26,9 @@
 void b3ContactManager::AddPair(b3SphereFixture* f1, b3WorldFixture* f2)
 {
 	// Check if there is a contact between the two entities.
-	for (b3SphereAndShapeContact* c = m_shapeContactList.m_head; c; c = c->m_next)
+	for (b3ParticleEdge<b3SphereAndShapeContact>* e = f1->m_p->m_contactEdges.m_head; e; e = e->m_next)
 	{
+		b3SphereAndShapeContact* c = e->owner;
 		if (c->m_f1 == f1 && c->m_f2 == f2)
 		{
 			// A contact already exists.
@@ -46,6 +47,10 @@ void b3ContactManager::AddPair(b3SphereFixture* f1, b3WorldFixture* f2)
 
 	// Push the contact to the contact list.
 	m_shapeContactList.PushFront(c);
+
+	// Push the contact to the particle list.
+	c->m_edge.owner = c;
+	f1->m_p->m_contactEdges.PushFront(&c->m_edge);
 }
 
 void b3ContactManager::FindNewContacts()
@@ -71,6 +76,7 @@ void b3ContactManager::Destroy(b3SphereAndShapeContact* contact)
 {
 	// Remove from the body.
 	m_shapeContactList.Remove(contact);
+	contact->m_f1->m_p->m_contactEdges.Remove(&contact->m_edge);
 	
 	// Call the factory.
 	b3SphereAndShapeContact::Destroy(contact, m_allocator);
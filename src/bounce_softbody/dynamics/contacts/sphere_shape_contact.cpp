@@ -22,7 +22,7 @@
 #include <bounce_softbody/dynamics/particle.h>
 #include <bounce_softbody/collision/geometry/sphere.h>
 #include <bounce_softbody/sparse/sparse_force_solver.h>
-#include <bounce_softbody/sparse/sparse_mat33.h>
+#include <bounce_softbody/sparse/block_sparse_mat33.h>
 #include <bounce_softbody/sparse/dense_vec3.h>
 #include <bounce_softbody/common/memory/block_allocator.h>
 
@@ -57,8 +57,8 @@ void b3SphereAndShapeContact::ComputeForces(const b3SparseForceSolverData* data)
 	const b3DenseVec3& x = *data->x;
 	const b3DenseVec3& v = *data->v;
 	b3DenseVec3& f = *data->f;
-	b3SparseMat33& dfdx = *data->dfdx;
-	b3SparseMat33& dfdv = *data->dfdv;
+	b3Mat33* dfdx = data->dfdx->values;
+	b3Mat33* dfdv = data->dfdv->values;
 
 	b3Particle* p1 = m_f1->m_p;
 
@@ -122,7 +122,7 @@ void b3SphereAndShapeContact::ComputeForces(const b3SparseForceSolverData* data)
 
 		// Apply 
 		f[i1] += f1;
-		dfdx(i1, i1) += K11;
+		dfdx[p1->m_solverSlot] += K11;
 
 		// Accumulate normal force magnitude for friction.
 		m_normalForce += b3Length(f1);
@@ -141,6 +141,6 @@ void b3SphereAndShapeContact::ComputeForces(const b3SparseForceSolverData* data)
 
 		// Apply force and Jacobian
 		f[i1] += f1;
-		dfdv(i1, i1) += K11;
+		dfdv[p1->m_solverSlot] += K11;
 	}
 }
\ No newline at end of file
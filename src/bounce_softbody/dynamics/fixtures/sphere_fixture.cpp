@@ -29,22 +29,22 @@ b3SphereFixture::b3SphereFixture(const b3SphereFixtureDef& def, b3Body* body) :
 b3AABB b3SphereFixture::ComputeAABB() const
 {
 	b3AABB aabb;
-	aabb.Set(m_p->m_position, m_radius);
+	aabb.Set(m_p->GetPosition(), m_radius);
 	return aabb;
 }
 
 void b3SphereFixture::DestroyContacts()
 {
-	b3SphereAndShapeContact* c = m_body->m_contactManager.m_shapeContactList.m_head;
-	while (c)
+	// Only the contacts of the particle can reference this sphere.
+	b3ParticleEdge<b3SphereAndShapeContact>* e = m_p->m_contactEdges.m_head;
+	while (e)
 	{
-		b3SphereAndShapeContact* c0 = c;
-		c = c->m_next;
+		b3SphereAndShapeContact* c = e->owner;
+		e = e->m_next;
 
-		if (c0->m_f1 == this)
+		if (c->m_f1 == this)
 		{
-			m_body->m_contactManager.Destroy(c0);
-			continue;
+			m_body->m_contactManager.Destroy(c);
 		}
 	}
 }
\ No newline at end of file
@@ -38,9 +38,13 @@ b3TriangleFixture::b3TriangleFixture(const b3TriangleFixtureDef& def, b3Body* bo
 
 b3AABB b3TriangleFixture::ComputeAABB() const
 {
+	b3Vec3 v1 = m_p1->GetPosition();
+	b3Vec3 v2 = m_p2->GetPosition();
+	b3Vec3 v3 = m_p3->GetPosition();
+
 	b3AABB aabb;
-	aabb.lowerBound = b3Min(m_p1->m_position, b3Min(m_p2->m_position, m_p3->m_position));
-	aabb.upperBound = b3Max(m_p1->m_position, b3Max(m_p2->m_position, m_p3->m_position));
+	aabb.lowerBound = b3Min(v1, b3Min(v2, v3));
+	aabb.upperBound = b3Max(v1, b3Max(v2, v3));
 	aabb.Extend(m_radius);
 	return aabb;
 }
@@ -64,9 +68,9 @@ bool b3TriangleFixture::RayCast(b3RayCastOutput* output, const b3RayCastInput& i
 		return false;
 	}
 
-	b3Vec3 v1 = m_p1->m_position;
-	b3Vec3 v2 = m_p2->m_position;
-	b3Vec3 v3 = m_p3->m_position;
+	b3Vec3 v1 = m_p1->GetPosition();
+	b3Vec3 v2 = m_p2->GetPosition();
+	b3Vec3 v3 = m_p3->GetPosition();
 	
 	b3Vec3 n = b3Cross(v2 - v1, v3 - v1);
 	scalar len = b3Length(n);
@@ -18,41 +18,207 @@
 
 #include <bounce_softbody/dynamics/force_solver.h>
 #include <bounce_softbody/dynamics/particle.h>
+#include <bounce_softbody/dynamics/particle_storage.h>
 #include <bounce_softbody/dynamics/forces/force.h>
+#include <bounce_softbody/dynamics/forces/stretch_force.h>
+#include <bounce_softbody/dynamics/forces/tetrahedron_element_force.h>
 #include <bounce_softbody/dynamics/contacts/sphere_shape_contact.h>
 #include <bounce_softbody/sparse/sparse_force_solver.h>
 #include <bounce_softbody/sparse/dense_vec3.h>
 #include <bounce_softbody/sparse/diag_mat33.h>
 #include <bounce_softbody/sparse/sparse_mat33.h>
+#include <bounce_softbody/sparse/block_sparse_mat33.h>
 #include <bounce_softbody/common/memory/stack_allocator.h>
-
-// Number of non-linear iterations.
-u32 b3_forceSolverIterations = 0;
-
-// Min/max number of inner iterations.
-u32 b3_forceSolverMinSubIterations = B3_MAX_U32;
-u32 b3_forceSolverMaxSubIterations = 0;
+#include <bounce_softbody/common/thread/thread_pool.h>
+#include <bounce_softbody/common/profile.h>
 
 b3ForceSolver::b3ForceSolver(const b3ForceSolverDef& def)
 {
 	m_step = def.step;
 	m_stack = def.stack;
 
-	m_particleCount = def.particleCount;
-	m_particles = def.particles;
+	m_storage = def.particles;
+	m_particleCount = m_storage->count;
+	m_particles = m_storage->particles;
 
 	m_forceCount = def.forceCount;
 	m_forces = def.forces;
 
 	m_shapeContactCount = def.shapeContactCount;
 	m_shapeContacts = def.shapeContacts;
+
+	m_cache = def.cache;
+	m_buildPattern = def.buildPattern;
+
+	m_threadPool = def.threadPool;
+
+	m_stats = def.stats;
 }
 
 b3ForceSolver::~b3ForceSolver()
 {
 }
 
-class b3ForceModel : public b3SparseForceModel
+b3ForceSolverCache::b3ForceSolverCache()
+{
+	tetrahedronCount = 0;
+	tetrahedra = nullptr;
+	forceCount = 0;
+	forces = nullptr;
+}
+
+b3ForceSolverCache::~b3ForceSolverCache()
+{
+	if (tetrahedra)
+	{
+		b3Free(tetrahedra);
+	}
+
+	if (forces)
+	{
+		b3Free(forces);
+	}
+}
+
+b3ForceColoring::b3ForceColoring()
+{
+	elementCount = 0;
+	chunkCount = 0;
+	chunks = nullptr;
+	colorCount = 0;
+	colorOffsets[0] = 0;
+	serial = false;
+}
+
+b3ForceColoring::~b3ForceColoring()
+{
+	Destroy();
+}
+
+void b3ForceColoring::Destroy()
+{
+	if (chunks)
+	{
+		b3Free(chunks);
+		chunks = nullptr;
+	}
+
+	elementCount = 0;
+	chunkCount = 0;
+	colorCount = 0;
+	colorOffsets[0] = 0;
+	serial = false;
+}
+
+void b3ForceColoring::Create(const u32* particles, u32 particlesPerElement, u32 inElementCount, u32 particleCount)
+{
+	Destroy();
+
+	if (inElementCount == 0)
+	{
+		return;
+	}
+
+	elementCount = inElementCount;
+
+	chunkCount = b3GetChunkCount(elementCount, B3_FORCE_CHUNK_SIZE);
+	chunks = (u32*)b3Alloc(chunkCount * sizeof(u32));
+
+	// Colors taken by the chunks of each particle.
+	u64* particleColors = (u64*)b3Alloc(particleCount * sizeof(u64));
+	memset(particleColors, 0, particleCount * sizeof(u64));
+
+	u32* chunkColors = (u32*)b3Alloc(chunkCount * sizeof(u32));
+
+	// The last slot counts the chunks without a color.
+	u32 counts[B3_MAX_FORCE_COLORS + 1];
+	memset(counts, 0, sizeof(counts));
+
+	// Greedy coloring in order. A chunk takes the first color that none of its particles has.
+	// A color is only taken if all the previous colors are taken, so the colors are contiguous.
+	for (u32 i = 0; i < chunkCount; ++i)
+	{
+		u32 begin, end;
+		GetChunk(i, &begin, &end);
+
+		const u32* first = particles + begin * particlesPerElement;
+		const u32* last = particles + end * particlesPerElement;
+
+		u64 taken = 0;
+		for (const u32* p = first; p < last; ++p)
+		{
+			if (*p != B3_MAX_U32)
+			{
+				taken |= particleColors[*p];
+			}
+		}
+
+		u32 color = 0;
+		while (color < B3_MAX_FORCE_COLORS && (taken & (u64(1) << color)))
+		{
+			++color;
+		}
+
+		if (color < B3_MAX_FORCE_COLORS)
+		{
+			for (const u32* p = first; p < last; ++p)
+			{
+				if (*p != B3_MAX_U32)
+				{
+					particleColors[*p] |= u64(1) << color;
+				}
+			}
+		}
+
+		chunkColors[i] = color;
+		++counts[color];
+	}
+
+	colorCount = 0;
+	while (colorCount < B3_MAX_FORCE_COLORS && counts[colorCount] > 0)
+	{
+		++colorCount;
+	}
+
+	serial = counts[B3_MAX_FORCE_COLORS] > 0;
+	if (serial)
+	{
+		counts[colorCount] = counts[B3_MAX_FORCE_COLORS];
+		++colorCount;
+	}
+
+	colorOffsets[0] = 0;
+	for (u32 i = 0; i < colorCount; ++i)
+	{
+		colorOffsets[i + 1] = colorOffsets[i] + counts[i];
+	}
+
+	B3_ASSERT(colorOffsets[colorCount] == chunkCount);
+
+	// Sort the chunks by color. This keeps the order within a color.
+	u32 next[B3_MAX_FORCE_COLORS + 1];
+	memcpy(next, colorOffsets, colorCount * sizeof(u32));
+
+	for (u32 i = 0; i < chunkCount; ++i)
+	{
+		u32 color = chunkColors[i] < B3_MAX_FORCE_COLORS ? chunkColors[i] : colorCount - 1;
+		chunks[next[color]++] = i;
+	}
+
+	b3Free(chunkColors);
+	b3Free(particleColors);
+}
+
+// The groups of forces evaluated by the force model.
+enum b3ForceGroup
+{
+	e_stretchForceGroup,
+	e_tetrahedronForceGroup,
+	e_otherForceGroup
+};
+
+// The force model evaluates the stretch forces and tetrahedra in batches and the chunks of a color in parallel.
+class b3ForceModel : public b3SparseForceModel, public b3ThreadTask
 {
 public:
 	void ComputeForces(const b3SparseForceSolverData* data)
@@ -62,10 +228,10 @@ public:
 			m_particles[i]->ComputeForces(data);
 		}
 		
-		for (u32 i = 0; i < m_forceCount; ++i)
-		{
-			m_forces[i]->ComputeForces(data);
-		}
+		// A single thread also evaluates the colors in order, so the sums are the same for any number of threads.
+		ComputeColors(data, m_stretchColoring, e_stretchForceGroup);
+		ComputeColors(data, m_tetrahedronColoring, e_tetrahedronForceGroup);
+		ComputeColors(data, m_forceColoring, e_otherForceGroup);
 
 		for (u32 i = 0; i < m_shapeContactCount; ++i)
 		{
@@ -73,57 +239,309 @@ public:
 		}
 	}
 
+	void ComputeColors(const b3SparseForceSolverData* data, const b3ForceColoring* coloring, b3ForceGroup group)
+	{
+		m_data = data;
+		m_coloring = coloring;
+		m_group = group;
+
+		for (u32 i = 0; i < coloring->colorCount; ++i)
+		{
+			u32 begin = coloring->colorOffsets[i];
+			u32 end = coloring->colorOffsets[i + 1];
+
+			m_colorChunks = coloring->chunks + begin;
+
+			if (coloring->serial && i + 1 == coloring->colorCount)
+			{
+				Execute(0, 0, end - begin);
+			}
+			else
+			{
+				b3Execute(m_threadPool, this, end - begin, 1);
+			}
+		}
+	}
+
+	void Execute(u32 chunk, u32 begin, u32 end)
+	{
+		B3_NOT_USED(chunk);
+
+		for (u32 i = begin; i < end; ++i)
+		{
+			u32 elementBegin, elementEnd;
+			m_coloring->GetChunk(m_colorChunks[i], &elementBegin, &elementEnd);
+
+			switch (m_group)
+			{
+			case e_stretchForceGroup:
+			{
+				m_stretchBatch->ComputeForces(m_data, elementBegin, elementEnd);
+				break;
+			}
+			case e_tetrahedronForceGroup:
+			{
+				b3TetrahedronElementForce::ComputeForces(m_tetrahedra + elementBegin, elementEnd - elementBegin, m_data);
+				break;
+			}
+			default:
+			{
+				for (u32 j = elementBegin; j < elementEnd; ++j)
+				{
+					m_forces[j]->ComputeForces(m_data);
+				}
+				break;
+			}
+			}
+		}
+	}
+
 	u32 m_particleCount;
 	b3Particle** m_particles;
 
+	b3StretchForceBatch* m_stretchBatch;
+	const b3ForceColoring* m_stretchColoring;
+
+	u32 m_tetrahedronCount;
+	b3TetrahedronElementForce** m_tetrahedra;
+	const b3ForceColoring* m_tetrahedronColoring;
+
 	u32 m_forceCount;
 	b3Force** m_forces;
+	const b3ForceColoring* m_forceColoring;
 
 	u32 m_shapeContactCount;
 	b3SphereAndShapeContact** m_shapeContacts;
+
+	b3ThreadPool* m_threadPool;
+
+	// Current color
+	const b3SparseForceSolverData* m_data;
+	const b3ForceColoring* m_coloring;
+	b3ForceGroup m_group;
+	const u32* m_colorChunks;
 };
 
-void b3ForceSolver::Solve(const b3Vec3& gravity)
+void b3ForceSolver::GetParticles(u32* ids, const b3Force* force)
 {
-	b3DenseVec3 x0(m_particleCount);
-	b3DenseVec3 v0(m_particleCount);
-	b3DenseVec3 fe(m_particleCount);
-	b3DenseVec3 y(m_particleCount);
-	b3DenseVec3 x(m_particleCount);
-	b3DenseVec3 v(m_particleCount);
-	b3DiagMat33 M(m_particleCount);
-	b3DiagMat33 S(m_particleCount);
-	b3DenseVec3 z(m_particleCount);
-	
+	b3Particle* particles[B3_MAX_FORCE_PARTICLES];
+	u32 count = force->GetParticles(particles);
+
+	for (u32 i = 0; i < B3_MAX_FORCE_PARTICLES; ++i)
+	{
+		ids[i] = i < count ? particles[i]->m_solverId : B3_MAX_U32;
+	}
+}
+
+void b3ForceSolver::BuildPattern()
+{
+	b3SparseMat33 pattern(m_particleCount);
+
+	// Particles and contacts only write to the diagonal.
 	for (u32 i = 0; i < m_particleCount; ++i)
 	{
-		b3Particle* p = m_particles[i];
+		pattern(i, i);
+	}
 
-		x0[i] = p->m_position;
-		v0[i] = p->m_velocity;
-		fe[i] = p->m_force;
-		y[i] = p->m_translation;
-		z[i].SetZero();
+	// A force couples all of its particles.
+	for (u32 i = 0; i < m_forceCount; ++i)
+	{
+		b3Particle* particles[B3_MAX_FORCE_PARTICLES];
+		u32 count = m_forces[i]->GetParticles(particles);
+		B3_ASSERT(count <= B3_MAX_FORCE_PARTICLES);
 
-		if (p->m_type == e_dynamicParticle)
+		for (u32 j = 0; j < count; ++j)
 		{
-			B3_ASSERT(p->m_mass > scalar(0));
-			M[i] = b3Mat33Diagonal(p->m_mass);
+			u32 row = particles[j]->m_solverId;
+			for (u32 k = 0; k < count; ++k)
+			{
+				pattern(row, particles[k]->m_solverId);
+			}
+		}
+	}
+
+	m_cache->solverCache.Create(pattern);
+
+	// Map the blocks written by the particles and forces to the Jacobian values.
+	// Then the assembly doesn't search the rows.
+	const b3BlockSparseMat33& dfdx = m_cache->solverCache.dfdx;
+
+	for (u32 i = 0; i < m_particleCount; ++i)
+	{
+		m_particles[i]->m_solverSlot = dfdx.GetIndex(i, i);
+	}
+
+	for (u32 i = 0; i < m_forceCount; ++i)
+	{
+		b3Force* force = m_forces[i];
+
+		b3Particle* particles[B3_MAX_FORCE_PARTICLES];
+		u32 count = force->GetParticles(particles);
 
-			// Apply weight
-			fe[i] += p->m_mass * gravity;
+		for (u32 j = 0; j < count; ++j)
+		{
+			u32 row = particles[j]->m_solverId;
+			for (u32 k = 0; k < count; ++k)
+			{
+				force->m_slots[j][k] = dfdx.GetIndex(row, particles[k]->m_solverId);
+			}
+		}
+	}
+
+	// Split the stretch forces and tetrahedra from the other forces.
+	u32 stretchCount = 0;
+	u32 tetrahedronCount = 0;
+	for (u32 i = 0; i < m_forceCount; ++i)
+	{
+		b3ForceType type = m_forces[i]->m_type;
+		if (type == e_stretchForce)
+		{
+			++stretchCount;
+		}
+		else if (type == e_tetrahedronElementForce)
+		{
+			++tetrahedronCount;
+		}
+	}
+
+	b3StretchForce** stretchForces = (b3StretchForce**)m_stack->Allocate(stretchCount * sizeof(b3StretchForce*));
+
+	if (m_cache->tetrahedra)
+	{
+		b3Free(m_cache->tetrahedra);
+		m_cache->tetrahedra = nullptr;
+	}
+
+	m_cache->tetrahedronCount = tetrahedronCount;
+	if (tetrahedronCount > 0)
+	{
+		m_cache->tetrahedra = (b3TetrahedronElementForce**)b3Alloc(tetrahedronCount * sizeof(b3TetrahedronElementForce*));
+	}
+
+	if (m_cache->forces)
+	{
+		b3Free(m_cache->forces);
+		m_cache->forces = nullptr;
+	}
+
+	m_cache->forceCount = m_forceCount - stretchCount - tetrahedronCount;
+	if (m_cache->forceCount > 0)
+	{
+		m_cache->forces = (b3Force**)b3Alloc(m_cache->forceCount * sizeof(b3Force*));
+	}
 
-			// Set as unconstrained particle.
-			S[i].SetIdentity();
+	u32 otherCount = 0;
+	stretchCount = 0;
+	tetrahedronCount = 0;
+	for (u32 i = 0; i < m_forceCount; ++i)
+	{
+		b3Force* force = m_forces[i];
+		if (force->m_type == e_stretchForce)
+		{
+			stretchForces[stretchCount++] = (b3StretchForce*)force;
+		}
+		else if (force->m_type == e_tetrahedronElementForce)
+		{
+			m_cache->tetrahedra[tetrahedronCount++] = (b3TetrahedronElementForce*)force;
 		}
 		else
 		{
-			// Ensure a non-zero mass because zero masses 
-			// can make the system unsolvable.
-			M[i] = b3Mat33Diagonal(scalar(1));
+			m_cache->forces[otherCount++] = force;
+		}
+	}
+
+	m_cache->stretchBatch.Create(stretchForces, stretchCount);
+
+	m_stack->Free(stretchForces);
 
-			// Constrain particle.
-			S[i].SetZero();
+	// Color the groups.
+	u32 elementCount = b3Max(b3Max(stretchCount, tetrahedronCount), m_cache->forceCount);
+	u32* elementParticles = (u32*)m_stack->Allocate(elementCount * B3_MAX_FORCE_PARTICLES * sizeof(u32));
+
+	for (u32 i = 0; i < stretchCount; ++i)
+	{
+		u32* particles = elementParticles + i * 3;
+		m_cache->stretchBatch.GetParticles(i, particles);
+	}
+
+	m_cache->stretchColoring.Create(elementParticles, 3, stretchCount, m_particleCount);
+
+	for (u32 i = 0; i < tetrahedronCount; ++i)
+	{
+		GetParticles(elementParticles + i * B3_MAX_FORCE_PARTICLES, m_cache->tetrahedra[i]);
+	}
+
+	m_cache->tetrahedronColoring.Create(elementParticles, B3_MAX_FORCE_PARTICLES, tetrahedronCount, m_particleCount);
+
+	for (u32 i = 0; i < m_cache->forceCount; ++i)
+	{
+		GetParticles(elementParticles + i * B3_MAX_FORCE_PARTICLES, m_cache->forces[i]);
+	}
+
+	m_cache->forceColoring.Create(elementParticles, B3_MAX_FORCE_PARTICLES, m_cache->forceCount, m_particleCount);
+
+	m_stack->Free(elementParticles);
+}
+
+void b3ForceSolver::Solve(const b3Vec3& gravity)
+{
+	// The solver reads the initial state from the body arrays.
+	const b3DenseVec3& x0 = m_storage->positions;
+	const b3DenseVec3& v0 = m_storage->velocities;
+	const b3DenseVec3& y = m_storage->translations;
+	b3DenseVec3& fe = m_cache->fe;
+	b3DenseVec3& x = m_cache->x;
+	b3DenseVec3& v = m_cache->v;
+	b3DiagMat33& M = m_cache->M;
+	b3DiagMat33& S = m_cache->S;
+	b3DenseVec3& z = m_cache->z;
+
+	{
+		B3_PROFILE(m_step.profile, gather, "Gather");
+
+		if (m_buildPattern)
+		{
+			BuildPattern();
+		}
+
+		// Memory is reallocated only when the number of particles changes.
+		fe.Resize(m_particleCount);
+		x.Resize(m_particleCount);
+		v.Resize(m_particleCount);
+		M.Resize(m_particleCount);
+		S.Resize(m_particleCount);
+		z.Resize(m_particleCount);
+
+		const b3DenseVec3& forces = m_storage->forces;
+		const scalar* masses = m_storage->masses;
+
+		for (u32 i = 0; i < m_particleCount; ++i)
+		{
+			scalar mass = masses[i];
+			
+			fe[i] = forces[i];
+			z[i].SetZero();
+
+			// Only dynamic particles have mass.
+			if (mass > scalar(0))
+			{
+				M[i] = b3Mat33Diagonal(mass);
+
+				// Apply weight
+				fe[i] += mass * gravity;
+
+				// Set as unconstrained particle.
+				S[i].SetIdentity();
+			}
+			else
+			{
+				// Ensure a non-zero mass because zero masses 
+				// can make the system unsolvable.
+				M[i] = b3Mat33Diagonal(scalar(1));
+
+				// Constrain particle.
+				S[i].SetZero();
+			}
 		}
 	}
 
@@ -131,14 +549,22 @@ void b3ForceSolver::Solve(const b3Vec3& gravity)
 	b3ForceModel forceModel;
 	forceModel.m_particleCount = m_particleCount;
 	forceModel.m_particles = m_particles;
-	forceModel.m_forceCount = m_forceCount;
-	forceModel.m_forces = m_forces;
+	forceModel.m_stretchBatch = &m_cache->stretchBatch;
+	forceModel.m_stretchColoring = &m_cache->stretchColoring;
+	forceModel.m_tetrahedronCount = m_cache->tetrahedronCount;
+	forceModel.m_tetrahedra = m_cache->tetrahedra;
+	forceModel.m_tetrahedronColoring = &m_cache->tetrahedronColoring;
+	forceModel.m_forceCount = m_cache->forceCount;
+	forceModel.m_forces = m_cache->forces;
+	forceModel.m_forceColoring = &m_cache->forceColoring;
 	forceModel.m_shapeContactCount = m_shapeContactCount;
 	forceModel.m_shapeContacts = m_shapeContacts;
+	forceModel.m_threadPool = m_threadPool;
 
 	// Prepare input.
 	b3SolveBEInput solverInput;
 	solverInput.forceModel = &forceModel;
+	solverInput.cache = &m_cache->solverCache;
 	solverInput.h = m_step.dt;
 	solverInput.inv_h = m_step.inv_dt;
 	solverInput.dofCount = m_particleCount;
@@ -151,28 +577,42 @@ void b3ForceSolver::Solve(const b3Vec3& gravity)
 	solverInput.z = &z;
 	solverInput.maxIterations = m_step.forceIterations;
 	solverInput.maxSubIterations = m_step.forceSubIterations;
+	solverInput.matrixFree = m_step.matrixFree;
+	solverInput.threadPool = m_threadPool;
+	solverInput.warmStart = m_step.warmStart;
+	solverInput.compareColdStart = m_step.compareColdStart;
+	solverInput.adaptiveSubTolerance = m_step.adaptiveSubTolerance;
+	solverInput.linearSolver = m_step.linearSolver;
+	solverInput.preconditioner = m_step.preconditioner;
+	solverInput.profile = m_step.profile;
 	
 	// Prepare output.
 	b3SolveBEOutput solverOutput;
 	solverOutput.x = &x;
 	solverOutput.v = &v;
-	solverOutput.minSubIterations = b3_forceSolverMinSubIterations;
-	solverOutput.maxSubIterations = b3_forceSolverMaxSubIterations;
+	solverOutput.minSubIterations = B3_MAX_U32;
+	solverOutput.maxSubIterations = 0;
+	solverOutput.subIterations = 0;
+	solverOutput.historyCapacity = B3_MAX_SOLVER_STATS_ITERATIONS;
+	solverOutput.subIterationHistory = m_stats->subIterationHistory;
+	solverOutput.errorHistory = m_stats->errorHistory;
 
 	// Integrate F = ma.
 	b3SparseSolveBE(&solverOutput, &solverInput);
 
-	// Track non-linear iterations.
-	b3_forceSolverIterations = solverOutput.iterations;
-	
-	// Track min-max sub-iterations.
-	b3_forceSolverMinSubIterations = solverOutput.minSubIterations;
-	b3_forceSolverMaxSubIterations = solverOutput.maxSubIterations;
+	// Track iterations and times.
+	m_stats->iterations = solverOutput.iterations;
+	m_stats->subIterations = solverOutput.subIterations;
+	m_stats->minSubIterations = solverOutput.iterations > 0 ? solverOutput.minSubIterations : 0;
+	m_stats->maxSubIterations = solverOutput.maxSubIterations;
+	m_stats->savedSubIterations = solverOutput.savedSubIterations;
+	m_stats->forceTime = solverOutput.forceTime;
+	m_stats->assemblyTime = solverOutput.assemblyTime;
+	m_stats->solveTime = solverOutput.solveTime;
 
-	// Copy buffers back to the particles.
-	for (u32 i = 0; i < m_particleCount; ++i)
-	{
-		m_particles[i]->m_position = x[i];
-		m_particles[i]->m_velocity = v[i];
-	}
+	B3_PROFILE(m_step.profile, scatter, "Scatter");
+
+	// Copy the new state to the body arrays.
+	m_storage->positions.Copy(x);
+	m_storage->velocities.Copy(v);
 }
\ No newline at end of file
@@ -23,59 +23,80 @@
 #include <bounce_softbody/dynamics/forces/mouse_force.h>
 #include <bounce_softbody/dynamics/forces/triangle_element_force.h>
 #include <bounce_softbody/dynamics/forces/tetrahedron_element_force.h>
-#include <bounce_softbody/common/memory/block_allocator.h>
+#include <new>
 
-b3Force* b3Force::Create(const b3ForceDef* def, b3BlockAllocator* allocator)
+u32 b3Force::GetSize(b3ForceType type)
+{
+	switch (type)
+	{
+	case e_stretchForce:
+		return sizeof(b3StretchForce);
+	case e_shearForce:
+		return sizeof(b3ShearForce);
+	case e_springForce:
+		return sizeof(b3SpringForce);
+	case e_mouseForce:
+		return sizeof(b3MouseForce);
+	case e_triangleElementForce:
+		return sizeof(b3TriangleElementForce);
+	case e_tetrahedronElementForce:
+		return sizeof(b3TetrahedronElementForce);
+	default:
+	{
+		B3_ASSERT(false);
+		return 0;
+	}
+	}
+}
+
+b3Force* b3Force::Create(const b3ForceDef* def, void* memory)
 {
 	b3Force* force = nullptr;
 	switch (def->type)
 	{
 	case e_stretchForce:
 	{
-		void* mem = allocator->Allocate(sizeof(b3StretchForce));
-		force = new (mem) b3StretchForce((b3StretchForceDef*)def);
+		force = new (memory) b3StretchForce((b3StretchForceDef*)def);
 		break;
 	}
 	case e_shearForce:
 	{
-		void* mem = allocator->Allocate(sizeof(b3ShearForce));
-		force = new (mem) b3ShearForce((b3ShearForceDef*)def);
+		force = new (memory) b3ShearForce((b3ShearForceDef*)def);
 		break;
 	}
 	case e_springForce:
 	{
-		void* mem = allocator->Allocate(sizeof(b3SpringForce));
-		force = new (mem) b3SpringForce((b3SpringForceDef*)def);
+		force = new (memory) b3SpringForce((b3SpringForceDef*)def);
 		break;
 	}
 	case e_mouseForce:
 	{
-		void* mem = allocator->Allocate(sizeof(b3MouseForce));
-		force = new (mem) b3MouseForce((b3MouseForceDef*)def);
+		force = new (memory) b3MouseForce((b3MouseForceDef*)def);
 		break;
 	}
 	case e_triangleElementForce:
 	{
-		void* mem = allocator->Allocate(sizeof(b3TriangleElementForce));
-		force = new (mem) b3TriangleElementForce((b3TriangleElementForceDef*)def);
+		force = new (memory) b3TriangleElementForce((b3TriangleElementForceDef*)def);
 		break;
 	}
 	case e_tetrahedronElementForce:
 	{
-		void* mem = allocator->Allocate(sizeof(b3TetrahedronElementForce));
-		force = new (mem) b3TetrahedronElementForce((b3TetrahedronElementForceDef*)def);
+		force = new (memory) b3TetrahedronElementForce((b3TetrahedronElementForceDef*)def);
 		break;
 	}
 	default:
 	{
 		B3_ASSERT(false);
-		break;
+		return nullptr;
 	}
 	}
+
+	force->m_mesh = nullptr;
+
 	return force;
 }
 
-void b3Force::Destroy(b3Force* force, b3BlockAllocator* allocator)
+void b3Force::Destroy(b3Force* force)
 {
 	B3_ASSERT(force);
 
@@ -86,42 +107,36 @@ void b3Force::Destroy(b3Force* force, b3BlockAllocator* allocator)
 	{
 		b3StretchForce* o = (b3StretchForce*)force;
 		o->~b3StretchForce();
-		allocator->Free(o, sizeof(b3StretchForce));
 		break;
 	}
 	case e_shearForce:
 	{
 		b3ShearForce* o = (b3ShearForce*)force;
 		o->~b3ShearForce();
-		allocator->Free(o, sizeof(b3ShearForce));
 		break;
 	}
 	case e_springForce:
 	{
 		b3SpringForce* o = (b3SpringForce*)force;
 		o->~b3SpringForce();
-		allocator->Free(o, sizeof(b3SpringForce));
 		break;
 	}
 	case e_mouseForce:
 	{
 		b3MouseForce* o = (b3MouseForce*)force;
 		o->~b3MouseForce();
-		allocator->Free(o, sizeof(b3MouseForce));
 		break;
 	}
 	case e_triangleElementForce:
 	{
 		b3TriangleElementForce* o = (b3TriangleElementForce*)force;
 		o->~b3TriangleElementForce();
-		allocator->Free(o, sizeof(b3TriangleElementForce));
 		break;
 	}
 	case e_tetrahedronElementForce:
 	{
 		b3TetrahedronElementForce* o = (b3TetrahedronElementForce*)force;
 		o->~b3TetrahedronElementForce();
-		allocator->Free(o, sizeof(b3TetrahedronElementForce));
 		break;
 	}
 	default:
@@ -20,7 +20,7 @@
 #include <bounce_softbody/dynamics/particle.h>
 #include <bounce_softbody/sparse/sparse_force_solver.h>
 #include <bounce_softbody/sparse/dense_vec3.h>
-#include <bounce_softbody/sparse/sparse_mat33.h>
+#include <bounce_softbody/sparse/block_sparse_mat33.h>
 
 void b3SpringForceDef::Initialize(b3Particle* particle1, b3Particle* particle2, scalar structuralStiffness, scalar structuralDampingStiffness)
 {
@@ -52,6 +52,13 @@ bool b3SpringForce::HasParticle(const b3Particle* particle) const
 	return m_p1 == particle || m_p2 == particle;
 }
 
+u32 b3SpringForce::GetParticles(b3Particle* particles[B3_MAX_FORCE_PARTICLES]) const
+{
+	particles[0] = m_p1;
+	particles[1] = m_p2;
+	return 2;
+}
+
 void b3SpringForce::ClearForces()
 {
 	m_f1.SetZero();
@@ -63,8 +70,8 @@ void b3SpringForce::ComputeForces(const b3SparseForceSolverData* data)
 	b3DenseVec3& x = *data->x;
 	b3DenseVec3& v = *data->v;
 	b3DenseVec3& f = *data->f;
-	b3SparseMat33& dfdx = *data->dfdx;
-	b3SparseMat33& dfdv = *data->dfdv;
+	b3Mat33* dfdx = data->dfdx->values;
+	b3Mat33* dfdv = data->dfdv->values;
 
 	u32 i1 = m_p1->m_solverId;
 	u32 i2 = m_p2->m_solverId;
@@ -107,10 +114,10 @@ void b3SpringForce::ComputeForces(const b3SparseForceSolverData* data)
 				b3Mat33 K21 = K12;
 				b3Mat33 K22 = K11;
 
-				dfdx(i1, i1) += K11;
-				dfdx(i1, i2) += K12;
-				dfdx(i2, i1) += K21;
-				dfdx(i2, i2) += K22;
+				dfdx[m_slots[0][0]] += K11;
+				dfdx[m_slots[0][1]] += K12;
+				dfdx[m_slots[1][0]] += K21;
+				dfdx[m_slots[1][1]] += K22;
 			}
 		}
 
@@ -134,10 +141,10 @@ void b3SpringForce::ComputeForces(const b3SparseForceSolverData* data)
 			b3Mat33 K21 = K12;
 			b3Mat33 K22 = K11;
 
-			dfdv(i1, i1) += K11;
-			dfdv(i1, i2) += K12;
-			dfdv(i2, i1) += K21;
-			dfdv(i2, i2) += K22;
+			dfdv[m_slots[0][0]] += K11;
+			dfdv[m_slots[0][1]] += K12;
+			dfdv[m_slots[1][0]] += K21;
+			dfdv[m_slots[1][1]] += K22;
 		}
 	}
 }
\ No newline at end of file
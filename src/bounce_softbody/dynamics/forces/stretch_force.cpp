@@ -20,7 +20,7 @@
 #include <bounce_softbody/dynamics/particle.h>
 #include <bounce_softbody/sparse/sparse_force_solver.h>
 #include <bounce_softbody/sparse/dense_vec3.h>
-#include <bounce_softbody/sparse/sparse_mat33.h>
+#include <bounce_softbody/sparse/block_sparse_mat33.h>
 
 // This file contains an implementation for the stretch constraint described 
 // in the work of David Baraff and Andrew Witkin: "Large Steps in Cloth Simulation".
@@ -75,6 +75,8 @@ b3StretchForce::b3StretchForce(const b3StretchForceDef* def)
 	m_f1.SetZero();
 	m_f2.SetZero();
 	m_f3.SetZero();
+	m_batch = nullptr;
+	m_batchIndex = 0;
 
 	scalar u1 = def->u1, v1 = def->v1;
 	scalar u2 = def->u2, v2 = def->v2;
@@ -111,11 +113,24 @@ bool b3StretchForce::HasParticle(const b3Particle* particle) const
 	return m_p1 == particle || m_p2 == particle || m_p3 == particle;
 }
 
+u32 b3StretchForce::GetParticles(b3Particle* particles[B3_MAX_FORCE_PARTICLES]) const
+{
+	particles[0] = m_p1;
+	particles[1] = m_p2;
+	particles[2] = m_p3;
+	return 3;
+}
+
 void b3StretchForce::ClearForces()
 {
 	m_f1.SetZero();
 	m_f2.SetZero();
 	m_f3.SetZero();
+
+	if (m_batch)
+	{
+		m_batch->ClearForces(m_batchIndex);
+	}
 }
 
 void b3StretchForce::ComputeForces(const b3SparseForceSolverData* data)
@@ -136,8 +151,8 @@ void b3StretchForce::ComputeForces(const b3SparseForceSolverData* data)
 	b3DenseVec3& x = *data->x;
 	b3DenseVec3& v = *data->v;
 	b3DenseVec3& f = *data->f;
-	b3SparseMat33& dfdx = *data->dfdx;
-	b3SparseMat33& dfdv = *data->dfdv;
+	b3Mat33* dfdx = data->dfdx->values;
+	b3Mat33* dfdv = data->dfdv->values;
 
 	b3Vec3 x1 = x[i1];
 	b3Vec3 x2 = x[i2];
@@ -209,17 +224,17 @@ void b3StretchForce::ComputeForces(const b3SparseForceSolverData* data)
 				}
 			}
 
-			dfdx(i1, i1) += K[0][0];
-			dfdx(i1, i2) += K[0][1];
-			dfdx(i1, i3) += K[0][2];
+			dfdx[m_slots[0][0]] += K[0][0];
+			dfdx[m_slots[0][1]] += K[0][1];
+			dfdx[m_slots[0][2]] += K[0][2];
 
-			dfdx(i2, i1) += K[1][0];
-			dfdx(i2, i2) += K[1][1];
-			dfdx(i2, i3) += K[1][2];
+			dfdx[m_slots[1][0]] += K[1][0];
+			dfdx[m_slots[1][1]] += K[1][1];
+			dfdx[m_slots[1][2]] += K[1][2];
 
-			dfdx(i3, i1) += K[2][0];
-			dfdx(i3, i2) += K[2][1];
-			dfdx(i3, i3) += K[2][2];
+			dfdx[m_slots[2][0]] += K[2][0];
+			dfdx[m_slots[2][1]] += K[2][1];
+			dfdx[m_slots[2][2]] += K[2][2];
 		}
 
 		if (m_kd_u > scalar(0))
@@ -258,17 +273,17 @@ void b3StretchForce::ComputeForces(const b3SparseForceSolverData* data)
 				}
 			}
 
-			dfdv(i1, i1) += K[0][0];
-			dfdv(i1, i2) += K[0][1];
-			dfdv(i1, i3) += K[0][2];
+			dfdv[m_slots[0][0]] += K[0][0];
+			dfdv[m_slots[0][1]] += K[0][1];
+			dfdv[m_slots[0][2]] += K[0][2];
 
-			dfdv(i2, i1) += K[1][0];
-			dfdv(i2, i2) += K[1][1];
-			dfdv(i2, i3) += K[1][2];
+			dfdv[m_slots[1][0]] += K[1][0];
+			dfdv[m_slots[1][1]] += K[1][1];
+			dfdv[m_slots[1][2]] += K[1][2];
 
-			dfdv(i3, i1) += K[2][0];
-			dfdv(i3, i2) += K[2][1];
-			dfdv(i3, i3) += K[2][2];
+			dfdv[m_slots[2][0]] += K[2][0];
+			dfdv[m_slots[2][1]] += K[2][1];
+			dfdv[m_slots[2][2]] += K[2][2];
 		}
 	}
 
@@ -323,17 +338,17 @@ void b3StretchForce::ComputeForces(const b3SparseForceSolverData* data)
 				}
 			}
 
-			dfdx(i1, i1) += K[0][0];
-			dfdx(i1, i2) += K[0][1];
-			dfdx(i1, i3) += K[0][2];
+			dfdx[m_slots[0][0]] += K[0][0];
+			dfdx[m_slots[0][1]] += K[0][1];
+			dfdx[m_slots[0][2]] += K[0][2];
 
-			dfdx(i2, i1) += K[1][0];
-			dfdx(i2, i2) += K[1][1];
-			dfdx(i2, i3) += K[1][2];
+			dfdx[m_slots[1][0]] += K[1][0];
+			dfdx[m_slots[1][1]] += K[1][1];
+			dfdx[m_slots[1][2]] += K[1][2];
 
-			dfdx(i3, i1) += K[2][0];
-			dfdx(i3, i2) += K[2][1];
-			dfdx(i3, i3) += K[2][2];
+			dfdx[m_slots[2][0]] += K[2][0];
+			dfdx[m_slots[2][1]] += K[2][1];
+			dfdx[m_slots[2][2]] += K[2][2];
 		}
 
 		if (m_kd_v > scalar(0))
@@ -373,17 +388,17 @@ void b3StretchForce::ComputeForces(const b3SparseForceSolverData* data)
 				}
 			}
 
-			dfdv(i1, i1) += K[0][0];
-			dfdv(i1, i2) += K[0][1];
-			dfdv(i1, i3) += K[0][2];
+			dfdv[m_slots[0][0]] += K[0][0];
+			dfdv[m_slots[0][1]] += K[0][1];
+			dfdv[m_slots[0][2]] += K[0][2];
 
-			dfdv(i2, i1) += K[1][0];
-			dfdv(i2, i2) += K[1][1];
-			dfdv(i2, i3) += K[1][2];
+			dfdv[m_slots[1][0]] += K[1][0];
+			dfdv[m_slots[1][1]] += K[1][1];
+			dfdv[m_slots[1][2]] += K[1][2];
 
-			dfdv(i3, i1) += K[2][0];
-			dfdv(i3, i2) += K[2][1];
-			dfdv(i3, i3) += K[2][2];
+			dfdv[m_slots[2][0]] += K[2][0];
+			dfdv[m_slots[2][1]] += K[2][1];
+			dfdv[m_slots[2][2]] += K[2][2];
 		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,423 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce_softbody/dynamics/forces/stretch_force_batch.h>
+#include <bounce_softbody/dynamics/forces/stretch_force.h>
+#include <bounce_softbody/dynamics/particle.h>
+#include <bounce_softbody/sparse/sparse_force_solver.h>
+#include <bounce_softbody/sparse/dense_vec3.h>
+#include <bounce_softbody/sparse/block_sparse_mat33.h>
+#include <bounce_softbody/common/math/scalar4.h>
+
+// The number of scalar arrays in the batch.
+#define B3_STRETCH_BATCH_SCALARS 18
+
+// The pairs of vertices of the distinct blocks of the force Jacobians.
+// Block (j, i) is the transpose of block (i, j). Each block is symmetric, so they are equal.
+static const u32 b3_stretchPairs[6][2] = { { 0, 0 }, { 0, 1 }, { 0, 2 }, { 1, 1 }, { 1, 2 }, { 2, 2 } };
+
+b3StretchForceBatch::b3StretchForceBatch()
+{
+	m_count = 0;
+	m_capacity = 0;
+	m_i1 = nullptr;
+	m_i2 = nullptr;
+	m_i3 = nullptr;
+	m_slots = nullptr;
+	m_scalars = nullptr;
+	m_f = nullptr;
+}
+
+b3StretchForceBatch::~b3StretchForceBatch()
+{
+	Destroy();
+}
+
+void b3StretchForceBatch::Destroy()
+{
+	if (m_capacity == 0)
+	{
+		return;
+	}
+
+	b3Free(m_i1);
+	b3Free(m_i2);
+	b3Free(m_i3);
+	b3Free(m_slots);
+	b3Free(m_scalars);
+	b3Free(m_f);
+
+	m_count = 0;
+	m_capacity = 0;
+	m_i1 = nullptr;
+	m_i2 = nullptr;
+	m_i3 = nullptr;
+	m_slots = nullptr;
+	m_scalars = nullptr;
+	m_f = nullptr;
+}
+
+void b3StretchForceBatch::Create(b3StretchForce** forces, u32 count)
+{
+	Destroy();
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	m_count = count;
+	m_capacity = (count + 3) & ~u32(3);
+
+	m_i1 = (u32*)b3Alloc(m_capacity * sizeof(u32));
+	m_i2 = (u32*)b3Alloc(m_capacity * sizeof(u32));
+	m_i3 = (u32*)b3Alloc(m_capacity * sizeof(u32));
+	m_slots = (u32*)b3Alloc(9 * m_capacity * sizeof(u32));
+	m_f = (b3Vec3*)b3Alloc(3 * m_capacity * sizeof(b3Vec3));
+
+	// The padding lanes have zero parameters and read the first particle.
+	m_scalars = (scalar*)b3Alloc(B3_STRETCH_BATCH_SCALARS * m_capacity * sizeof(scalar));
+	memset(m_scalars, 0, B3_STRETCH_BATCH_SCALARS * m_capacity * sizeof(scalar));
+
+	scalar* arrays[B3_STRETCH_BATCH_SCALARS];
+	for (u32 i = 0; i < B3_STRETCH_BATCH_SCALARS; ++i)
+	{
+		arrays[i] = m_scalars + i * m_capacity;
+	}
+
+	m_alpha = arrays[0];
+	m_du1 = arrays[1];
+	m_dv1 = arrays[2];
+	m_du2 = arrays[3];
+	m_dv2 = arrays[4];
+	m_inv_det = arrays[5];
+	m_dwudx[0] = arrays[6];
+	m_dwudx[1] = arrays[7];
+	m_dwudx[2] = arrays[8];
+	m_dwvdx[0] = arrays[9];
+	m_dwvdx[1] = arrays[10];
+	m_dwvdx[2] = arrays[11];
+	m_ks_u = arrays[12];
+	m_kd_u = arrays[13];
+	m_b_u = arrays[14];
+	m_ks_v = arrays[15];
+	m_kd_v = arrays[16];
+	m_b_v = arrays[17];
+
+	for (u32 i = 0; i < m_capacity; ++i)
+	{
+		if (i < count)
+		{
+			b3StretchForce* force = forces[i];
+
+			m_i1[i] = force->m_p1->m_solverId;
+			m_i2[i] = force->m_p2->m_solverId;
+			m_i3[i] = force->m_p3->m_solverId;
+
+			for (u32 j = 0; j < 3; ++j)
+			{
+				for (u32 k = 0; k < 3; ++k)
+				{
+					m_slots[9 * i + 3 * j + k] = force->m_slots[j][k];
+				}
+			}
+
+			SetParameters(i, force);
+
+			force->m_batch = this;
+			force->m_batchIndex = i;
+		}
+		else
+		{
+			m_i1[i] = 0;
+			m_i2[i] = 0;
+			m_i3[i] = 0;
+
+			for (u32 j = 0; j < 9; ++j)
+			{
+				m_slots[9 * i + j] = 0;
+			}
+		}
+
+		m_f[3 * i + 0].SetZero();
+		m_f[3 * i + 1].SetZero();
+		m_f[3 * i + 2].SetZero();
+	}
+}
+
+void b3StretchForceBatch::GetParticles(u32 index, u32 particles[3]) const
+{
+	B3_ASSERT(index < m_count);
+	particles[0] = m_i1[index];
+	particles[1] = m_i2[index];
+	particles[2] = m_i3[index];
+}
+
+void b3StretchForceBatch::SetParameters(u32 index, const b3StretchForce* force)
+{
+	B3_ASSERT(index < m_count);
+	m_alpha[index] = force->m_alpha;
+	m_du1[index] = force->m_du1;
+	m_dv1[index] = force->m_dv1;
+	m_du2[index] = force->m_du2;
+	m_dv2[index] = force->m_dv2;
+	m_inv_det[index] = force->m_inv_det;
+	m_dwudx[0][index] = force->m_dwudx.x;
+	m_dwudx[1][index] = force->m_dwudx.y;
+	m_dwudx[2][index] = force->m_dwudx.z;
+	m_dwvdx[0][index] = force->m_dwvdx.x;
+	m_dwvdx[1][index] = force->m_dwvdx.y;
+	m_dwvdx[2][index] = force->m_dwvdx.z;
+	m_ks_u[index] = force->m_ks_u;
+	m_kd_u[index] = force->m_kd_u;
+	m_b_u[index] = force->m_b_u;
+	m_ks_v[index] = force->m_ks_v;
+	m_kd_v[index] = force->m_kd_v;
+	m_b_v[index] = force->m_b_v;
+}
+
+void b3StretchForceBatch::ClearForces(u32 index)
+{
+	B3_ASSERT(index < m_count);
+	m_f[3 * index + 0].SetZero();
+	m_f[3 * index + 1].SetZero();
+	m_f[3 * index + 2].SetZero();
+}
+
+b3Vec3 b3StretchForceBatch::GetActionForce(u32 index, u32 vertex) const
+{
+	B3_ASSERT(index < m_count);
+	B3_ASSERT(vertex < 3);
+	return m_f[3 * index + vertex];
+}
+
+void b3StretchForceBatch::ComputeForces(const b3SparseForceSolverData* data, u32 begin, u32 end)
+{
+	B3_ASSERT(begin % 4 == 0);
+	B3_ASSERT(end <= m_count);
+
+	for (u32 i = begin; i < end; i += 4)
+	{
+		ComputeGroup(data, i);
+	}
+}
+
+// The stiffness and damping blocks of a direction.
+// See b3StretchForce::ComputeForces for the scalar version. 
+// With n = w / |w| and dCdx_i = alpha * dwdx_i * n the Jacobian blocks are 
+// K_ij = -ks * dwdx_i * dwdx_j * (h * I + (alpha^2 - h) * n * n^T) 
+// D_ij = -kd * dwdx_i * dwdx_j * alpha^2 * n * n^T 
+// where h = alpha * C / |w| if |w| > b and zero otherwise.
+struct b3StretchDirection4
+{
+	b3StretchDirection4(const b3Vec3x4& w, const b3Vec3x4& dw, 
+		const b3Scalar4& alpha, const b3Scalar4& ks, const b3Scalar4& kd, const b3Scalar4& b)
+	{
+		b3Scalar4 zero(scalar(0));
+		b3Scalar4 one(scalar(1));
+
+		b3Scalar4 len = b3Length(w);
+		b3Bool4 positive = len > zero;
+
+		b3Scalar4 inv_len = one / b3Select(positive, len, one);
+		n = inv_len * w;
+
+		b3Scalar4 C = alpha * (len - b);
+		b3Scalar4 dCdt = alpha * b3Dot(n, dw);
+
+		// Force magnitude along dwdx_i * n
+		F = b3Select(positive, alpha * (-ks * C - kd * dCdt), zero);
+
+		// Are the eigenvalues positive?
+		b3Scalar4 h = b3Select(len > b, C * alpha * inv_len, zero);
+		b3Scalar4 alpha2 = alpha * alpha;
+
+		b3Scalar4 d = b3Select(positive, -ks * h, zero);
+		b3Scalar4 a = b3Select(positive, -ks * (alpha2 - h), zero);
+		b3Scalar4 c = b3Select(positive, -kd * alpha2, zero);
+
+		// Symmetric blocks in the order xx, xy, xz, yy, yz, zz
+		b3Scalar4 nn[6] = { n.x * n.x, n.x * n.y, n.x * n.z, n.y * n.y, n.y * n.z, n.z * n.z };
+		
+		for (u32 i = 0; i < 6; ++i)
+		{
+			K[i] = a * nn[i];
+			D[i] = c * nn[i];
+		}
+
+		K[0] = K[0] + d;
+		K[3] = K[3] + d;
+		K[5] = K[5] + d;
+	}
+
+	b3Vec3x4 n;
+	b3Scalar4 F;
+	b3Scalar4 K[6];
+	b3Scalar4 D[6];
+};
+
+// Add a symmetric block stored as xx, xy, xz, yy, yz, zz.
+static B3_FORCE_INLINE void b3AddSymmetric(b3Mat33& A, const scalar* s)
+{
+	A.x.x += s[0]; A.y.x += s[1]; A.z.x += s[2];
+	A.x.y += s[1]; A.y.y += s[3]; A.z.y += s[4];
+	A.x.z += s[2]; A.y.z += s[4]; A.z.z += s[5];
+}
+
+void b3StretchForceBatch::ComputeGroup(const b3SparseForceSolverData* data, u32 first)
+{
+	const b3DenseVec3& x = *data->x;
+	const b3DenseVec3& v = *data->v;
+	b3DenseVec3& f = *data->f;
+	b3Mat33* dfdx = data->dfdx->values;
+	b3Mat33* dfdv = data->dfdv->values;
+
+	const u32* i1 = m_i1 + first;
+	const u32* i2 = m_i2 + first;
+	const u32* i3 = m_i3 + first;
+
+	b3Vec3x4 x1(x[i1[0]], x[i1[1]], x[i1[2]], x[i1[3]]);
+	b3Vec3x4 x2(x[i2[0]], x[i2[1]], x[i2[2]], x[i2[3]]);
+	b3Vec3x4 x3(x[i3[0]], x[i3[1]], x[i3[2]], x[i3[3]]);
+
+	b3Vec3x4 v1(v[i1[0]], v[i1[1]], v[i1[2]], v[i1[3]]);
+	b3Vec3x4 v2(v[i2[0]], v[i2[1]], v[i2[2]], v[i2[3]]);
+	b3Vec3x4 v3(v[i3[0]], v[i3[1]], v[i3[2]], v[i3[3]]);
+
+	b3Scalar4 alpha = b3Scalar4::Load(m_alpha + first);
+	b3Scalar4 du1 = b3Scalar4::Load(m_du1 + first);
+	b3Scalar4 dv1 = b3Scalar4::Load(m_dv1 + first);
+	b3Scalar4 du2 = b3Scalar4::Load(m_du2 + first);
+	b3Scalar4 dv2 = b3Scalar4::Load(m_dv2 + first);
+	b3Scalar4 inv_det = b3Scalar4::Load(m_inv_det + first);
+
+	b3Scalar4 dwudx[3], dwvdx[3];
+	for (u32 i = 0; i < 3; ++i)
+	{
+		dwudx[i] = b3Scalar4::Load(m_dwudx[i] + first);
+		dwvdx[i] = b3Scalar4::Load(m_dwvdx[i] + first);
+	}
+
+	b3Scalar4 ks_u = b3Scalar4::Load(m_ks_u + first);
+	b3Scalar4 kd_u = b3Scalar4::Load(m_kd_u + first);
+	b3Scalar4 b_u = b3Scalar4::Load(m_b_u + first);
+	b3Scalar4 ks_v = b3Scalar4::Load(m_ks_v + first);
+	b3Scalar4 kd_v = b3Scalar4::Load(m_kd_v + first);
+	b3Scalar4 b_v = b3Scalar4::Load(m_b_v + first);
+
+	b3Vec3x4 dx1 = x2 - x1;
+	b3Vec3x4 dx2 = x3 - x1;
+
+	b3Vec3x4 wu = inv_det * (dv2 * dx1 - dv1 * dx2);
+	b3Vec3x4 wv = inv_det * (-du2 * dx1 + du1 * dx2);
+
+	// Velocities weighted by the derivatives of w
+	b3Vec3x4 dwu = dwudx[0] * v1 + dwudx[1] * v2 + dwudx[2] * v3;
+	b3Vec3x4 dwv = dwvdx[0] * v1 + dwvdx[1] * v2 + dwvdx[2] * v3;
+
+	b3StretchDirection4 su(wu, dwu, alpha, ks_u, kd_u, b_u);
+	b3StretchDirection4 sv(wv, dwv, alpha, ks_v, kd_v, b_v);
+
+	// Forces
+	b3Vec3x4 fu = su.F * su.n;
+	b3Vec3x4 fv = sv.F * sv.n;
+
+	scalar fs[3][3][4];
+	for (u32 i = 0; i < 3; ++i)
+	{
+		b3Vec3x4 fi = dwudx[i] * fu + dwvdx[i] * fv;
+		fi.x.Store(fs[i][0]);
+		fi.y.Store(fs[i][1]);
+		fi.z.Store(fs[i][2]);
+	}
+
+	// Jacobians
+	scalar K[6][6][4];
+	scalar D[6][6][4];
+	for (u32 p = 0; p < 6; ++p)
+	{
+		u32 i = b3_stretchPairs[p][0];
+		u32 j = b3_stretchPairs[p][1];
+
+		b3Scalar4 cu = dwudx[i] * dwudx[j];
+		b3Scalar4 cv = dwvdx[i] * dwvdx[j];
+
+		for (u32 k = 0; k < 6; ++k)
+		{
+			(cu * su.K[k] + cv * sv.K[k]).Store(K[p][k]);
+			(cu * su.D[k] + cv * sv.D[k]).Store(D[p][k]);
+		}
+	}
+
+	// Lanes with stiffness and damping
+	b3Scalar4 zero(scalar(0));
+	u32 stiff = ((ks_u > zero) | (ks_v > zero)).GetBits();
+	u32 damped = ((kd_u > zero) | (kd_v > zero)).GetBits();
+
+	// Scatter
+	u32 laneCount = b3Min(m_count - first, u32(4));
+	for (u32 l = 0; l < laneCount; ++l)
+	{
+		u32 index = first + l;
+		u32 is[3] = { i1[l], i2[l], i3[l] };
+
+		for (u32 i = 0; i < 3; ++i)
+		{
+			b3Vec3 fi(fs[i][0][l], fs[i][1][l], fs[i][2][l]);
+
+			f[is[i]] += fi;
+			m_f[3 * index + i] += fi;
+		}
+
+		const u32* slots = m_slots + 9 * index;
+
+		if (stiff & (1 << l))
+		{
+			for (u32 p = 0; p < 6; ++p)
+			{
+				u32 i = b3_stretchPairs[p][0];
+				u32 j = b3_stretchPairs[p][1];
+
+				scalar s[6] = { K[p][0][l], K[p][1][l], K[p][2][l], K[p][3][l], K[p][4][l], K[p][5][l] };
+
+				b3AddSymmetric(dfdx[slots[3 * i + j]], s);
+				if (i != j)
+				{
+					b3AddSymmetric(dfdx[slots[3 * j + i]], s);
+				}
+			}
+		}
+
+		if (damped & (1 << l))
+		{
+			for (u32 p = 0; p < 6; ++p)
+			{
+				u32 i = b3_stretchPairs[p][0];
+				u32 j = b3_stretchPairs[p][1];
+
+				scalar s[6] = { D[p][0][l], D[p][1][l], D[p][2][l], D[p][3][l], D[p][4][l], D[p][5][l] };
+
+				b3AddSymmetric(dfdv[slots[3 * i + j]], s);
+				if (i != j)
+				{
+					b3AddSymmetric(dfdv[slots[3 * j + i]], s);
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
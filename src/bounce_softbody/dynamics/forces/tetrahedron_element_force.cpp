@@ -20,7 +20,8 @@
 #include <bounce_softbody/dynamics/particle.h>
 #include <bounce_softbody/sparse/sparse_force_solver.h>
 #include <bounce_softbody/sparse/dense_vec3.h>
-#include <bounce_softbody/sparse/sparse_mat33.h>
+#include <bounce_softbody/sparse/block_sparse_mat33.h>
+#include <bounce_softbody/common/math/scalar4.h>
 
 // This work is based on the paper "Interactive Virtual Materials" written by 
 // Matthias Mueller Fischer
@@ -216,6 +217,15 @@ bool b3TetrahedronElementForce::HasParticle(const b3Particle* particle) const
 	return m_p1 == particle || m_p2 == particle || m_p3 == particle || m_p4 == particle;
 }
 
+u32 b3TetrahedronElementForce::GetParticles(b3Particle* particles[B3_MAX_FORCE_PARTICLES]) const
+{
+	particles[0] = m_p1;
+	particles[1] = m_p2;
+	particles[2] = m_p3;
+	particles[3] = m_p4;
+	return 4;
+}
+
 void b3TetrahedronElementForce::ResetElementData()
 {
 	b3Vec3 x1 = m_x1, x2 = m_x2;
@@ -310,35 +320,117 @@ static b3Quat b3ExtractRotation(const b3Mat33& A, const b3Quat& q0, u32 maxItera
 	return q;
 }
 
-void b3TetrahedronElementForce::ComputeForces(const b3SparseForceSolverData* data)
+// Four quaternions stored by component.
+struct b3Quat4
 {
-	const b3DenseVec3& x = *data->x;
-	const b3DenseVec3& v = *data->v;
-	
-	b3DenseVec3& f = *data->f;
-	
-	b3SparseMat33& dfdx = *data->dfdx;
-	b3SparseMat33& dfdv = *data->dfdv;
+	// Same as b3Quat::GetRotationMatrix in each lane.
+	b3Mat33x4 GetRotationMatrix() const
+	{
+		b3Scalar4 x = v.x, y = v.y, z = v.z, w = s;
+		b3Scalar4 one(scalar(1));
+
+		b3Scalar4 x2 = x + x, y2 = y + y, z2 = z + z;
+		b3Scalar4 xx = x * x2, xy = x * y2, xz = x * z2;
+		b3Scalar4 yy = y * y2, yz = y * z2, zz = z * z2;
+		b3Scalar4 wx = w * x2, wy = w * y2, wz = w * z2;
+
+		return b3Mat33x4(
+			b3Vec3x4(one - (yy + zz), xy + wz, xz - wy),
+			b3Vec3x4(xy - wz, one - (xx + zz), yz + wx),
+			b3Vec3x4(xz + wy, yz - wx, one - (xx + yy)));
+	}
 
-	u32 i1 = m_p1->m_solverId;
-	u32 i2 = m_p2->m_solverId;
-	u32 i3 = m_p3->m_solverId;
-	u32 i4 = m_p4->m_solverId;
+	b3Vec3x4 v;
+	b3Scalar4 s;
+};
 
-	b3Vec3 x1 = m_x1;
-	b3Vec3 x2 = m_x2;
-	b3Vec3 x3 = m_x3;
-	b3Vec3 x4 = m_x4;
+// Extract the rotations of four deformations.
+// This runs b3ExtractRotation in each lane. A lane stops when it converges 
+// and the loop stops when all the lanes have converged.
+static void b3ExtractRotation4(b3Quat4& q, const b3Mat33x4& A, u32 maxIterations = 32)
+{
+	const scalar kTol = scalar(1.0e-9);
 
-	b3Vec3 p1 = x[i1];
-	b3Vec3 p2 = x[i2];
-	b3Vec3 p3 = x[i3];
-	b3Vec3 p4 = x[i4];
+	b3Scalar4 zero(scalar(0));
+	b3Scalar4 one(scalar(1));
+	b3Scalar4 tol(kTol);
+	b3Scalar4 epsilon(B3_EPSILON);
 
-	b3Vec3 v1 = v[i1];
-	b3Vec3 v2 = v[i2];
-	b3Vec3 v3 = v[i3];
-	b3Vec3 v4 = v[i4];
+	b3Bool4 active(true);
+
+	for (u32 iteration = 0; iteration < maxIterations; ++iteration)
+	{
+		b3Mat33x4 R = q.GetRotationMatrix();
+
+		b3Scalar4 s = b3Abs(b3Dot(R.x, A.x) + b3Dot(R.y, A.y) + b3Dot(R.z, A.z));
+
+		active = active & (s > zero);
+
+		b3Scalar4 inv_s = one / s + tol;
+
+		b3Vec3x4 v = b3Cross(R.x, A.x) + b3Cross(R.y, A.y) + b3Cross(R.z, A.z);
+
+		b3Vec3x4 omega = inv_s * v;
+
+		b3Scalar4 w = b3Length(omega);
+
+		active = active & (w >= tol);
+
+		u32 activeBits = active.GetBits();
+		if (activeBits == 0)
+		{
+			break;
+		}
+
+		// The axis-angle rotations are built per lane.
+		scalar ox[4], oy[4], oz[4], ow[4];
+		omega.x.Store(ox);
+		omega.y.Store(oy);
+		omega.z.Store(oz);
+		w.Store(ow);
+
+		b3Quat oq[4];
+		for (u32 l = 0; l < 4; ++l)
+		{
+			if (activeBits & (1 << l))
+			{
+				oq[l].SetAxisAngle(b3Vec3(ox[l], oy[l], oz[l]) / ow[l], ow[l]);
+			}
+			else
+			{
+				oq[l].SetIdentity();
+			}
+		}
+
+		b3Quat4 omega_q;
+		omega_q.v = b3Vec3x4(oq[0].v, oq[1].v, oq[2].v, oq[3].v);
+		omega_q.s = b3Scalar4(oq[0].s, oq[1].s, oq[2].s, oq[3].s);
+
+		// q = omega_q * q
+		b3Quat4 p;
+		p.v = b3Cross(omega_q.v, q.v) + omega_q.s * q.v + q.s * omega_q.v;
+		p.s = omega_q.s * q.s - b3Dot(omega_q.v, q.v);
+
+		// Normalize
+		b3Scalar4 len = b3Sqrt(p.v.x * p.v.x + p.v.y * p.v.y + p.v.z * p.v.z + p.s * p.s);
+		b3Bool4 positive = len > epsilon;
+		b3Scalar4 inv_len = b3Select(positive, one / len, one);
+		p.v = b3Select(positive, inv_len * p.v, p.v);
+		p.s = b3Select(positive, inv_len * p.s, p.s);
+
+		q.v = b3Select(active, p.v, q.v);
+		q.s = b3Select(active, p.s, q.s);
+	}
+}
+
+void b3TetrahedronElementForce::ComputeForces(const b3SparseForceSolverData* data)
+{
+	const b3DenseVec3& x = *data->x;
+
+	b3Vec3 p1 = x[m_p1->m_solverId];
+	b3Vec3 p2 = x[m_p2->m_solverId];
+	b3Vec3 p3 = x[m_p3->m_solverId];
+	b3Vec3 p4 = x[m_p4->m_solverId];
 
 	b3Vec3 e1 = p2 - p1;
 	b3Vec3 e2 = p3 - p1;
@@ -375,20 +467,128 @@ void b3TetrahedronElementForce::ComputeForces(const b3SparseForceSolverData* dat
 		}
 	}
 
-	u32 is[4] = { i1, i2, i3, i4 };
+	ApplyForces(data, R, K);
+}
+
+void b3TetrahedronElementForce::ComputeForces(b3TetrahedronElementForce** forces, u32 count, const b3SparseForceSolverData* data)
+{
+	const b3DenseVec3& x = *data->x;
+
+	for (u32 first = 0; first < count; first += 4)
+	{
+		u32 laneCount = b3Min(count - first, u32(4));
+
+		// The unused lanes repeat the first element.
+		b3TetrahedronElementForce* lanes[4];
+		for (u32 l = 0; l < 4; ++l)
+		{
+			lanes[l] = forces[first + (l < laneCount ? l : 0)];
+		}
+
+		// Deformation gradients and warm starting rotations
+		b3Mat33 F[4];
+		b3Quat q0[4];
+		for (u32 l = 0; l < 4; ++l)
+		{
+			b3TetrahedronElementForce* force = lanes[l];
+
+			b3Vec3 p1 = x[force->m_p1->m_solverId];
+			b3Vec3 p2 = x[force->m_p2->m_solverId];
+			b3Vec3 p3 = x[force->m_p3->m_solverId];
+			b3Vec3 p4 = x[force->m_p4->m_solverId];
+
+			b3Mat33 E(p2 - p1, p3 - p1, p4 - p1);
+
+			F[l] = E * force->m_invE;
+			q0[l] = force->m_q;
+		}
+
+		b3Quat4 q;
+		q.v = b3Vec3x4(q0[0].v, q0[1].v, q0[2].v, q0[3].v);
+		q.s = b3Scalar4(q0[0].s, q0[1].s, q0[2].s, q0[3].s);
+
+		b3ExtractRotation4(q, b3Mat33x4(F));
+
+		scalar qx[4], qy[4], qz[4], qs[4];
+		q.v.x.Store(qx);
+		q.v.y.Store(qy);
+		q.v.z.Store(qz);
+		q.s.Store(qs);
+
+		for (u32 l = 0; l < laneCount; ++l)
+		{
+			lanes[l]->m_q.Set(qx[l], qy[l], qz[l], qs[l]);
+		}
+
+		b3Mat33x4 R = q.GetRotationMatrix();
+		b3Mat33x4 RT = b3Transpose(R);
+
+		b3Mat33 Rs[4];
+		R.Store(Rs);
+
+		// K = R * K0 * R^T
+		b3Mat33 K[4][16];
+		for (u32 i = 0; i < 16; ++i)
+		{
+			b3Mat33 K0[4] = { lanes[0]->m_K[i], lanes[1]->m_K[i], lanes[2]->m_K[i], lanes[3]->m_K[i] };
+			
+			b3Mat33 k[4];
+			(R * b3Mat33x4(K0) * RT).Store(k);
+
+			for (u32 l = 0; l < laneCount; ++l)
+			{
+				K[l][i] = k[l];
+			}
+		}
+
+		for (u32 l = 0; l < laneCount; ++l)
+		{
+			lanes[l]->ApplyForces(data, Rs[l], K[l]);
+		}
+	}
+}
+
+void b3TetrahedronElementForce::ApplyForces(const b3SparseForceSolverData* data, const b3Mat33& R, const b3Mat33 K[16])
+{
+	const b3DenseVec3& x = *data->x;
+	const b3DenseVec3& v = *data->v;
+	
+	b3DenseVec3& f = *data->f;
 	
+	b3Mat33* dfdx = data->dfdx->values;
+	b3Mat33* dfdv = data->dfdv->values;
+
+	u32 i1 = m_p1->m_solverId;
+	u32 i2 = m_p2->m_solverId;
+	u32 i3 = m_p3->m_solverId;
+	u32 i4 = m_p4->m_solverId;
+
+	b3Vec3 x1 = m_x1;
+	b3Vec3 x2 = m_x2;
+	b3Vec3 x3 = m_x3;
+	b3Vec3 x4 = m_x4;
+
+	b3Vec3 p1 = x[i1];
+	b3Vec3 p2 = x[i2];
+	b3Vec3 p3 = x[i3];
+	b3Vec3 p4 = x[i4];
+
+	b3Vec3 v1 = v[i1];
+	b3Vec3 v2 = v[i2];
+	b3Vec3 v3 = v[i3];
+	b3Vec3 v4 = v[i4];
+
+	// Inverse rotation
+	b3Mat33 RT = b3Transpose(R);
+
 	for (u32 i = 0; i < 4; ++i)
 	{
-		u32 vi = is[i];
-
 		for (u32 j = 0; j < 4; ++j)
 		{
-			u32 vj = is[j];
-
 			b3Mat33 k = K[i + 4 * j];
 
 			// Negate K
-			dfdx(vi, vj) -= k;
+			dfdx[m_slots[i][j]] -= k;
 		}
 	}
 
@@ -448,16 +648,12 @@ void b3TetrahedronElementForce::ComputeForces(const b3SparseForceSolverData* dat
 
 		for (u32 i = 0; i < 4; ++i)
 		{
-			u32 vi = is[i];
-
 			for (u32 j = 0; j < 4; ++j)
 			{
-				u32 vj = is[j];
-
 				b3Mat33 k = K[i + 4 * j];
 
 				// Negate K
-				dfdv(vi, vj) -= m_stiffnessDamping * k;
+				dfdv[m_slots[i][j]] -= m_stiffnessDamping * k;
 			}
 		}
 	}
@@ -20,7 +20,7 @@
 #include <bounce_softbody/dynamics/particle.h>
 #include <bounce_softbody/sparse/sparse_force_solver.h>
 #include <bounce_softbody/sparse/dense_vec3.h>
-#include <bounce_softbody/sparse/sparse_mat33.h>
+#include <bounce_softbody/sparse/block_sparse_mat33.h>
 
 // Implementation of "Adaptive cloth simulation using corotational finite elements" by 
 // Jan Bender and Crispin Deul.
@@ -205,6 +205,14 @@ bool b3TriangleElementForce::HasParticle(const b3Particle* particle) const
 	return m_p1 == particle || m_p2 == particle || m_p3 == particle;
 }
 
+u32 b3TriangleElementForce::GetParticles(b3Particle* particles[B3_MAX_FORCE_PARTICLES]) const
+{
+	particles[0] = m_p1;
+	particles[1] = m_p2;
+	particles[2] = m_p3;
+	return 3;
+}
+
 void b3TriangleElementForce::ResetElementData()
 {
 	b3Vec3 p1 = m_v1;
@@ -289,8 +297,8 @@ void b3TriangleElementForce::ComputeForces(const b3SparseForceSolverData* data)
 
 	b3DenseVec3& f = *data->f;
 	
-	b3SparseMat33& dfdx = *data->dfdx;
-	b3SparseMat33& dfdv = *data->dfdv;
+	b3Mat33* dfdx = data->dfdx->values;
+	b3Mat33* dfdv = data->dfdv->values;
 
 	u32 i1 = m_p1->m_solverId;
 	u32 i2 = m_p2->m_solverId;
@@ -410,20 +418,14 @@ void b3TriangleElementForce::ComputeForces(const b3SparseForceSolverData* data)
 		}
 	}
 
-	u32 is[3] = { i1, i2, i3 };
-
 	for (u32 i = 0; i < 3; ++i)
 	{
-		u32 vi = is[i];
-
 		for (u32 j = 0; j < 3; ++j)
 		{
-			u32 vj = is[j];
-
 			b3Mat33 k = K[i + 3 * j];
 
 			// Negate K 
-			dfdx(vi, vj) -= k;
+			dfdx[m_slots[i][j]] -= k;
 		}
 	}
 
@@ -452,16 +454,12 @@ void b3TriangleElementForce::ComputeForces(const b3SparseForceSolverData* data)
 
 		for (u32 i = 0; i < 3; ++i)
 		{
-			u32 vi = is[i];
-
 			for (u32 j = 0; j < 3; ++j)
 			{
-				u32 vj = is[j];
-
 				b3Mat33 k = K[i + 3 * j];
 
 				// Negate K
-				dfdv(vi, vj) -= m_stiffnessDamping * k;
+				dfdv[m_slots[i][j]] -= m_stiffnessDamping * k;
 			}
 		}
 	}
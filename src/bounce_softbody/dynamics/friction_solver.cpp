@@ -18,6 +18,7 @@
 
 #include <bounce_softbody/dynamics/friction_solver.h>
 #include <bounce_softbody/dynamics/particle.h>
+#include <bounce_softbody/dynamics/particle_storage.h>
 #include <bounce_softbody/dynamics/contacts/sphere_shape_contact.h>
 #include <bounce_softbody/dynamics/fixtures/sphere_fixture.h>
 #include <bounce_softbody/dynamics/fixtures/world_fixture.h>
@@ -27,12 +28,16 @@
 b3FrictionSolver::b3FrictionSolver(const b3FrictionSolverDef& def)
 {
 	m_step = def.step;
+	m_particles = def.particles;
 	m_shapeContactCount = def.shapeContactCount;
 	m_shapeContacts = def.shapeContacts;
 }
 
 void b3FrictionSolver::Solve()
 {
+	b3DenseVec3& velocities = m_particles->velocities;
+	const scalar* invMasses = m_particles->invMasses;
+
 	for (u32 i = 0; i < m_shapeContactCount; ++i)
 	{
 		b3SphereAndShapeContact* c = m_shapeContacts[i];
@@ -45,8 +50,10 @@ void b3FrictionSolver::Solve()
 		b3Particle* p1 = f1->m_p;
 		b3WorldFixture* f2 = c->m_f2;
 
-		b3Vec3 v1 = p1->m_velocity;
-		scalar m1 = p1->m_invMass;
+		u32 i1 = p1->m_solverId;
+
+		b3Vec3 v1 = velocities[i1];
+		scalar m1 = invMasses[i1];
 		
 		b3Vec3 tangent1 = c->m_tangent1;
 		b3Vec3 tangent2 = c->m_tangent2;
@@ -77,6 +84,6 @@ void b3FrictionSolver::Solve()
 
 		v1 += m1 * P;
 
-		p1->m_velocity = v1;
+		velocities[i1] = v1;
 	}
 }
\ No newline at end of file
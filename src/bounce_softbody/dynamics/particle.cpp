@@ -24,58 +24,101 @@
 #include <bounce_softbody/dynamics/fixtures/tetrahedron_fixture.h>
 #include <bounce_softbody/sparse/sparse_force_solver.h>
 #include <bounce_softbody/sparse/dense_vec3.h>
-#include <bounce_softbody/sparse/sparse_mat33.h>
+#include <bounce_softbody/sparse/block_sparse_mat33.h>
 
 b3Particle::b3Particle(const b3ParticleDef& def, b3Body* body)
 {
 	m_body = body;
 	m_type = def.type;
-	m_position = def.position;
-	m_velocity = def.velocity;
-	m_force.SetZero();
-	m_translation.SetZero();
+
+	// Add to the body arrays.
+	m_storage = &body->m_particleStorage;
+	m_solverId = m_storage->Add(this);
+
+	m_storage->positions[m_solverId] = def.position;
+	m_storage->velocities[m_solverId] = def.velocity;
+	m_storage->forces[m_solverId].SetZero();
+	m_storage->translations[m_solverId].SetZero();
 	m_massDamping = def.massDamping;
+	m_fixtureMass = scalar(0);
+	m_fixtureCount = 0;
+
+	UpdateMass();
+
+	m_meshIndex = def.meshIndex;
+	m_mesh = nullptr;
+	m_userData = def.userData;
+}
+
+void b3Particle::AddFixtureMass(scalar mass)
+{
+	m_fixtureMass += mass;
+	++m_fixtureCount;
 
-	if (m_type == e_dynamicParticle)
+	UpdateMass();
+}
+
+void b3Particle::RemoveFixtureMass(scalar mass)
+{
+	B3_ASSERT(m_fixtureCount > 0);
+	--m_fixtureCount;
+
+	// Clear the rounding errors of the removed fixtures when none is left.
+	if (m_fixtureCount == 0)
 	{
-		m_mass = scalar(1);
-		m_invMass = scalar(1);
+		m_fixtureMass = scalar(0);
 	}
 	else
 	{
-		m_mass = scalar(0);
-		m_invMass = scalar(0);
+		m_fixtureMass -= mass;
 	}
 
-	m_meshIndex = def.meshIndex;
-	m_userData = def.userData;
+	UpdateMass();
 }
 
-void b3Particle::SetType(b3ParticleType type)
+void b3Particle::UpdateMass()
 {
-	if (m_type == type)
+	scalar& mass = m_storage->masses[m_solverId];
+	scalar& invMass = m_storage->invMasses[m_solverId];
+
+	// Static and kinematic particles have zero mass.
+	if (m_type == e_staticParticle || m_type == e_kinematicParticle)
 	{
+		mass = scalar(0);
+		invMass = scalar(0);
 		return;
 	}
 
-	m_type = type;
-
-	if (m_type == e_staticParticle || m_type == e_kinematicParticle)
+	if (m_fixtureMass > scalar(0))
 	{
-		m_mass = scalar(0);
-		m_invMass = scalar(0);
+		mass = m_fixtureMass;
+		invMass = scalar(1) / mass;
 	}
 	else
 	{
-		m_body->ResetMass();
+		// Force all dynamic particles to have non-zero mass.
+		mass = scalar(1);
+		invMass = scalar(1);
 	}
+}
 
-	m_force.SetZero();
-	m_translation.SetZero();
+void b3Particle::SetType(b3ParticleType type)
+{
+	if (m_type == type)
+	{
+		return;
+	}
+
+	m_type = type;
+
+	UpdateMass();
+
+	m_storage->forces[m_solverId].SetZero();
+	m_storage->translations[m_solverId].SetZero();
 
 	if (type == e_staticParticle)
 	{
-		m_velocity.SetZero();
+		m_storage->velocities[m_solverId].SetZero();
 		SynchronizeFixtures();
 	}
 
@@ -84,94 +127,49 @@ void b3Particle::SetType(b3ParticleType type)
 
 void b3Particle::DestroyFixtures()
 {
+	// Destroy spheres
+	while (m_sphereEdges.m_head)
 	{
-		// Destroy spheres
-		b3SphereFixture* s = m_body->m_sphereList.m_head;
-		while (s)
-		{
-			b3SphereFixture* s0 = s;
-			s = s->m_next;
-
-			if (s0->m_p == this)
-			{
-				m_body->DestroySphere(s0);
-			}
-		}
+		m_body->DestroySphere(m_sphereEdges.m_head->owner);
 	}
 
+	// Destroy triangles
+	while (m_triangleEdges.m_head)
 	{
-		// Destroy triangles
-		b3TriangleFixture* t = m_body->m_triangleList.m_head;
-		while (t)
-		{
-			b3TriangleFixture* t0 = t;
-			t = t->m_next;
-
-			if (t0->m_p1 == this || t0->m_p2 == this || t0->m_p3 == this)
-			{
-				m_body->DestroyTriangle(t0);
-			}
-		}
+		m_body->DestroyTriangle(m_triangleEdges.m_head->owner);
 	}
 
+	// Destroy tetrahedrons
+	while (m_tetrahedronEdges.m_head)
 	{
-		// Destroy tetrahedrons
-		b3TetrahedronFixture* t = m_body->m_tetrahedronList.m_head;
-		while (t)
-		{
-			b3TetrahedronFixture* t0 = t;
-			t = t->m_next;
-
-			if (t0->m_p1 == this || t0->m_p2 == this || t0->m_p3 == this || t0->m_p4 == this)
-			{
-				m_body->DestroyTetrahedron(t0);
-			}
-		}
+		m_body->DestroyTetrahedron(m_tetrahedronEdges.m_head->owner);
 	}
 }
 
 void b3Particle::DestroyForces()
 {
-	b3Force* f = m_body->m_forceList.m_head;
-	while (f)
+	// A force removes all of its edges when destroyed.
+	while (m_forceEdges.m_head)
 	{
-		b3Force* f0 = f;
-		f = f->m_next;
-
-		if (f0->HasParticle(this))
-		{
-			m_body->DestroyForce(f0);
-		}
+		m_body->DestroyForce(m_forceEdges.m_head->owner);
 	}
 }
 
 void b3Particle::DestroyContacts()
 {
 	// Destroy shape contacts
-	b3SphereAndShapeContact* c = m_body->m_contactManager.m_shapeContactList.m_head;
-	while (c)
+	while (m_contactEdges.m_head)
 	{
-		if (c->m_f1->m_p == this)
-		{
-			b3SphereAndShapeContact* quack = c;
-			c = c->m_next;
-			m_body->m_contactManager.Destroy(quack);
-			continue;
-		}
-
-		c = c->m_next;
+		m_body->m_contactManager.Destroy(m_contactEdges.m_head->owner);
 	}
 }
 
 void b3Particle::SynchronizeFixtures()
 {
 	// Synchronize triangles
-	for (b3TriangleFixture* t = m_body->m_triangleList.m_head; t; t = t->m_next)
+	for (b3ParticleEdge<b3TriangleFixture>* e = m_triangleEdges.m_head; e; e = e->m_next)
 	{
-		if (t->m_p1 == this || t->m_p2 == this || t->m_p3 == this)
-		{
-			t->Synchronize(b3Vec3_zero);
-		}
+		e->owner->Synchronize(b3Vec3_zero);
 	}
 }
 
@@ -179,18 +177,20 @@ void b3Particle::ComputeForces(const b3SparseForceSolverData* data)
 {
 	const b3DenseVec3& v = *data->v;
 	b3DenseVec3& f = *data->f;
-	b3SparseMat33& dfdv = *data->dfdv;
+	b3Mat33* dfdv = data->dfdv->values;
 
 	u32 i = m_solverId;
 
 	if (m_massDamping > scalar(0))
 	{
-		b3Vec3 fd = -m_massDamping * m_mass * v[i];
+		scalar mass = m_storage->masses[i];
+
+		b3Vec3 fd = -m_massDamping * mass * v[i];
 
 		// Mass damping force
 		f[i] += fd;
 
 		// Jacobian
-		dfdv(i, i) += b3Mat33Diagonal(-m_massDamping * m_mass);
+		dfdv[m_solverSlot] += b3Mat33Diagonal(-m_massDamping * mass);
 	}
 }
\ No newline at end of file
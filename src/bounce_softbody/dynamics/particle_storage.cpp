@@ -0,0 +1,119 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce_softbody/dynamics/particle_storage.h>
+#include <bounce_softbody/dynamics/particle.h>
+
+#include <string.h>
+
+// Move the first elements of an array to a new block of a given capacity.
+template<class T>
+static T* b3Grow(T* elements, u32 count, u32 capacity)
+{
+	T* newElements = (T*)b3Alloc(capacity * sizeof(T));
+	if (elements)
+	{
+		memcpy(newElements, elements, count * sizeof(T));
+		b3Free(elements);
+	}
+	return newElements;
+}
+
+b3ParticleStorage::b3ParticleStorage()
+{
+	count = 0;
+	capacity = 0;
+	particles = nullptr;
+	masses = nullptr;
+	invMasses = nullptr;
+}
+
+b3ParticleStorage::~b3ParticleStorage()
+{
+	// The vectors free their own memory.
+	if (particles)
+	{
+		b3Free(particles);
+		b3Free(masses);
+		b3Free(invMasses);
+	}
+}
+
+void b3ParticleStorage::Reserve(u32 newCapacity)
+{
+	if (newCapacity <= capacity)
+	{
+		return;
+	}
+
+	capacity = newCapacity;
+
+	particles = b3Grow(particles, count, capacity);
+	positions.Reserve(capacity);
+	velocities.Reserve(capacity);
+	forces.Reserve(capacity);
+	translations.Reserve(capacity);
+	masses = b3Grow(masses, count, capacity);
+	invMasses = b3Grow(invMasses, count, capacity);
+}
+
+u32 b3ParticleStorage::Add(b3Particle* particle)
+{
+	if (count == capacity)
+	{
+		Reserve(capacity > 0 ? 2 * capacity : 16);
+	}
+
+	u32 index = count++;
+
+	particles[index] = particle;
+	
+	// This keeps the values because the vectors have room for the count.
+	positions.Resize(count);
+	velocities.Resize(count);
+	forces.Resize(count);
+	translations.Resize(count);
+
+	return index;
+}
+
+void b3ParticleStorage::Remove(u32 index)
+{
+	B3_ASSERT(index < count);
+
+	u32 last = --count;
+	if (index != last)
+	{
+		// Move the last particle into the hole.
+		b3Particle* particle = particles[last];
+		particle->m_solverId = index;
+
+		particles[index] = particle;
+		positions[index] = positions[last];
+		velocities[index] = velocities[last];
+		forces[index] = forces[last];
+		translations[index] = translations[last];
+		masses[index] = masses[last];
+		invMasses[index] = invMasses[last];
+	}
+
+	positions.Resize(count);
+	velocities.Resize(count);
+	forces.Resize(count);
+	translations.Resize(count);
+}
\ No newline at end of file
@@ -19,8 +19,11 @@
 #include <bounce_softbody/sparse/sparse_force_solver.h>
 #include <bounce_softbody/sparse/dense_vec3.h>
 #include <bounce_softbody/sparse/diag_mat33.h>
-#include <bounce_softbody/sparse/sparse_mat33.h>
+#include <bounce_softbody/sparse/block_sparse_mat33.h>
 #include <bounce_softbody/sparse/sparse_solver.h>
+#include <bounce_softbody/common/thread/thread_pool.h>
+#include <bounce_softbody/common/timer.h>
+#include <bounce_softbody/common/profile.h>
 
 // Time integration using Backward/Implicit Euler:
 //
@@ -101,6 +104,158 @@
 //
 // b = M * (v0 - v_i) + h * f_i + h * dfdx_i * (x0 - x_i + h * v_i + y)
 //
+// Compute the rows [begin, end) of out = (M - h * dfdv - h * h * dfdx) * x.
+// The Jacobians must share the same sparsity pattern.
+static void b3MulSystem(b3DenseVec3& out, scalar h, const b3DiagMat33& M,
+	const b3BlockSparseMat33& dfdx, const b3BlockSparseMat33& dfdv, const b3DenseVec3& x, 
+	u32 begin, u32 end)
+{
+	B3_ASSERT(dfdx.blockCount == dfdv.blockCount);
+	B3_ASSERT(out.n == dfdx.rowCount && x.n == dfdx.rowCount);
+
+	for (u32 i = begin; i < end; ++i)
+	{
+		b3Vec3 sx, sv;
+		sx.SetZero();
+		sv.SetZero();
+
+		for (u32 k = dfdx.rowPtrs[i]; k < dfdx.rowPtrs[i + 1]; ++k)
+		{
+			const b3Vec3& xj = x[dfdx.columns[k]];
+
+			sx += dfdx.values[k] * xj;
+			sv += dfdv.values[k] * xj;
+		}
+
+		out[i] = M[i] * x[i] - h * sv - (h * h) * sx;
+	}
+}
+
+// The filtered system matrix A' = S * A * S^T + I - S, 
+// where A = M - h * dfdv - h * h * dfdx.
+// Products are computed from the Jacobians without assembling A.
+class b3FilteredSystemOperator : public b3SparseOperator
+{
+public:
+	// Compute sp = S^T * p.
+	struct FilterTask : public b3ThreadTask
+	{
+		void Execute(u32 chunk, u32 begin, u32 end)
+		{
+			B3_NOT_USED(chunk);
+
+			const b3DiagMat33& S = *op->S;
+			b3DenseVec3& sp = *op->sp;
+
+			for (u32 i = begin; i < end; ++i)
+			{
+				sp[i] = b3Transpose(S[i]) * (*p)[i];
+			}
+		}
+
+		const b3FilteredSystemOperator* op;
+		const b3DenseVec3* p;
+	};
+
+	// Compute out = S * A * sp + (I - S) * p.
+	struct MulTask : public b3ThreadTask
+	{
+		void Execute(u32 chunk, u32 begin, u32 end)
+		{
+			B3_NOT_USED(chunk);
+
+			const b3DiagMat33& S = *op->S;
+			const b3DenseVec3& p = *this->p;
+			b3DenseVec3& out = *this->out;
+
+			b3MulSystem(out, op->h, *op->M, *op->dfdx, *op->dfdv, *op->sp, begin, end);
+
+			b3Mat33 I;
+			I.SetIdentity();
+
+			for (u32 i = begin; i < end; ++i)
+			{
+				out[i] = S[i] * out[i] + (I - S[i]) * p[i];
+			}
+		}
+
+		const b3FilteredSystemOperator* op;
+		const b3DenseVec3* p;
+		b3DenseVec3* out;
+	};
+
+	u32 GetRowCount() const
+	{
+		return dfdx->rowCount;
+	}
+
+	void Multiply(b3DenseVec3& out, const b3DenseVec3& p) const
+	{
+		FilterTask filterTask;
+		filterTask.op = this;
+		filterTask.p = &p;
+
+		b3Execute(threadPool, &filterTask, p.n, B3_SOLVER_CHUNK_SIZE);
+
+		MulTask mulTask;
+		mulTask.op = this;
+		mulTask.p = &p;
+		mulTask.out = &out;
+
+		b3Execute(threadPool, &mulTask, p.n, B3_SOLVER_CHUNK_SIZE);
+	}
+
+	void GetDiagonal(b3DiagMat33& out) const
+	{
+		const b3DiagMat33& M = *this->M;
+		const b3DiagMat33& S = *this->S;
+
+		b3Mat33 I;
+		I.SetIdentity();
+
+		for (u32 i = 0; i < out.n; ++i)
+		{
+			u32 k = dfdx->GetIndex(i, i);
+			B3_ASSERT(k != B3_MAX_U32);
+
+			b3Mat33 a = M[i] - h * dfdv->values[k] - (h * h) * dfdx->values[k];
+
+			out[i] = S[i] * a * b3Transpose(S[i]) + I - S[i];
+		}
+	}
+
+	scalar h;
+	const b3DiagMat33* M;
+	const b3DiagMat33* S;
+	const b3BlockSparseMat33* dfdx;
+	const b3BlockSparseMat33* dfdv;
+	b3DenseVec3* sp;
+	b3ThreadPool* threadPool;
+};
+
+// Forcing term parameters as in "Choosing the Forcing Terms in an Inexact Newton Method",
+// by Eisenstat, S. C. and H. F. Walker (choice 2 with alpha = 2).
+static const scalar b3_initialForcing = scalar(0.1);
+static const scalar b3_maxForcing = scalar(0.5);
+static const scalar b3_forcingGamma = scalar(0.9);
+
+// Compute the next forcing term given the last forcing term and
+// the ratio of the current to the previous squared outer error.
+static scalar b3ComputeForcing(scalar forcing, scalar errorRatio)
+{
+	// eta_k = gamma * (|dv_k| / |dv_k-1|)^2
+	scalar eta = b3_forcingGamma * errorRatio;
+
+	// Safeguard against a sudden decrease of the forcing term.
+	scalar safeguard = b3_forcingGamma * forcing * forcing;
+	if (safeguard > scalar(0.1))
+	{
+		eta = b3Max(eta, safeguard);
+	}
+
+	return b3Min(eta, b3_maxForcing);
+}
+
 void b3SparseSolveBE(b3SolveBEOutput* output, const b3SolveBEInput* input)
 {
 	scalar h = input->h;
@@ -123,88 +278,338 @@ void b3SparseSolveBE(b3SolveBEOutput* output, const b3SolveBEInput* input)
 
 	u32 maxSubIterations = input->maxSubIterations;
 	scalar subEpsilon = input->subTolerance;
+	bool adaptiveSubEpsilon = input->adaptiveSubTolerance;
 
-	// S^T
-	b3DiagMat33 ST(dofCount);
-	b3Transpose(ST, S);
+	bool matrixFree = input->matrixFree;
 
-	b3DiagMat33 I(dofCount);
-	I.SetIdentity();
+	b3LinearSolverType linearSolver = input->linearSolver;
+	if (matrixFree && linearSolver == e_ldltLinearSolver)
+	{
+		// LDLT needs the assembled matrix.
+		linearSolver = e_cgLinearSolver;
+	}
+
+	b3PreconditionerType preconditioner = input->preconditioner;
+	if (matrixFree && (preconditioner == e_multigridPreconditioner || preconditioner == e_incompleteCholeskyPreconditioner))
+	{
+		// These need the assembled matrix.
+		preconditioner = e_blockJacobiPreconditioner;
+	}
+
+	B3_ASSERT(input->cache != nullptr);
+	b3SolveBECache* cache = input->cache;
+
+	b3BlockSparseMat33& dfdx = cache->dfdx;
+	b3BlockSparseMat33& dfdv = cache->dfdv;
+	b3BlockSparseMat33& A = cache->A;
 
-	// Keep track initial guess.
-	b3DenseVec3 py(dofCount);
-	py.SetZero();
+	b3DenseVec3& fi = cache->f;
+	b3DenseVec3& b = cache->b;
+	b3DenseVec3& pb = cache->pb;
+	b3DenseVec3& dx = cache->dx;
+	b3DenseVec3& t = cache->t;
+	b3DenseVec3& py = cache->py;
+	b3DenseVec3& dv = cache->dv;
+	b3DenseVec3& sp = cache->sp;
 
-	b3DenseVec3 x = x0;
-	b3DenseVec3 v = v0;
+	fi.Resize(dofCount);
+	b.Resize(dofCount);
+	pb.Resize(dofCount);
+	dx.Resize(dofCount);
+	t.Resize(dofCount);
+	py.Resize(dofCount);
+	dv.Resize(dofCount);
+
+	b3FilteredSystemOperator op;
+	if (matrixFree)
+	{
+		sp.Resize(dofCount);
+
+		op.h = h;
+		op.M = &M;
+		op.S = &S;
+		op.dfdx = &dfdx;
+		op.dfdv = &dfdv;
+		op.sp = &sp;
+		op.threadPool = input->threadPool;
+	}
+	else if (A.rowCount != dofCount || A.blockCount != dfdx.blockCount)
+	{
+		// Allocate the system matrix with the pattern of the Jacobians.
+		A.Copy(dfdx);
+	}
+
+	b3SparseMultigrid* multigrid = nullptr;
+	if (linearSolver == e_cgLinearSolver && preconditioner == e_multigridPreconditioner)
+	{
+		multigrid = &cache->multigrid;
+		if (multigrid->GetRowCount() != dofCount)
+		{
+			// Build the hierarchy from the pattern of the system matrix.
+			multigrid->Create(A);
+		}
+	}
+
+	b3SparseLDLT* ldlt = nullptr;
+	if (linearSolver == e_ldltLinearSolver)
+	{
+		ldlt = &cache->ldlt;
+		if (ldlt->GetRowCount() != dofCount)
+		{
+			// Compute the ordering and the symbolic factorization from the pattern of the system matrix.
+			ldlt->Create(A);
+		}
+	}
+
+	b3SparseIncompleteCholesky* incompleteCholesky = nullptr;
+	if (ldlt == nullptr && preconditioner == e_incompleteCholeskyPreconditioner)
+	{
+		incompleteCholesky = &cache->incompleteCholesky;
+		if (incompleteCholesky->GetRowCount() != dofCount)
+		{
+			// Compute the symbolic factorization from the pattern of the system matrix.
+			incompleteCholesky->Create(A);
+		}
+	}
+
+	// Initial guess. 
+	// This is kept across Newton iterations.
+	bool warmStarted = input->warmStart && cache->lastDv.n == dofCount;
+	if (warmStarted)
+	{
+		// y = S * (dv - z)
+		const b3DenseVec3& lastDv = cache->lastDv;
+		for (u32 i = 0; i < dofCount; ++i)
+		{
+			py[i] = S[i] * (lastDv[i] - z[i]);
+		}
+	}
+	else
+	{
+		py.SetZero();
+	}
+
+	output->savedSubIterations = 0;
+	output->forceTime = 0.0;
+	output->assemblyTime = 0.0;
+	output->solveTime = 0.0;
+
+	// The output vectors hold the current iterate.
+	b3DenseVec3& x = *output->x;
+	b3DenseVec3& v = *output->v;
+	
+	x = x0;
+	v = v0;
+
+	b3Mat33 I;
+	I.SetIdentity();
 
 	scalar error0 = scalar(0);
 	scalar error = scalar(0);
 
+	// Forcing term of the adaptive inner tolerance.
+	scalar forcing = b3_initialForcing;
+
 	u32 iteration = 0;
 
+	b3Timer timer;
+
 	while (iteration < maxIterations)
 	{
-		b3DenseVec3 fi(dofCount);
-		fi.SetZero();
+		timer.Reset();
 
-		b3SparseMat33 dfdx(dofCount);
-		b3SparseMat33 dfdv(dofCount);
+		{
+			B3_PROFILE(input->profile, forces, "Forces");
 
-		b3SparseForceSolverData solverData;
-		solverData.x = &x;
-		solverData.v = &v;
-		solverData.f = &fi;
-		solverData.dfdx = &dfdx;
-		solverData.dfdv = &dfdv;
-		solverData.h = h;
-		solverData.inv_h = inv_h;
+			fi.SetZero();
 
-		forceModel->ComputeForces(&solverData);
+			dfdx.SetZero();
+			dfdv.SetZero();
 
-		b3SparseMat33 A = M - h * dfdv - (h * h) * dfdx;
-		
-		b3DenseVec3 b = M * (v0 - v) + h * (fe + fi) + h * dfdx * (x0 - x + h * v + y);
+			b3SparseForceSolverData solverData;
+			solverData.x = &x;
+			solverData.v = &v;
+			solverData.f = &fi;
+			solverData.dfdx = &dfdx;
+			solverData.dfdv = &dfdv;
+			solverData.h = h;
+			solverData.inv_h = inv_h;
 
-		// Pre-filter as in "Smoothed aggregation multigrid for cloth simulation", 
-		// by Tamstorf, R., T. Jones, and S. McCormick.
-		// A' = S * A * ST + I - S
-		// b' = S * (b - A * z)
-		b3SparseMat33 pA = S * A * ST + I - S;
-		b3DenseVec3 pb = S * (b - A * z);
+			forceModel->ComputeForces(&solverData);
+		}
 
-		// Solve pA * y = pb, 
-		// where y = x - z
-		b3SolveCGInput subInput;
-		subInput.A = &pA;
-		subInput.b = &pb;
-		subInput.maxIterations = maxSubIterations;
-		subInput.tolerance = subEpsilon;
+		output->forceTime += timer.GetMilliseconds();
+
+		timer.Reset();
+
+		B3_ASSERT(dfdx.rowCount == dofCount);
+		B3_ASSERT(dfdx.blockCount == dfdv.blockCount);
+
+		{
+			B3_PROFILE(input->profile, matrix, "Matrix");
+
+			if (matrixFree == false)
+			{
+				// A = M - h * dfdv - h * h * dfdx
+				// The Jacobians and A share the same sparsity pattern.
+				B3_ASSERT(A.blockCount == dfdx.blockCount);
+				for (u32 k = 0; k < A.blockCount; ++k)
+				{
+					A.values[k] = -h * dfdv.values[k] - (h * h) * dfdx.values[k];
+				}
+
+				for (u32 i = 0; i < dofCount; ++i)
+				{
+					A(i, i) += M[i];
+				}
+			}
+
+			// b = M * (v0 - v) + h * (fe + fi) + h * dfdx * (x0 - x + h * v + y)
+			for (u32 i = 0; i < dofCount; ++i)
+			{
+				dx[i] = x0[i] - x[i] + h * v[i] + y[i];
+			}
+
+			b3Mul(t, dfdx, dx);
+
+			for (u32 i = 0; i < dofCount; ++i)
+			{
+				b[i] = M[i] * (v0[i] - v[i]) + h * (fe[i] + fi[i]) + h * t[i];
+			}
+
+			// Pre-filter as in "Smoothed aggregation multigrid for cloth simulation", 
+			// by Tamstorf, R., T. Jones, and S. McCormick.
+			// A' = S * A * ST + I - S
+			// b' = S * (b - A * z)
+			if (matrixFree)
+			{
+				b3MulSystem(t, h, M, dfdx, dfdv, z, 0, dofCount);
+			}
+			else
+			{
+				b3Mul(t, A, z);
+			}
+
+			for (u32 i = 0; i < dofCount; ++i)
+			{
+				pb[i] = S[i] * (b[i] - t[i]);
+			}
+
+			if (matrixFree == false)
+			{
+				// A and A' have the same sparsity pattern. Filter A in place.
+				for (u32 i = 0; i < dofCount; ++i)
+				{
+					for (u32 k = A.rowPtrs[i]; k < A.rowPtrs[i + 1]; ++k)
+					{
+						u32 j = A.columns[k];
 
-		b3SolveCGOutput subOutput;
-		subOutput.x = &py;
+						A.values[k] = S[i] * A.values[k] * b3Transpose(S[j]);
+					}
+
+					A(i, i) += I - S[i];
+				}
+			}
+		}
 
-		bool subSolved = b3SparseSolveCG(&subOutput, &subInput);
-		if (subSolved == false)
+		output->assemblyTime += timer.GetMilliseconds();
+
+		timer.Reset();
+
+		// Solve A' * y = b', 
+		// where y = x - z
+		u32 subIterations = 0;
+		if (ldlt)
 		{
-			break;
+			B3_PROFILE(input->profile, linearSolve, "LDLT");
+
+			ldlt->Factorize(A);
+			ldlt->Solve(py, pb);
+		}
+		else
+		{
+			B3_PROFILE(input->profile, linearSolve, "CG");
+
+			b3SolveCGInput subInput;
+			subInput.A = matrixFree ? nullptr : &A;
+			subInput.op = matrixFree ? &op : nullptr;
+			subInput.b = &pb;
+			subInput.maxIterations = maxSubIterations;
+			subInput.tolerance = subEpsilon;
+			subInput.residualTolerance = scalar(0);
+			if (adaptiveSubEpsilon && iteration + 1 < maxIterations)
+			{
+				// Don't solve accurately for an iterate that is likely to be corrected.
+				subInput.residualTolerance = forcing;
+			}
+			subInput.cache = &cache->subCache;
+			subInput.threadPool = input->threadPool;
+			subInput.preconditioner = preconditioner;
+			subInput.multigrid = multigrid;
+			subInput.incompleteCholesky = incompleteCholesky;
+
+			b3SolveCGOutput subOutput;
+			subOutput.x = &py;
+
+			bool subSolved = b3SparseSolveCG(&subOutput, &subInput);
+			if (subSolved == false)
+			{
+				break;
+			}
+
+			subIterations = subOutput.iterations;
+
+			if (input->compareColdStart && warmStarted && iteration == 0)
+			{
+				// Solve the same system from a zero initial guess.
+				b3DenseVec3& coldPy = cache->coldPy;
+				coldPy.Resize(dofCount);
+				coldPy.SetZero();
+
+				b3SolveCGOutput coldOutput;
+				coldOutput.x = &coldPy;
+
+				b3SparseSolveCG(&coldOutput, &subInput);
+
+				output->savedSubIterations = i32(coldOutput.iterations) - i32(subIterations);
+			}
 		}
 
+		output->solveTime += timer.GetMilliseconds();
+
 		// Recover x = y + z
-		b3DenseVec3 dv = py + z;
+		b3Add(dv, py, z);
 
 		// Track min/max sub-iterations.
-		output->minSubIterations = b3Min(output->minSubIterations, subOutput.iterations);
-		output->maxSubIterations = b3Max(output->maxSubIterations, subOutput.iterations);
+		output->minSubIterations = b3Min(output->minSubIterations, subIterations);
+		output->maxSubIterations = b3Max(output->maxSubIterations, subIterations);
+		output->subIterations += subIterations;
 
 		// Solution update 
-		v = v + dv;
+		v += dv;
 
 		// Position update
-		x = x0 + h * v + y;
+		// x = x0 + h * v + y
+		for (u32 i = 0; i < dofCount; ++i)
+		{
+			x[i] = x0[i] + h * v[i] + y[i];
+		}
 		
+		scalar previousError = error;
+
 		error = b3LengthSquared(dv);
 
+		if (iteration < output->historyCapacity)
+		{
+			output->subIterationHistory[iteration] = subIterations;
+			output->errorHistory[iteration] = error;
+		}
+
+		if (adaptiveSubEpsilon && iteration > 0 && previousError > scalar(0))
+		{
+			forcing = b3ComputeForcing(forcing, error / previousError);
+		}
+
 		if (iteration == 0)
 		{
 			++iteration;
@@ -227,8 +632,14 @@ void b3SparseSolveBE(b3SolveBEOutput* output, const b3SolveBEInput* input)
 		}
 	}
 
-	*output->x = x;
-	*output->v = v;
+	// Keep the velocity change for warm starting the next step.
+	b3DenseVec3& lastDv = cache->lastDv;
+	lastDv.Resize(dofCount);
+	for (u32 i = 0; i < dofCount; ++i)
+	{
+		lastDv[i] = v[i] - v0[i];
+	}
+
 	output->iterations = iteration;
 	output->error = error;
-}
+}
\ No newline at end of file
@@ -0,0 +1,278 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce_softbody/sparse/sparse_incomplete_cholesky.h>
+
+// Initial diagonal shift relative to the diagonal if the factorization breaks down.
+static const scalar b3_initialShift = scalar(0.001);
+
+// Maximum number of shifted factorizations.
+static const u32 b3_maxShifts = 16;
+
+// Return true if a symmetric matrix is positive definite.
+static bool b3IsPositiveDefinite(const b3Mat33& A)
+{
+	// Sylvester's criterion
+	if (A.x.x <= scalar(0))
+	{
+		return false;
+	}
+
+	if (A.x.x * A.y.y - A.y.x * A.x.y <= scalar(0))
+	{
+		return false;
+	}
+
+	return b3Det(A.x, A.y, A.z) > scalar(0);
+}
+
+b3SparseIncompleteCholesky::b3SparseIncompleteCholesky()
+{
+	m_diagonals = nullptr;
+	m_pairPtrs = nullptr;
+	m_targets = nullptr;
+	m_shift = scalar(0);
+}
+
+b3SparseIncompleteCholesky::~b3SparseIncompleteCholesky()
+{
+	Destroy();
+}
+
+void b3SparseIncompleteCholesky::Destroy()
+{
+	m_U.Destroy();
+
+	if (m_diagonals)
+	{
+		b3Free(m_diagonals);
+		m_diagonals = nullptr;
+	}
+
+	if (m_pairPtrs)
+	{
+		b3Free(m_pairPtrs);
+		m_pairPtrs = nullptr;
+	}
+
+	if (m_targets)
+	{
+		b3Free(m_targets);
+		m_targets = nullptr;
+	}
+
+	m_shift = scalar(0);
+}
+
+void b3SparseIncompleteCholesky::Create(const b3BlockSparseMat33& A)
+{
+	Destroy();
+
+	u32 n = A.rowCount;
+
+	// The upper part of a row of A starts at the diagonal because the columns are sorted.
+	m_diagonals = (u32*)b3Alloc(n * sizeof(u32));
+	
+	u32 blockCount = 0;
+	for (u32 i = 0; i < n; ++i)
+	{
+		u32 diagonal = A.GetIndex(i, i);
+		B3_ASSERT(diagonal != B3_MAX_U32);
+
+		m_diagonals[i] = diagonal;
+		blockCount += A.rowPtrs[i + 1] - diagonal;
+	}
+
+	m_U.rowCount = n;
+	m_U.blockCount = blockCount;
+	m_U.rowPtrs = (u32*)b3Alloc((n + 1) * sizeof(u32));
+	m_U.columns = (u32*)b3Alloc(blockCount * sizeof(u32));
+	m_U.values = (b3Mat33*)b3Alloc(b3GetBlockArraySize(blockCount));
+
+	blockCount = 0;
+	for (u32 i = 0; i < n; ++i)
+	{
+		m_U.rowPtrs[i] = blockCount;
+		for (u32 k = m_diagonals[i]; k < A.rowPtrs[i + 1]; ++k)
+		{
+			m_U.columns[blockCount++] = A.columns[k];
+		}
+	}
+	m_U.rowPtrs[n] = blockCount;
+
+	// Symbolic factorization.
+	// Row k updates U(i, j) for every pair of off-diagonal blocks U(k, i) and U(k, j) 
+	// with i <= j. Updates outside the pattern are dropped.
+	m_pairPtrs = (u32*)b3Alloc((n + 1) * sizeof(u32));
+	
+	u32 pairCount = 0;
+	for (u32 k = 0; k < n; ++k)
+	{
+		m_pairPtrs[k] = pairCount;
+		
+		u32 m = m_U.rowPtrs[k + 1] - m_U.rowPtrs[k] - 1;
+		pairCount += m * (m + 1) / 2;
+	}
+	m_pairPtrs[n] = pairCount;
+
+	m_targets = (u32*)b3Alloc(pairCount * sizeof(u32));
+
+	u32* target = m_targets;
+	for (u32 k = 0; k < n; ++k)
+	{
+		u32 begin = m_U.rowPtrs[k] + 1;
+		u32 end = m_U.rowPtrs[k + 1];
+		for (u32 a = begin; a < end; ++a)
+		{
+			for (u32 b = a; b < end; ++b)
+			{
+				*target++ = m_U.GetIndex(m_U.columns[a], m_U.columns[b]);
+			}
+		}
+	}
+
+	m_invD.Resize(n);
+}
+
+bool b3SparseIncompleteCholesky::Factorize(const b3BlockSparseMat33& A, scalar shift)
+{
+	u32 n = m_U.rowCount;
+	b3Mat33* U = m_U.values;
+
+	for (u32 i = 0; i < n; ++i)
+	{
+		u32 count = m_U.rowPtrs[i + 1] - m_U.rowPtrs[i];
+		memcpy(U + m_U.rowPtrs[i], A.values + m_diagonals[i], count * sizeof(b3Mat33));
+
+		if (shift > scalar(0))
+		{
+			b3Mat33& D = U[m_U.rowPtrs[i]];
+			D += b3Mat33Diagonal(shift * D.x.x, shift * D.y.y, shift * D.z.z);
+		}
+	}
+
+	const u32* target = m_targets;
+	for (u32 k = 0; k < n; ++k)
+	{
+		u32 diagonal = m_U.rowPtrs[k];
+		u32 begin = diagonal + 1;
+		u32 end = m_U.rowPtrs[k + 1];
+
+		const b3Mat33& D = U[diagonal];
+		if (b3IsPositiveDefinite(D) == false)
+		{
+			return false;
+		}
+
+		b3Mat33 invD = b3SymInverse(D);
+		m_invD[k] = invD;
+
+		// U(i, j) -= U(k, i)^T * D^-1 * U(k, j)
+		for (u32 a = begin; a < end; ++a)
+		{
+			b3Mat33 T = b3MulT(U[a], invD);
+			for (u32 b = a; b < end; ++b)
+			{
+				u32 index = *target++;
+				if (index != B3_MAX_U32)
+				{
+					U[index] -= T * U[b];
+				}
+			}
+		}
+
+		// U(k, j) = D^-1 * U(k, j)
+		for (u32 a = begin; a < end; ++a)
+		{
+			U[a] = invD * U[a];
+		}
+	}
+
+	return true;
+}
+
+bool b3SparseIncompleteCholesky::Update(const b3BlockSparseMat33& A)
+{
+	B3_ASSERT(A.rowCount == m_U.rowCount);
+
+	m_shift = scalar(0);
+	if (Factorize(A, m_shift))
+	{
+		return true;
+	}
+
+	// Shift the diagonal until the factorization succeeds.
+	m_shift = b3_initialShift;
+	for (u32 i = 0; i < b3_maxShifts; ++i)
+	{
+		if (Factorize(A, m_shift))
+		{
+			return true;
+		}
+
+		m_shift *= scalar(2);
+	}
+
+	// A is far from positive definite.
+	return false;
+}
+
+void b3SparseIncompleteCholesky::Apply(b3DenseVec3& out, const b3DenseVec3& r) const
+{
+	u32 n = m_U.rowCount;
+	B3_ASSERT(out.n == n);
+	B3_ASSERT(r.n == n);
+
+	const b3Mat33* U = m_U.values;
+	const u32* columns = m_U.columns;
+	const u32* rowPtrs = m_U.rowPtrs;
+
+	// U^T * y = r
+	for (u32 i = 0; i < n; ++i)
+	{
+		out[i] = r[i];
+	}
+
+	for (u32 k = 0; k < n; ++k)
+	{
+		b3Vec3 y = out[k];
+		for (u32 p = rowPtrs[k] + 1; p < rowPtrs[k + 1]; ++p)
+		{
+			out[columns[p]] -= b3MulT(U[p], y);
+		}
+	}
+
+	// D * w = y
+	for (u32 i = 0; i < n; ++i)
+	{
+		out[i] = m_invD[i] * out[i];
+	}
+
+	// U * out = w
+	for (u32 i = n; i > 0; --i)
+	{
+		u32 row = i - 1;
+
+		b3Vec3 sum = out[row];
+		for (u32 p = rowPtrs[row] + 1; p < rowPtrs[row + 1]; ++p)
+		{
+			sum -= U[p] * out[columns[p]];
+		}
+		out[row] = sum;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,479 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce_softbody/sparse/sparse_ldlt.h>
+
+// A growable array of indices.
+struct b3IndexArray
+{
+	void PushBack(u32 index)
+	{
+		if (count == capacity)
+		{
+			u32* old = indices;
+			capacity = capacity > 0 ? 2 * capacity : 8;
+			indices = (u32*)b3Alloc(capacity * sizeof(u32));
+			if (old)
+			{
+				memcpy(indices, old, count * sizeof(u32));
+				b3Free(old);
+			}
+		}
+		indices[count++] = index;
+	}
+
+	void Remove(u32 index)
+	{
+		for (u32 i = 0; i < count; ++i)
+		{
+			if (indices[i] == index)
+			{
+				indices[i] = indices[count - 1];
+				--count;
+				return;
+			}
+		}
+	}
+
+	void Destroy()
+	{
+		if (indices)
+		{
+			b3Free(indices);
+			indices = nullptr;
+		}
+		count = 0;
+		capacity = 0;
+	}
+
+	u32* indices;
+	u32 count;
+	u32 capacity;
+};
+
+// Nodes of equal degree in a doubly linked list.
+struct b3DegreeLists
+{
+	void Insert(u32 node, u32 degree)
+	{
+		prev[node] = B3_MAX_U32;
+		next[node] = heads[degree];
+		if (heads[degree] != B3_MAX_U32)
+		{
+			prev[heads[degree]] = node;
+		}
+		heads[degree] = node;
+		degrees[node] = degree;
+	}
+
+	void Remove(u32 node)
+	{
+		u32 degree = degrees[node];
+		if (prev[node] != B3_MAX_U32)
+		{
+			next[prev[node]] = next[node];
+		}
+		else
+		{
+			heads[degree] = next[node];
+		}
+
+		if (next[node] != B3_MAX_U32)
+		{
+			prev[next[node]] = prev[node];
+		}
+	}
+
+	u32* heads;
+	u32* next;
+	u32* prev;
+	u32* degrees;
+};
+
+b3SparseLDLT::b3SparseLDLT()
+{
+	m_rowCount = 0;
+	m_permutation = nullptr;
+	m_inversePermutation = nullptr;
+	m_blockCount = 0;
+	m_columnPtrs = nullptr;
+	m_rows = nullptr;
+	m_L = nullptr;
+	m_D = nullptr;
+	m_invD = nullptr;
+	m_work = nullptr;
+	m_next = nullptr;
+	m_heads = nullptr;
+	m_links = nullptr;
+}
+
+b3SparseLDLT::~b3SparseLDLT()
+{
+	Destroy();
+}
+
+void b3SparseLDLT::Destroy()
+{
+	if (m_rowCount == 0)
+	{
+		return;
+	}
+
+	b3Free(m_permutation);
+	b3Free(m_inversePermutation);
+	b3Free(m_columnPtrs);
+	b3Free(m_rows);
+	b3Free(m_L);
+	b3Free(m_D);
+	b3Free(m_invD);
+	b3Free(m_work);
+	b3Free(m_next);
+	b3Free(m_heads);
+	b3Free(m_links);
+
+	m_rowCount = 0;
+	m_permutation = nullptr;
+	m_inversePermutation = nullptr;
+	m_blockCount = 0;
+	m_columnPtrs = nullptr;
+	m_rows = nullptr;
+	m_L = nullptr;
+	m_D = nullptr;
+	m_invD = nullptr;
+	m_work = nullptr;
+	m_next = nullptr;
+	m_heads = nullptr;
+	m_links = nullptr;
+}
+
+void b3SparseLDLT::Create(const b3BlockSparseMat33& A)
+{
+	Destroy();
+
+	u32 n = A.rowCount;
+	if (n == 0)
+	{
+		return;
+	}
+
+	m_rowCount = n;
+	
+	Order(A);
+
+	m_L = (b3Mat33*)b3Alloc(m_blockCount * sizeof(b3Mat33));
+	m_D = (b3Mat33*)b3Alloc(n * sizeof(b3Mat33));
+	m_invD = (b3Mat33*)b3Alloc(n * sizeof(b3Mat33));
+	m_work = (b3Mat33*)b3Alloc(n * sizeof(b3Mat33));
+	m_next = (u32*)b3Alloc(n * sizeof(u32));
+	m_heads = (u32*)b3Alloc(n * sizeof(u32));
+	m_links = (u32*)b3Alloc(n * sizeof(u32));
+
+	m_y.Resize(n);
+}
+
+void b3SparseLDLT::Order(const b3BlockSparseMat33& A)
+{
+	u32 n = A.rowCount;
+
+	// Elimination graph
+	b3IndexArray* graph = (b3IndexArray*)b3Alloc(n * sizeof(b3IndexArray));
+	for (u32 i = 0; i < n; ++i)
+	{
+		b3IndexArray* neighbors = graph + i;
+		neighbors->indices = nullptr;
+		neighbors->count = 0;
+		neighbors->capacity = 0;
+
+		for (u32 k = A.rowPtrs[i]; k < A.rowPtrs[i + 1]; ++k)
+		{
+			if (A.columns[k] != i)
+			{
+				neighbors->PushBack(A.columns[k]);
+			}
+		}
+	}
+
+	b3DegreeLists lists;
+	lists.heads = (u32*)b3Alloc(n * sizeof(u32));
+	lists.next = (u32*)b3Alloc(n * sizeof(u32));
+	lists.prev = (u32*)b3Alloc(n * sizeof(u32));
+	lists.degrees = (u32*)b3Alloc(n * sizeof(u32));
+	
+	for (u32 i = 0; i < n; ++i)
+	{
+		lists.heads[i] = B3_MAX_U32;
+	}
+
+	for (u32 i = 0; i < n; ++i)
+	{
+		lists.Insert(i, graph[i].count);
+	}
+
+	u32* marks = (u32*)b3Alloc(n * sizeof(u32));
+	for (u32 i = 0; i < n; ++i)
+	{
+		marks[i] = 0;
+	}
+	u32 mark = 0;
+
+	m_permutation = (u32*)b3Alloc(n * sizeof(u32));
+	m_inversePermutation = (u32*)b3Alloc(n * sizeof(u32));
+	m_columnPtrs = (u32*)b3Alloc((n + 1) * sizeof(u32));
+
+	// The pattern of column k of L is the set of neighbors of the k-th 
+	// eliminated node at the time of its elimination.
+	b3IndexArray pattern;
+	pattern.indices = nullptr;
+	pattern.count = 0;
+	pattern.capacity = 0;
+
+	// Minimum degree ordering
+	u32 minDegree = 0;
+	for (u32 k = 0; k < n; ++k)
+	{
+		while (lists.heads[minDegree] == B3_MAX_U32)
+		{
+			++minDegree;
+		}
+
+		u32 v = lists.heads[minDegree];
+		lists.Remove(v);
+
+		m_permutation[k] = v;
+		m_inversePermutation[v] = k;
+
+		b3IndexArray* neighbors = graph + v;
+
+		m_columnPtrs[k] = pattern.count;
+		for (u32 i = 0; i < neighbors->count; ++i)
+		{
+			pattern.PushBack(neighbors->indices[i]);
+		}
+
+		// Eliminate v. Its neighbors form a clique.
+		for (u32 i = 0; i < neighbors->count; ++i)
+		{
+			u32 a = neighbors->indices[i];
+			b3IndexArray* adjacency = graph + a;
+
+			adjacency->Remove(v);
+
+			++mark;
+			marks[a] = mark;
+			for (u32 j = 0; j < adjacency->count; ++j)
+			{
+				marks[adjacency->indices[j]] = mark;
+			}
+
+			for (u32 j = 0; j < neighbors->count; ++j)
+			{
+				u32 b = neighbors->indices[j];
+				if (marks[b] != mark)
+				{
+					adjacency->PushBack(b);
+				}
+			}
+
+			lists.Remove(a);
+			lists.Insert(a, adjacency->count);
+
+			minDegree = b3Min(minDegree, adjacency->count);
+		}
+
+		neighbors->Destroy();
+	}
+	m_columnPtrs[n] = pattern.count;
+
+	m_blockCount = pattern.count;
+	m_rows = (u32*)b3Alloc(m_blockCount * sizeof(u32));
+
+	// Renumber and sort the rows of each column.
+	for (u32 k = 0; k < n; ++k)
+	{
+		u32 begin = m_columnPtrs[k];
+		u32 end = m_columnPtrs[k + 1];
+
+		for (u32 p = begin; p < end; ++p)
+		{
+			u32 row = m_inversePermutation[pattern.indices[p]];
+			B3_ASSERT(row > k);
+
+			// Insertion sort
+			u32 q = p;
+			while (q > begin && m_rows[q - 1] > row)
+			{
+				m_rows[q] = m_rows[q - 1];
+				--q;
+			}
+			m_rows[q] = row;
+		}
+	}
+
+	pattern.Destroy();
+
+	b3Free(marks);
+	b3Free(lists.heads);
+	b3Free(lists.next);
+	b3Free(lists.prev);
+	b3Free(lists.degrees);
+
+	for (u32 i = 0; i < n; ++i)
+	{
+		graph[i].Destroy();
+	}
+	b3Free(graph);
+}
+
+void b3SparseLDLT::Factorize(const b3BlockSparseMat33& A)
+{
+	u32 n = m_rowCount;
+	B3_ASSERT(A.rowCount == n);
+
+	b3Mat33* w = m_work;
+
+	// The columns that update column k are linked from m_heads[k].
+	// m_next[j] is the first block of column j not yet used for an update.
+	for (u32 k = 0; k < n; ++k)
+	{
+		m_heads[k] = B3_MAX_U32;
+	}
+
+	// Left-looking factorization
+	for (u32 k = 0; k < n; ++k)
+	{
+		u32 begin = m_columnPtrs[k];
+		u32 end = m_columnPtrs[k + 1];
+
+		// Scatter the lower part of column k of P * A * P^T.
+		w[k].SetZero();
+		for (u32 p = begin; p < end; ++p)
+		{
+			w[m_rows[p]].SetZero();
+		}
+
+		// A is symmetric, so column k is the transpose of the row.
+		u32 row = m_permutation[k];
+		for (u32 p = A.rowPtrs[row]; p < A.rowPtrs[row + 1]; ++p)
+		{
+			u32 i = m_inversePermutation[A.columns[p]];
+			if (i >= k)
+			{
+				w[i] += b3Transpose(A.values[p]);
+			}
+		}
+
+		// w(i) -= L(i, j) * D(j) * L(k, j)^T
+		u32 j = m_heads[k];
+		while (j != B3_MAX_U32)
+		{
+			u32 nextColumn = m_links[j];
+
+			u32 p = m_next[j];
+			u32 columnEnd = m_columnPtrs[j + 1];
+			B3_ASSERT(m_rows[p] == k);
+
+			b3Mat33 T = m_D[j] * b3Transpose(m_L[p]);
+			for (u32 q = p; q < columnEnd; ++q)
+			{
+				w[m_rows[q]] -= m_L[q] * T;
+			}
+
+			// Link column j to the next row it updates.
+			++p;
+			m_next[j] = p;
+			if (p < columnEnd)
+			{
+				u32 nextRow = m_rows[p];
+				m_links[j] = m_heads[nextRow];
+				m_heads[nextRow] = j;
+			}
+
+			j = nextColumn;
+		}
+
+		// L(i, k) = w(i) * D(k)^-1
+		m_D[k] = w[k];
+		
+		B3_ASSERT(b3Det(w[k].x, w[k].y, w[k].z) > scalar(0));
+		b3Mat33 invD = b3SymInverse(w[k]);
+		m_invD[k] = invD;
+
+		for (u32 p = begin; p < end; ++p)
+		{
+			m_L[p] = w[m_rows[p]] * invD;
+		}
+
+		m_next[k] = begin;
+		if (begin < end)
+		{
+			u32 nextRow = m_rows[begin];
+			m_links[k] = m_heads[nextRow];
+			m_heads[nextRow] = k;
+		}
+	}
+}
+
+void b3SparseLDLT::Solve(b3DenseVec3& x, const b3DenseVec3& b)
+{
+	u32 n = m_rowCount;
+	B3_ASSERT(x.n == n);
+	B3_ASSERT(b.n == n);
+
+	b3DenseVec3& y = m_y;
+
+	// y = P * b
+	for (u32 k = 0; k < n; ++k)
+	{
+		y[k] = b[m_permutation[k]];
+	}
+
+	// L * z = y
+	for (u32 k = 0; k < n; ++k)
+	{
+		b3Vec3 yk = y[k];
+		for (u32 p = m_columnPtrs[k]; p < m_columnPtrs[k + 1]; ++p)
+		{
+			y[m_rows[p]] -= m_L[p] * yk;
+		}
+	}
+
+	// D * w = z
+	for (u32 k = 0; k < n; ++k)
+	{
+		y[k] = m_invD[k] * y[k];
+	}
+
+	// L^T * y = w
+	for (u32 i = n; i > 0; --i)
+	{
+		u32 k = i - 1;
+
+		b3Vec3 sum = y[k];
+		for (u32 p = m_columnPtrs[k]; p < m_columnPtrs[k + 1]; ++p)
+		{
+			sum -= b3MulT(m_L[p], y[m_rows[p]]);
+		}
+		y[k] = sum;
+	}
+
+	// x = P^T * y
+	for (u32 k = 0; k < n; ++k)
+	{
+		x[m_permutation[k]] = y[k];
+	}
+}
\ No newline at end of file
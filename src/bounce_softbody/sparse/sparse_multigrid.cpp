@@ -0,0 +1,643 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <bounce_softbody/sparse/sparse_multigrid.h>
+
+// Damping of the Jacobi step that smooths the tentative prolongator.
+static const scalar b3_prolongatorDamping = scalar(2) / scalar(3);
+
+// Number of symmetric Gauss-Seidel sweeps on the coarsest level if it is not factorized.
+static const u32 b3_coarseSweeps = 4;
+
+// Run a forward block Gauss-Seidel sweep on A * x = b.
+static void b3SmoothForward(b3DenseVec3& x, const b3BlockSparseMat33& A, const b3DiagMat33& invD, const b3DenseVec3& b)
+{
+	for (u32 i = 0; i < A.rowCount; ++i)
+	{
+		b3Vec3 sum = b[i];
+		for (u32 k = A.rowPtrs[i]; k < A.rowPtrs[i + 1]; ++k)
+		{
+			u32 j = A.columns[k];
+			if (j != i)
+			{
+				sum -= A.values[k] * x[j];
+			}
+		}
+		x[i] = invD[i] * sum;
+	}
+}
+
+// Run a backward block Gauss-Seidel sweep on A * x = b.
+static void b3SmoothBackward(b3DenseVec3& x, const b3BlockSparseMat33& A, const b3DiagMat33& invD, const b3DenseVec3& b)
+{
+	for (u32 i = A.rowCount; i > 0; --i)
+	{
+		u32 row = i - 1;
+
+		b3Vec3 sum = b[row];
+		for (u32 k = A.rowPtrs[row]; k < A.rowPtrs[row + 1]; ++k)
+		{
+			u32 j = A.columns[k];
+			if (j != row)
+			{
+				sum -= A.values[k] * x[j];
+			}
+		}
+		x[row] = invD[row] * sum;
+	}
+}
+
+b3SparseMultigrid::b3SparseMultigrid()
+{
+	for (u32 i = 0; i < B3_MAX_MULTIGRID_LEVELS; ++i)
+	{
+		m_levels[i].A = nullptr;
+		m_levels[i].diagonals = nullptr;
+		m_levels[i].aggregates = nullptr;
+		m_levels[i].weights = nullptr;
+		m_levels[i].tentativeSlots = nullptr;
+		m_levels[i].prolongatorSlots = nullptr;
+		m_levels[i].productSlots = nullptr;
+		m_levels[i].galerkinSlots = nullptr;
+	}
+	m_levelCount = 0;
+	m_factor = nullptr;
+	m_factorSize = 0;
+}
+
+b3SparseMultigrid::~b3SparseMultigrid()
+{
+	Destroy();
+}
+
+void b3SparseMultigrid::Destroy()
+{
+	for (u32 i = 0; i < m_levelCount; ++i)
+	{
+		b3MultigridLevel* level = m_levels + i;
+		
+		level->A = nullptr;
+		level->coarseA.Destroy();
+		level->P.Destroy();
+		level->AP.Destroy();
+
+		b3Free(level->diagonals);
+		level->diagonals = nullptr;
+
+		if (level->aggregates)
+		{
+			b3Free(level->aggregates);
+			level->aggregates = nullptr;
+		}
+
+		if (level->weights)
+		{
+			b3Free(level->weights);
+			level->weights = nullptr;
+		}
+
+		if (level->tentativeSlots)
+		{
+			b3Free(level->tentativeSlots);
+			b3Free(level->prolongatorSlots);
+			b3Free(level->productSlots);
+			b3Free(level->galerkinSlots);
+			level->tentativeSlots = nullptr;
+			level->prolongatorSlots = nullptr;
+			level->productSlots = nullptr;
+			level->galerkinSlots = nullptr;
+		}
+	}
+	m_levelCount = 0;
+
+	if (m_factor)
+	{
+		b3Free(m_factor);
+		m_factor = nullptr;
+	}
+	m_factorSize = 0;
+}
+
+void b3SparseMultigrid::Create(const b3BlockSparseMat33& A)
+{
+	Destroy();
+
+	m_levels[0].A = &A;
+
+	for (;;)
+	{
+		b3MultigridLevel* level = m_levels + m_levelCount;
+		++m_levelCount;
+
+		const b3BlockSparseMat33& A = *level->A;
+		u32 n = A.rowCount;
+
+		level->invD.Resize(n);
+		level->r.Resize(n);
+
+		level->diagonals = (u32*)b3Alloc(n * sizeof(u32));
+		for (u32 i = 0; i < n; ++i)
+		{
+			level->diagonals[i] = A.GetIndex(i, i);
+		}
+
+		// The finest level uses the input vectors.
+		if (m_levelCount > 1)
+		{
+			level->x.Resize(n);
+			level->b.Resize(n);
+		}
+
+		if (n <= B3_MULTIGRID_COARSE_SIZE || m_levelCount == B3_MAX_MULTIGRID_LEVELS)
+		{
+			break;
+		}
+
+		u32 coarseCount = Aggregate(level);
+		if (coarseCount == n)
+		{
+			// The graph can't be coarsened.
+			b3Free(level->aggregates);
+			level->aggregates = nullptr;
+			b3Free(level->weights);
+			level->weights = nullptr;
+			break;
+		}
+
+		CreateProlongator(level, coarseCount);
+
+		b3MultigridLevel* next = level + 1;
+		next->A = &next->coarseA;
+	}
+
+	b3MultigridLevel* coarsest = m_levels + m_levelCount - 1;
+	u32 n = coarsest->A->rowCount;
+	if (n <= B3_MULTIGRID_COARSE_SIZE)
+	{
+		m_factorSize = 3 * n;
+		m_factor = (scalar*)b3Alloc(m_factorSize * m_factorSize * sizeof(scalar));
+	}
+}
+
+u32 b3SparseMultigrid::Aggregate(b3MultigridLevel* level)
+{
+	const b3BlockSparseMat33& A = *level->A;
+	u32 n = A.rowCount;
+
+	u32* aggregates = (u32*)b3Alloc(n * sizeof(u32));
+	for (u32 i = 0; i < n; ++i)
+	{
+		aggregates[i] = B3_MAX_U32;
+	}
+
+	u32 count = 0;
+
+	// Pass 1: Form an aggregate from each row whose neighbors are not aggregated.
+	for (u32 i = 0; i < n; ++i)
+	{
+		if (aggregates[i] != B3_MAX_U32)
+		{
+			continue;
+		}
+
+		bool isFree = true;
+		for (u32 k = A.rowPtrs[i]; k < A.rowPtrs[i + 1]; ++k)
+		{
+			if (aggregates[A.columns[k]] != B3_MAX_U32)
+			{
+				isFree = false;
+				break;
+			}
+		}
+
+		if (isFree == false)
+		{
+			continue;
+		}
+
+		for (u32 k = A.rowPtrs[i]; k < A.rowPtrs[i + 1]; ++k)
+		{
+			aggregates[A.columns[k]] = count;
+		}
+		aggregates[i] = count;
+
+		++count;
+	}
+
+	// Pass 2: Join the remaining rows to a neighboring aggregate from pass 1.
+	// Every remaining row has such a neighbor, otherwise it would be an aggregate root.
+	u32* roots = (u32*)b3Alloc(n * sizeof(u32));
+	memcpy(roots, aggregates, n * sizeof(u32));
+
+	for (u32 i = 0; i < n; ++i)
+	{
+		if (roots[i] != B3_MAX_U32)
+		{
+			continue;
+		}
+
+		for (u32 k = A.rowPtrs[i]; k < A.rowPtrs[i + 1]; ++k)
+		{
+			u32 j = A.columns[k];
+			if (roots[j] != B3_MAX_U32)
+			{
+				aggregates[i] = roots[j];
+				break;
+			}
+		}
+
+		B3_ASSERT(aggregates[i] != B3_MAX_U32);
+	}
+
+	b3Free(roots);
+
+	// The tentative prolongator has orthonormal columns.
+	// Its block at (i, aggregates[i]) is I / sqrt(size of aggregate).
+	u32* sizes = (u32*)b3Alloc(count * sizeof(u32));
+	memset(sizes, 0, count * sizeof(u32));
+	for (u32 i = 0; i < n; ++i)
+	{
+		++sizes[aggregates[i]];
+	}
+
+	scalar* weights = (scalar*)b3Alloc(n * sizeof(scalar));
+	for (u32 i = 0; i < n; ++i)
+	{
+		weights[i] = scalar(1) / b3Sqrt(scalar(sizes[aggregates[i]]));
+	}
+
+	b3Free(sizes);
+
+	level->aggregates = aggregates;
+	level->weights = weights;
+
+	return count;
+}
+
+void b3SparseMultigrid::CreateProlongator(b3MultigridLevel* level, u32 coarseCount)
+{
+	const b3BlockSparseMat33& A = *level->A;
+	const u32* aggregates = level->aggregates;
+	u32 n = A.rowCount;
+
+	// P = (I - w * D^-1 * A) * T
+	// The pattern of row i contains the aggregates of the neighbors of i.
+	{
+		b3SparseMat33 P(n);
+		for (u32 i = 0; i < n; ++i)
+		{
+			P(i, aggregates[i]);
+			for (u32 k = A.rowPtrs[i]; k < A.rowPtrs[i + 1]; ++k)
+			{
+				P(i, aggregates[A.columns[k]]);
+			}
+		}
+		level->P.Create(P);
+	}
+
+	const b3BlockSparseMat33& P = level->P;
+
+	// A * P
+	{
+		b3SparseMat33 AP(n);
+		for (u32 i = 0; i < n; ++i)
+		{
+			for (u32 k = A.rowPtrs[i]; k < A.rowPtrs[i + 1]; ++k)
+			{
+				u32 j = A.columns[k];
+				for (u32 m = P.rowPtrs[j]; m < P.rowPtrs[j + 1]; ++m)
+				{
+					AP(i, P.columns[m]);
+				}
+			}
+		}
+		level->AP.Create(AP);
+	}
+
+	const b3BlockSparseMat33& AP = level->AP;
+
+	// P^T * A * P
+	{
+		b3SparseMat33 coarseA(coarseCount);
+		for (u32 i = 0; i < n; ++i)
+		{
+			for (u32 m1 = P.rowPtrs[i]; m1 < P.rowPtrs[i + 1]; ++m1)
+			{
+				for (u32 m2 = AP.rowPtrs[i]; m2 < AP.rowPtrs[i + 1]; ++m2)
+				{
+					coarseA(P.columns[m1], AP.columns[m2]);
+				}
+			}
+		}
+		
+		b3MultigridLevel* next = level + 1;
+		next->coarseA.Create(coarseA);
+	}
+
+	const b3BlockSparseMat33& coarseA = level[1].coarseA;
+
+	// Find the blocks updated by the numeric update.
+	level->tentativeSlots = (u32*)b3Alloc(n * sizeof(u32));
+	level->prolongatorSlots = (u32*)b3Alloc(A.rowPtrs[n] * sizeof(u32));
+	
+	u32 productCount = 0;
+	u32 galerkinCount = 0;
+	for (u32 i = 0; i < n; ++i)
+	{
+		level->tentativeSlots[i] = P.GetIndex(i, aggregates[i]);
+		for (u32 k = A.rowPtrs[i]; k < A.rowPtrs[i + 1]; ++k)
+		{
+			u32 j = A.columns[k];
+			level->prolongatorSlots[k] = P.GetIndex(i, aggregates[j]);
+			productCount += P.rowPtrs[j + 1] - P.rowPtrs[j];
+		}
+		galerkinCount += (P.rowPtrs[i + 1] - P.rowPtrs[i]) * (AP.rowPtrs[i + 1] - AP.rowPtrs[i]);
+	}
+
+	u32* productSlots = (u32*)b3Alloc(productCount * sizeof(u32));
+	u32* galerkinSlots = (u32*)b3Alloc(galerkinCount * sizeof(u32));
+	level->productSlots = productSlots;
+	level->galerkinSlots = galerkinSlots;
+
+	for (u32 i = 0; i < n; ++i)
+	{
+		for (u32 k = A.rowPtrs[i]; k < A.rowPtrs[i + 1]; ++k)
+		{
+			u32 j = A.columns[k];
+			for (u32 m = P.rowPtrs[j]; m < P.rowPtrs[j + 1]; ++m)
+			{
+				*productSlots++ = AP.GetIndex(i, P.columns[m]);
+			}
+		}
+
+		for (u32 m1 = P.rowPtrs[i]; m1 < P.rowPtrs[i + 1]; ++m1)
+		{
+			for (u32 m2 = AP.rowPtrs[i]; m2 < AP.rowPtrs[i + 1]; ++m2)
+			{
+				*galerkinSlots++ = coarseA.GetIndex(P.columns[m1], AP.columns[m2]);
+			}
+		}
+	}
+}
+
+void b3SparseMultigrid::Update(const b3BlockSparseMat33& A)
+{
+	B3_ASSERT(m_levelCount > 0);
+	B3_ASSERT(A.rowCount == GetRowCount());
+
+	m_levels[0].A = &A;
+
+	b3Mat33 I;
+	I.SetIdentity();
+
+	for (u32 l = 0; l < m_levelCount; ++l)
+	{
+		b3MultigridLevel* level = m_levels + l;
+		const b3BlockSparseMat33& Al = *level->A;
+		u32 n = Al.rowCount;
+
+		// Smoother
+		for (u32 i = 0; i < n; ++i)
+		{
+			level->invD[i] = b3SymInverse(Al.values[level->diagonals[i]]);
+		}
+
+		if (l + 1 == m_levelCount)
+		{
+			break;
+		}
+
+		const scalar* weights = level->weights;
+		const u32* tentativeSlots = level->tentativeSlots;
+		const u32* prolongatorSlots = level->prolongatorSlots;
+		const u32* productSlots = level->productSlots;
+		const u32* galerkinSlots = level->galerkinSlots;
+		b3BlockSparseMat33& P = level->P;
+		b3BlockSparseMat33& AP = level->AP;
+		b3BlockSparseMat33& coarseA = level[1].coarseA;
+
+		// P = (I - w * D^-1 * A) * T
+		P.SetZero();
+		for (u32 i = 0; i < n; ++i)
+		{
+			P.values[tentativeSlots[i]] += weights[i] * I;
+
+			b3Mat33 D = -b3_prolongatorDamping * level->invD[i];
+			for (u32 k = Al.rowPtrs[i]; k < Al.rowPtrs[i + 1]; ++k)
+			{
+				u32 j = Al.columns[k];
+				P.values[prolongatorSlots[k]] += weights[j] * (D * Al.values[k]);
+			}
+		}
+
+		// A * P
+		AP.SetZero();
+		for (u32 i = 0; i < n; ++i)
+		{
+			for (u32 k = Al.rowPtrs[i]; k < Al.rowPtrs[i + 1]; ++k)
+			{
+				u32 j = Al.columns[k];
+				for (u32 m = P.rowPtrs[j]; m < P.rowPtrs[j + 1]; ++m)
+				{
+					AP.values[*productSlots++] += Al.values[k] * P.values[m];
+				}
+			}
+		}
+
+		// P^T * A * P
+		coarseA.SetZero();
+		for (u32 i = 0; i < n; ++i)
+		{
+			for (u32 m1 = P.rowPtrs[i]; m1 < P.rowPtrs[i + 1]; ++m1)
+			{
+				for (u32 m2 = AP.rowPtrs[i]; m2 < AP.rowPtrs[i + 1]; ++m2)
+				{
+					coarseA.values[*galerkinSlots++] += b3MulT(P.values[m1], AP.values[m2]);
+				}
+			}
+		}
+	}
+
+	if (m_factor)
+	{
+		Factorize();
+	}
+}
+
+void b3SparseMultigrid::Factorize()
+{
+	const b3BlockSparseMat33& A = *m_levels[m_levelCount - 1].A;
+	u32 size = m_factorSize;
+	scalar* L = m_factor;
+
+	// Expand the blocks into a dense row-major matrix.
+	memset(L, 0, size * size * sizeof(scalar));
+	for (u32 i = 0; i < A.rowCount; ++i)
+	{
+		for (u32 k = A.rowPtrs[i]; k < A.rowPtrs[i + 1]; ++k)
+		{
+			u32 j = A.columns[k];
+			const b3Mat33& a = A.values[k];
+			for (u32 r = 0; r < 3; ++r)
+			{
+				for (u32 c = 0; c < 3; ++c)
+				{
+					L[(3 * i + r) * size + 3 * j + c] = a(r, c);
+				}
+			}
+		}
+	}
+
+	// In-place Cholesky factorization A = L * L^T.
+	for (u32 j = 0; j < size; ++j)
+	{
+		scalar d = L[j * size + j];
+		for (u32 k = 0; k < j; ++k)
+		{
+			d -= L[j * size + k] * L[j * size + k];
+		}
+
+		// The operator must be positive definite. Guard against round-off.
+		if (d <= B3_EPSILON)
+		{
+			d = B3_EPSILON;
+		}
+
+		scalar ljj = b3Sqrt(d);
+		L[j * size + j] = ljj;
+
+		scalar inv_ljj = scalar(1) / ljj;
+		for (u32 i = j + 1; i < size; ++i)
+		{
+			scalar s = L[i * size + j];
+			for (u32 k = 0; k < j; ++k)
+			{
+				s -= L[i * size + k] * L[j * size + k];
+			}
+			L[i * size + j] = inv_ljj * s;
+		}
+	}
+}
+
+void b3SparseMultigrid::SolveCoarse(b3DenseVec3& x, const b3DenseVec3& b)
+{
+	b3MultigridLevel* level = m_levels + m_levelCount - 1;
+
+	if (m_factor == nullptr)
+	{
+		// Symmetric Gauss-Seidel
+		x.SetZero();
+		for (u32 i = 0; i < b3_coarseSweeps; ++i)
+		{
+			b3SmoothForward(x, *level->A, level->invD, b);
+			b3SmoothBackward(x, *level->A, level->invD, b);
+		}
+		return;
+	}
+
+	u32 size = m_factorSize;
+	const scalar* L = m_factor;
+	
+	scalar* y = &x[0].x;
+	const scalar* c = &b[0].x;
+
+	// L * y = b
+	for (u32 i = 0; i < size; ++i)
+	{
+		scalar s = c[i];
+		for (u32 k = 0; k < i; ++k)
+		{
+			s -= L[i * size + k] * y[k];
+		}
+		y[i] = s / L[i * size + i];
+	}
+
+	// L^T * x = y
+	for (u32 i = size; i > 0; --i)
+	{
+		u32 row = i - 1;
+
+		scalar s = y[row];
+		for (u32 k = row + 1; k < size; ++k)
+		{
+			s -= L[k * size + row] * y[k];
+		}
+		y[row] = s / L[row * size + row];
+	}
+}
+
+void b3SparseMultigrid::Cycle(u32 index, b3DenseVec3& x, const b3DenseVec3& b)
+{
+	if (index + 1 == m_levelCount)
+	{
+		SolveCoarse(x, b);
+		return;
+	}
+
+	b3MultigridLevel* level = m_levels + index;
+	b3MultigridLevel* next = level + 1;
+
+	const b3BlockSparseMat33& A = *level->A;
+	const b3BlockSparseMat33& P = level->P;
+	b3DenseVec3& r = level->r;
+	u32 n = A.rowCount;
+
+	// Pre-smoothing
+	x.SetZero();
+	b3SmoothForward(x, A, level->invD, b);
+
+	// r = b - A * x
+	b3Mul(r, A, x);
+	for (u32 i = 0; i < n; ++i)
+	{
+		r[i] = b[i] - r[i];
+	}
+
+	// Restriction
+	next->b.SetZero();
+	for (u32 i = 0; i < n; ++i)
+	{
+		for (u32 m = P.rowPtrs[i]; m < P.rowPtrs[i + 1]; ++m)
+		{
+			next->b[P.columns[m]] += b3MulT(P.values[m], r[i]);
+		}
+	}
+
+	Cycle(index + 1, next->x, next->b);
+
+	// Prolongation
+	for (u32 i = 0; i < n; ++i)
+	{
+		for (u32 m = P.rowPtrs[i]; m < P.rowPtrs[i + 1]; ++m)
+		{
+			x[i] += P.values[m] * next->x[P.columns[m]];
+		}
+	}
+
+	// Post-smoothing in reverse order keeps the preconditioner symmetric.
+	b3SmoothBackward(x, A, level->invD, b);
+}
+
+void b3SparseMultigrid::Apply(b3DenseVec3& out, const b3DenseVec3& r)
+{
+	B3_ASSERT(m_levelCount > 0);
+	B3_ASSERT(out.n == GetRowCount());
+	B3_ASSERT(r.n == GetRowCount());
+	
+	Cycle(0, out, r);
+}
\ No newline at end of file
@@ -17,46 +17,411 @@
 */
 
 #include <bounce_softbody/sparse/sparse_solver.h>
-#include <bounce_softbody/sparse/sparse_mat33.h>
+#include <bounce_softbody/sparse/block_sparse_mat33.h>
 #include <bounce_softbody/sparse/diag_mat33.h>
 #include <bounce_softbody/sparse/dense_vec3.h>
+#include <bounce_softbody/sparse/sparse_multigrid.h>
+#include <bounce_softbody/sparse/sparse_incomplete_cholesky.h>
+#include <bounce_softbody/common/thread/thread_pool.h>
+
+// Compute the (block) Jacobi preconditioner and the partial sums of b^T * P * b.
+struct b3CGPreconditionTask : public b3ThreadTask
+{
+	void Execute(u32 chunk, u32 begin, u32 end)
+	{
+		const b3DenseVec3& b = *this->b;
+		b3DiagMat33& invP = *this->invP;
+
+		scalar sum = scalar(0);
+
+		if (type == e_blockJacobiPreconditioner)
+		{
+			for (u32 i = begin; i < end; ++i)
+			{
+				// invP holds the diagonal blocks of A on input.
+				b3Mat33 a = invP[i];
+
+				B3_ASSERT(b3Det(a.x, a.y, a.z) > scalar(0));
+				invP[i] = b3SymInverse(a);
+
+				sum += b3Dot(b[i], a * b[i]);
+			}
+
+			partials[chunk] = sum;
+			return;
+		}
+
+		for (u32 i = begin; i < end; ++i)
+		{
+			// invP holds the diagonal blocks of A on input.
+			b3Mat33 a = invP[i];
+
+			B3_ASSERT(a.x.x > scalar(0));
+			scalar xx = scalar(1) / a.x.x;
+
+			B3_ASSERT(a.y.y > scalar(0));
+			scalar yy = scalar(1) / a.y.y;
+
+			B3_ASSERT(a.z.z > scalar(0));
+			scalar zz = scalar(1) / a.z.z;
+
+			invP[i] = b3Mat33Diagonal(xx, yy, zz);
+
+			sum += b3Dot(b[i], b3Mat33Diagonal(a.x.x, a.y.y, a.z.z) * b[i]);
+		}
+		partials[chunk] = sum;
+	}
+
+	b3PreconditionerType type;
+	const b3DenseVec3* b;
+	b3DiagMat33* invP;
+	scalar* partials;
+};
+
+// Compute q = A * c and the partial sums of c^T * q.
+// If A is null then only the partial sums are computed.
+struct b3CGMulTask : public b3ThreadTask
+{
+	void Execute(u32 chunk, u32 begin, u32 end)
+	{
+		const b3DenseVec3& c = *this->c;
+		b3DenseVec3& q = *this->q;
+
+		if (A)
+		{
+			b3Mul(q, *A, c, begin, end);
+		}
+
+		scalar sum = scalar(0);
+		for (u32 i = begin; i < end; ++i)
+		{
+			sum += b3Dot(c[i], q[i]);
+		}
+		partials[chunk] = sum;
+	}
+
+	const b3BlockSparseMat33* A;
+	const b3DenseVec3* c;
+	b3DenseVec3* q;
+	scalar* partials;
+};
+
+// Compute r = b - A * x, c = invP * r and the partial sums of r^T * c.
+// If A is null then r must hold A * x on input.
+// If invP is null then only r is computed.
+struct b3CGResidualTask : public b3ThreadTask
+{
+	void Execute(u32 chunk, u32 begin, u32 end)
+	{
+		const b3DenseVec3& b = *this->b;
+		b3DenseVec3& r = *this->r;
+		b3DenseVec3& c = *this->c;
+
+		if (A)
+		{
+			b3Mul(r, *A, *x, begin, end);
+		}
+
+		if (this->invP == nullptr)
+		{
+			for (u32 i = begin; i < end; ++i)
+			{
+				r[i] = b[i] - r[i];
+			}
+			return;
+		}
+
+		const b3DiagMat33& invP = *this->invP;
+
+		scalar sum = scalar(0);
+		for (u32 i = begin; i < end; ++i)
+		{
+			r[i] = b[i] - r[i];
+			c[i] = invP[i] * r[i];
+			sum += b3Dot(r[i], c[i]);
+		}
+		partials[chunk] = sum;
+	}
+
+	const b3BlockSparseMat33* A;
+	const b3DenseVec3* x;
+	const b3DenseVec3* b;
+	const b3DiagMat33* invP;
+	b3DenseVec3* r;
+	b3DenseVec3* c;
+	scalar* partials;
+};
+
+// Compute x = x + alpha * c, r = r - alpha * q, s = invP * r 
+// and the partial sums of r^T * s.
+// If invP is null then only x and r are computed.
+struct b3CGUpdateTask : public b3ThreadTask
+{
+	void Execute(u32 chunk, u32 begin, u32 end)
+	{
+		const b3DenseVec3& c = *this->c;
+		const b3DenseVec3& q = *this->q;
+		b3DenseVec3& x = *this->x;
+		b3DenseVec3& r = *this->r;
+
+		if (this->invP == nullptr)
+		{
+			for (u32 i = begin; i < end; ++i)
+			{
+				x[i] = alpha * c[i] + x[i];
+				r[i] = -alpha * q[i] + r[i];
+			}
+			return;
+		}
+
+		const b3DiagMat33& invP = *this->invP;
+		b3DenseVec3& s = *this->s;
+
+		scalar sum = scalar(0);
+		for (u32 i = begin; i < end; ++i)
+		{
+			x[i] = alpha * c[i] + x[i];
+			r[i] = -alpha * q[i] + r[i];
+			s[i] = invP[i] * r[i];
+			sum += b3Dot(r[i], s[i]);
+		}
+		partials[chunk] = sum;
+	}
+
+	scalar alpha;
+	const b3DenseVec3* c;
+	const b3DenseVec3* q;
+	const b3DiagMat33* invP;
+	b3DenseVec3* x;
+	b3DenseVec3* r;
+	b3DenseVec3* s;
+	scalar* partials;
+};
+
+// Compute the partial sums of u^T * v.
+struct b3CGDotTask : public b3ThreadTask
+{
+	void Execute(u32 chunk, u32 begin, u32 end)
+	{
+		const b3DenseVec3& u = *this->u;
+		const b3DenseVec3& v = *this->v;
+
+		scalar sum = scalar(0);
+		for (u32 i = begin; i < end; ++i)
+		{
+			sum += b3Dot(u[i], v[i]);
+		}
+		partials[chunk] = sum;
+	}
+
+	const b3DenseVec3* u;
+	const b3DenseVec3* v;
+	scalar* partials;
+};
+
+// Compute c = s + beta * c.
+struct b3CGDirectionTask : public b3ThreadTask
+{
+	void Execute(u32 chunk, u32 begin, u32 end)
+	{
+		B3_NOT_USED(chunk);
+
+		const b3DenseVec3& s = *this->s;
+		b3DenseVec3& c = *this->c;
+
+		for (u32 i = begin; i < end; ++i)
+		{
+			c[i] = beta * c[i] + s[i];
+		}
+	}
+
+	scalar beta;
+	const b3DenseVec3* s;
+	b3DenseVec3* c;
+};
+
+// Compute out = P^-1 * r with the multigrid or the incomplete Cholesky preconditioner.
+static void b3Precondition(b3DenseVec3& out, const b3DenseVec3& r, 
+	b3SparseMultigrid* multigrid, const b3SparseIncompleteCholesky* incompleteCholesky)
+{
+	if (multigrid)
+	{
+		multigrid->Apply(out, r);
+	}
+	else
+	{
+		incompleteCholesky->Apply(out, r);
+	}
+}
 
 // Preconditioned Conjugate Gradient algorithm.
+// Each iteration is split into three passes over the rows.
+// The passes are executed in parallel if a thread pool is given.
+// The multigrid and incomplete Cholesky preconditioners run on the calling thread.
+// They are also applied to b once, so that the initial error is measured in the same norm as the residual.
+// The Jacobi preconditioners measure the initial error in the norm of P instead.
 bool b3SparseSolveCG(b3SolveCGOutput* output, const b3SolveCGInput* input)
 {
-	const b3SparseMat33& A = *input->A;
+	const b3BlockSparseMat33* A = input->A;
+	const b3SparseOperator* op = input->op;
 	const b3DenseVec3& b = *input->b;
 	u32 maxIterations = input->maxIterations;
 	scalar epsilon = input->tolerance;
+	scalar residualEpsilon = input->residualTolerance;
+	b3ThreadPool* pool = input->threadPool;
 	b3DenseVec3& x = *output->x;
 
-	// Jacobi preconditioner
-	// P = diag(A) 
-	b3DiagMat33 P(A.rowCount);
-	b3DiagMat33 invP(A.rowCount);
-	for (u32 i = 0; i < A.rowCount; ++i)
+	B3_ASSERT(A != nullptr || op != nullptr);
+	B3_ASSERT(input->cache != nullptr);
+	b3SolveCGCache* cache = input->cache;
+
+	u32 n = A ? A->rowCount : op->GetRowCount();
+	B3_ASSERT(b.n == n && x.n == n);
+
+	b3PreconditionerType preconditioner = input->preconditioner;
+
+	b3SparseMultigrid* multigrid = nullptr;
+	if (preconditioner == e_multigridPreconditioner)
+	{
+		B3_ASSERT(A != nullptr);
+		B3_ASSERT(input->multigrid != nullptr);
+		multigrid = input->multigrid;
+		
+		// Compute the operators of the coarse levels.
+		multigrid->Update(*A);
+	}
+
+	b3SparseIncompleteCholesky* incompleteCholesky = nullptr;
+	if (preconditioner == e_incompleteCholeskyPreconditioner)
+	{
+		B3_ASSERT(A != nullptr);
+		B3_ASSERT(input->incompleteCholesky != nullptr);
+		incompleteCholesky = input->incompleteCholesky;
+
+		// Compute the numeric factorization.
+		if (incompleteCholesky->Update(*A) == false)
+		{
+			// Fall back to the block Jacobi preconditioner for this system.
+			incompleteCholesky = nullptr;
+			preconditioner = e_blockJacobiPreconditioner;
+		}
+	}
+
+	// Is the preconditioner a block diagonal matrix?
+	bool diagonal = multigrid == nullptr && incompleteCholesky == nullptr;
+
+	b3DiagMat33& invP = cache->invP;
+	b3DenseVec3& r = cache->r;
+	b3DenseVec3& c = cache->c;
+	b3DenseVec3& q = cache->q;
+	b3DenseVec3& s = cache->s;
+
+	invP.Resize(n);
+	r.Resize(n);
+	c.Resize(n);
+	q.Resize(n);
+	s.Resize(n);
+
+	const u32 chunkSize = B3_SOLVER_CHUNK_SIZE;
+	u32 chunkCount = b3GetChunkCount(n, chunkSize);
+
+	cache->partials.Resize(chunkCount);
+	scalar* partials = cache->partials.Begin();
+
+	b3CGDotTask dotTask;
+	dotTask.partials = partials;
+
+	// The Jacobi preconditioners keep the initial error b^T * P * b of the original solver.
+	// The other preconditioners measure it in the norm of the residual, b^T * P^-1 * b, 
+	// because their P is not available as a matrix.
+	if (diagonal)
+	{
+		// Jacobi preconditioner
+		// P = diag(A) 
+		// Block Jacobi preconditioner
+		// P = blockdiag(A) 
+		if (A)
+		{
+			for (u32 i = 0; i < n; ++i)
+			{
+				invP[i] = (*A)(i, i);
+			}
+		}
+		else
+		{
+			op->GetDiagonal(invP);
+		}
+
+		b3CGPreconditionTask preconditionTask;
+		preconditionTask.type = preconditioner;
+		preconditionTask.b = &b;
+		preconditionTask.invP = &invP;
+		preconditionTask.partials = partials;
+
+		b3Execute(pool, &preconditionTask, n, chunkSize);
+	}
+	else
+	{
+		// c = P^-1 * b
+		b3Precondition(c, b, multigrid, incompleteCholesky);
+
+		dotTask.u = &b;
+		dotTask.v = &c;
+		b3Execute(pool, &dotTask, n, chunkSize);
+	}
+
+	scalar delta_0 = b3PairwiseSum(partials, chunkCount);
+
+	// r = b - A * x
+	// c = P^-1 * r
+	if (A == nullptr)
 	{
-		b3Mat33 a = A(i, i);
+		op->Multiply(r, x);
+	}
 
-		B3_ASSERT(a.x.x > scalar(0));
-		scalar xx = scalar(1) / a.x.x;
+	b3CGResidualTask residualTask;
+	residualTask.A = A;
+	residualTask.x = &x;
+	residualTask.b = &b;
+	residualTask.invP = diagonal ? &invP : nullptr;
+	residualTask.r = &r;
+	residualTask.c = &c;
+	residualTask.partials = partials;
 
-		B3_ASSERT(a.y.y > scalar(0));
-		scalar yy = scalar(1) / a.y.y;
+	b3Execute(pool, &residualTask, n, chunkSize);
 
-		B3_ASSERT(a.z.z > scalar(0));
-		scalar zz = scalar(1) / a.z.z;
+	dotTask.u = &r;
 
-		P[i] = b3Mat33Diagonal(a.x.x, a.y.y, a.z.z);
-		invP[i] = b3Mat33Diagonal(xx, yy, zz);
+	if (diagonal == false)
+	{
+		b3Precondition(c, r, multigrid, incompleteCholesky);
+
+		dotTask.v = &c;
+		b3Execute(pool, &dotTask, n, chunkSize);
 	}
 
-	scalar delta_0 = b3Dot(b, P * b);
+	scalar delta_new = b3PairwiseSum(partials, chunkCount);
+
+	scalar delta_start = delta_new;
+
+	b3CGMulTask mulTask;
+	mulTask.A = A;
+	mulTask.c = &c;
+	mulTask.q = &q;
+	mulTask.partials = partials;
 
-	b3DenseVec3 r = b - A * x;
-	b3DenseVec3 c = invP * r;
+	b3CGUpdateTask updateTask;
+	updateTask.c = &c;
+	updateTask.q = &q;
+	updateTask.invP = diagonal ? &invP : nullptr;
+	updateTask.x = &x;
+	updateTask.r = &r;
+	updateTask.s = &s;
+	updateTask.partials = partials;
 
-	scalar delta_new = b3Dot(r, c);
+	b3CGDirectionTask directionTask;
+	directionTask.s = &s;
+	directionTask.c = &c;
 
 	u32 iteration = 0;
 	for (;;)
@@ -71,22 +436,46 @@ bool b3SparseSolveCG(b3SolveCGOutput* output, const b3SolveCGInput* input)
 			break;
 		}
 
-		b3DenseVec3 q = A * c;
+		if (delta_new <= residualEpsilon * residualEpsilon * delta_start)
+		{
+			break;
+		}
+
+		// q = A * c
+		if (A == nullptr)
+		{
+			op->Multiply(q, c);
+		}
+
+		b3Execute(pool, &mulTask, n, chunkSize);
+
+		scalar alpha = delta_new / b3PairwiseSum(partials, chunkCount);
 
-		scalar alpha = delta_new / b3Dot(c, q);
+		// x = x + alpha * c
+		// r = r - alpha * q
+		// s = P^-1 * r
+		updateTask.alpha = alpha;
 
-		x = x + alpha * c;
-		r = r - alpha * q;
+		b3Execute(pool, &updateTask, n, chunkSize);
 
-		b3DenseVec3 s = invP * r;
+		if (diagonal == false)
+		{
+			b3Precondition(s, r, multigrid, incompleteCholesky);
+
+			dotTask.v = &s;
+			b3Execute(pool, &dotTask, n, chunkSize);
+		}
 
 		scalar delta_old = delta_new;
 
-		delta_new = b3Dot(r, s);
+		delta_new = b3PairwiseSum(partials, chunkCount);
 
 		scalar beta = delta_new / delta_old;
 
-		c = s + beta * c;
+		// c = s + beta * c
+		directionTask.beta = beta;
+
+		b3Execute(pool, &directionTask, n, chunkSize);
 
 		++iteration;
 	}
@@ -42,6 +42,11 @@ public:
 	{
 		Test::Step();
 
+		m_body->SetWarmStart(g_testSettings->warmStart);
+		m_body->SetCompareColdStart(g_testSettings->compareColdStart);
+		m_body->SetAdaptiveSubTolerance(g_testSettings->adaptiveSubTolerance);
+		m_body->SetLinearSolver(b3LinearSolverType(g_testSettings->linearSolver));
+		m_body->SetPreconditioner(b3PreconditionerType(g_testSettings->preconditioner));
 		m_body->Step(g_testSettings->inv_hertz,
 			g_testSettings->forceIterations,
 			g_testSettings->forceSubIterations);
@@ -58,12 +63,14 @@ public:
 			b3DrawSegment(g_debugDrawData, pA, pB, b3Color_white);
 		}
 
-		extern u32 b3_forceSolverIterations;
-		extern u32 b3_forceSolverMinSubIterations;
-		extern u32 b3_forceSolverMaxSubIterations;
+		const b3SolverStats& stats = m_body->GetSolverStats();
 
-		DrawString(b3Color_white, "Iterations = %d", b3_forceSolverIterations);
-		DrawString(b3Color_white, "Sub-iterations [min] [max] = [%d] [%d]", b3_forceSolverMinSubIterations, b3_forceSolverMaxSubIterations);
+		DrawString(b3Color_white, "Iterations = %d", stats.iterations);
+		DrawString(b3Color_white, "Sub-iterations [min] [max] = [%d] [%d]", stats.minSubIterations, stats.maxSubIterations);
+		DrawString(b3Color_white, "Sub-iterations [total] [saved] = [%d] [%d]", stats.subIterations, stats.savedSubIterations);
+		DrawString(b3Color_white, "Time [forces] [assembly] [solve] [synchronize] [step] = [%.2f] [%.2f] [%.2f] [%.2f] [%.2f] ms", 
+			stats.forceTime, stats.assemblyTime, stats.solveTime, stats.synchronizeTime, stats.stepTime);
+		DrawString(b3Color_white, "Allocations = %d", stats.allocCount);
 
 		scalar E = m_body->GetEnergy();
 		DrawString(b3Color_white, "E = %f", E);
@@ -0,0 +1,87 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef DUPLICATE_FIXTURES_H
+#define DUPLICATE_FIXTURES_H
+
+// This test creates the fixtures of a cloth a second time.
+// The body must return the existing fixtures instead of creating duplicates.
+class DuplicateFixtures : public PinnedCloth
+{
+public:
+	DuplicateFixtures()
+	{
+		// Create a sphere for each vertex twice.
+		for (int i = 0; i < m_clothMesh.vertexCount; ++i)
+		{
+			b3SphereFixtureDef sd;
+			sd.p = m_body->GetParticle(i);
+			sd.radius = 0.05f;
+
+			b3SphereFixture* s1 = m_body->CreateSphere(sd);
+			b3SphereFixture* s2 = m_body->CreateSphere(sd);
+			B3_ASSERT(s1 == s2);
+			B3_NOT_USED(s1);
+			B3_NOT_USED(s2);
+		}
+
+		u32 triangleCount = m_body->GetTriangleList().m_count;
+
+		// Create the triangles again with the vertices in a different order.
+		for (int i = 0; i < m_clothMesh.triangleCount; ++i)
+		{
+			BodyMeshTriangle triangle = m_clothMesh.GetTriangle(i);
+
+			b3TriangleFixtureDef td;
+			td.p1 = m_body->GetParticle(triangle.v2);
+			td.p2 = m_body->GetParticle(triangle.v3);
+			td.p3 = m_body->GetParticle(triangle.v1);
+			td.v1 = m_clothMesh.GetVertexPosition(triangle.v2);
+			td.v2 = m_clothMesh.GetVertexPosition(triangle.v3);
+			td.v3 = m_clothMesh.GetVertexPosition(triangle.v1);
+
+			m_body->CreateTriangle(td);
+		}
+
+		m_sphereCount = m_body->GetSphereList().m_count;
+		m_triangleCount = m_body->GetTriangleList().m_count;
+
+		// The counts must match the mesh.
+		B3_ASSERT(m_sphereCount == u32(m_clothMesh.vertexCount));
+		B3_ASSERT(m_triangleCount == triangleCount);
+		B3_NOT_USED(triangleCount);
+	}
+
+	void Step()
+	{
+		PinnedCloth::Step();
+
+		DrawString(b3Color_white, "Spheres = %d (vertices = %d)", m_sphereCount, m_clothMesh.vertexCount);
+		DrawString(b3Color_white, "Triangles = %d (mesh triangles = %d)", m_triangleCount, m_clothMesh.triangleCount);
+	}
+
+	static Test* Create()
+	{
+		return new DuplicateFixtures;
+	}
+
+	u32 m_sphereCount;
+	u32 m_triangleCount;
+};
+
+#endif
\ No newline at end of file
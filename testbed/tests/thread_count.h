@@ -0,0 +1,52 @@
+/*
+* Copyright (c) 2016-2019 Irlan Robson
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef THREAD_COUNT_H
+#define THREAD_COUNT_H
+
+// This test changes the number of solver threads between steps.
+// Workers started after previous steps must only run new jobs.
+class ThreadCount : public PinnedCloth
+{
+public:
+	ThreadCount()
+	{
+		m_stepCount = 0;
+	}
+
+	void Step()
+	{
+		// Cycle through 1 to 4 threads.
+		u32 threadCount = 1 + (m_stepCount % 4);
+		m_body->SetThreadCount(threadCount);
+		++m_stepCount;
+
+		PinnedCloth::Step();
+
+		DrawString(b3Color_white, "Threads = %d", threadCount);
+	}
+
+	static Test* Create()
+	{
+		return new ThreadCount;
+	}
+
+	u32 m_stepCount;
+};
+
+#endif
\ No newline at end of file
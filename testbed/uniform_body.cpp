@@ -20,7 +20,7 @@
 
 UniformBody::UniformBody()
 {
-	m_particles = nullptr;
+	m_bodyMesh = nullptr;
 }
 
 UniformBody::UniformBody(const ClothDef& def)
@@ -28,98 +28,43 @@ UniformBody::UniformBody(const ClothDef& def)
 	const BodyMesh* mesh = def.mesh;
 	m_mesh = mesh;
 
-	// Create particles
-	m_particles = (b3Particle**)malloc(mesh->vertexCount * sizeof(b3Particle*));
-	for (int i = 0; i < mesh->vertexCount; ++i)
-	{
-		b3Vec3 v = mesh->GetVertexPosition(i);
-
-		b3ParticleDef pd;
-		pd.type = e_dynamicParticle;
-		pd.position = v;
-		pd.meshIndex = i;
-
-		b3Particle* p = CreateParticle(pd);
-		m_particles[i] = p;
-
-		b3SphereFixtureDef sd;
-		sd.p = p;
-		sd.radius = def.thickness;
-		sd.friction = def.friction;
-		sd.meshIndex = i;
-		
-		CreateSphere(sd);
-	}
-
-	// Create triangles
+	u32* triangles = (u32*)malloc(3 * mesh->triangleCount * sizeof(u32));
 	for (int i = 0; i < mesh->triangleCount; ++i)
 	{
 		BodyMeshTriangle triangle = mesh->GetTriangle(i);
+		triangles[3 * i + 0] = triangle.v1;
+		triangles[3 * i + 1] = triangle.v2;
+		triangles[3 * i + 2] = triangle.v3;
+	}
 
-		int vi1 = triangle.v1;
-		int vi2 = triangle.v2;
-		int vi3 = triangle.v3;
-
-		b3Particle* p1 = m_particles[vi1];
-		b3Particle* p2 = m_particles[vi2];
-		b3Particle* p3 = m_particles[vi3];
-
-		b3Vec3 v1 = p1->GetPosition();
-		b3Vec3 v2 = p2->GetPosition();
-		b3Vec3 v3 = p3->GetPosition();
-
-		b3TriangleFixtureDef td;
-		td.p1 = p1;
-		td.p2 = p2;
-		td.p3 = p3;
-		td.v1 = v1;
-		td.v2 = v2;
-		td.v3 = v3;
-		td.density = def.density;
-		td.radius = def.thickness;
-		td.friction = def.friction;
-		td.meshIndex = i;
-
-		CreateTriangle(td);
-
-		if (def.createElements)
-		{
-			b3TriangleElementForceDef fd;
-			fd.p1 = p1;
-			fd.p2 = p2;
-			fd.p3 = p3;
-			fd.v1 = v1;
-			fd.v2 = v2;
-			fd.v3 = v3;
-			fd.youngModulusX = def.elementYoungModulus;
-			fd.youngModulusY = def.elementYoungModulus;
-			fd.shearModulus = def.elementShearModulus;
-			fd.poissonRationXY = def.elementPoissonRatio;
-			fd.poissonRationYX = def.elementPoissonRatio;
-			fd.stiffnessDamping = def.elementStiffnessDamping;
-			fd.meshIndex = i;
-
-			CreateForce(fd);
-		}
-		else
-		{
-			b3StretchForceDef fd;
-			fd.Initialize(v1, v2, v3);
+	b3BodyMeshDef bd;
+	bd.vertexCount = mesh->vertexCount;
+	bd.vertices = mesh->vertices;
+	bd.triangleCount = mesh->triangleCount;
+	bd.triangles = triangles;
+	bd.radius = def.thickness;
+	bd.friction = def.friction;
+	bd.triangleDensity = def.density;
+	bd.createTriangleForces = true;
+	if (def.createElements)
+	{
+		bd.triangleForceType = e_triangleElementForce;
+		bd.triangleYoungModulus = def.elementYoungModulus;
+		bd.triangleShearModulus = def.elementShearModulus;
+		bd.trianglePoissonRatio = def.elementPoissonRatio;
+		bd.triangleStiffnessDamping = def.elementStiffnessDamping;
+	}
+	else
+	{
+		bd.triangleForceType = e_stretchForce;
+		bd.stretchingStiffness = def.stretchingStiffness;
+		bd.stretchStiffnessDamping = def.stretchStiffnessDamping;
+	}
 
-			fd.p1 = p1;
-			fd.p2 = p2;
-			fd.p3 = p3;
-			fd.stiffness_u = def.stretchingStiffness;
-			fd.damping_stiffness_u = def.stretchStiffnessDamping;
-			fd.b_u = scalar(1);
-			fd.stiffness_v = def.stretchingStiffness;
-			fd.damping_stiffness_v = def.stretchStiffnessDamping;
-			fd.b_v = scalar(1);
-			fd.meshIndex = i;
+	m_bodyMesh = CreateMesh(bd);
+	assert(m_bodyMesh != nullptr);
 
-			CreateForce(fd);
-		}
-	}
+	free(triangles);
 }
 
 UniformBody::UniformBody(const TetDef& def)
@@ -127,116 +72,51 @@ UniformBody::UniformBody(const TetDef& def)
 	const BodyMesh* mesh = def.mesh;
 	m_mesh = mesh;
 
-	// Create particles
-	m_particles = (b3Particle**)malloc(mesh->vertexCount * sizeof(b3Particle*));
-	for (int i = 0; i < mesh->vertexCount; ++i)
-	{
-		b3Vec3 v = mesh->GetVertexPosition(i);
-
-		b3ParticleDef pd;
-		pd.type = e_dynamicParticle;
-		pd.position = v;
-		pd.meshIndex = i;
-
-		b3Particle* p = CreateParticle(pd);
-
-		m_particles[i] = p;
-
-		b3SphereFixtureDef sd;
-		sd.p = p;
-		sd.radius = def.thickness;
-		sd.friction = def.friction;
-		sd.meshIndex = i;
-
-		CreateSphere(sd);
-	}
-
-	// Create triangles
+	u32* triangles = (u32*)malloc(3 * mesh->triangleCount * sizeof(u32));
 	for (int i = 0; i < mesh->triangleCount; ++i)
 	{
 		BodyMeshTriangle triangle = mesh->GetTriangle(i);
-
-		int v1 = triangle.v1;
-		int v2 = triangle.v2;
-		int v3 = triangle.v3;
-
-		b3Particle* p1 = m_particles[v1];
-		b3Particle* p2 = m_particles[v2];
-		b3Particle* p3 = m_particles[v3];
-
-		b3TriangleFixtureDef td;
-		td.p1 = p1;
-		td.p2 = p2;
-		td.p3 = p3;
-		td.v1 = p1->GetPosition();
-		td.v2 = p2->GetPosition();
-		td.v3 = p3->GetPosition();
-		td.radius = def.thickness;
-		td.friction = def.friction;
-		td.meshIndex = i;
-
-		// Zero mass contribution
-		td.density = scalar(0);
-
-		CreateTriangle(td);
+		triangles[3 * i + 0] = triangle.v1;
+		triangles[3 * i + 1] = triangle.v2;
+		triangles[3 * i + 2] = triangle.v3;
 	}
 
-	// Create tetrahedrons
+	u32* tetrahedrons = (u32*)malloc(4 * mesh->tetrahedronCount * sizeof(u32));
 	for (int i = 0; i < mesh->tetrahedronCount; ++i)
 	{
 		BodyMeshTetrahedron tet = mesh->GetTetrahedron(i);
-
-		int vi1 = tet.v1;
-		int vi2 = tet.v2;
-		int vi3 = tet.v3;
-		int vi4 = tet.v4;
-
-		b3Particle* p1 = m_particles[vi1];
-		b3Particle* p2 = m_particles[vi2];
-		b3Particle* p3 = m_particles[vi3];
-		b3Particle* p4 = m_particles[vi4];
-
-		b3Vec3 v1 = p1->GetPosition();
-		b3Vec3 v2 = p2->GetPosition();
-		b3Vec3 v3 = p3->GetPosition();
-		b3Vec3 v4 = p4->GetPosition();
-
-		b3TetrahedronFixtureDef td;
-		td.p1 = p1;
-		td.p2 = p2;
-		td.p3 = p3;
-		td.p4 = p4;
-		td.v1 = v1;
-		td.v2 = v2;
-		td.v3 = v3;
-		td.v4 = v4;
-		td.density = def.density;
-		td.radius = def.thickness;
-		td.friction = def.friction;
-		td.meshIndex = i;
-
-		CreateTetrahedron(td);
-
-		// Create element
-		b3TetrahedronElementForceDef fd;
-		fd.p1 = p1;
-		fd.p2 = p2;
-		fd.p3 = p3;
-		fd.p4 = p4;
-		fd.v1 = v1;
-		fd.v2 = v2;
-		fd.v3 = v3;
-		fd.v4 = v4;
-		fd.youngModulus = def.elementYoungModulus;
-		fd.poissonRatio = def.elementPoissonRatio;
-		fd.stiffnessDamping = def.elementStiffnessDamping;
-		fd.meshIndex = i;
-
-		CreateForce(fd);
+		tetrahedrons[4 * i + 0] = tet.v1;
+		tetrahedrons[4 * i + 1] = tet.v2;
+		tetrahedrons[4 * i + 2] = tet.v3;
+		tetrahedrons[4 * i + 3] = tet.v4;
 	}
+
+	b3BodyMeshDef bd;
+	bd.vertexCount = mesh->vertexCount;
+	bd.vertices = mesh->vertices;
+	bd.triangleCount = mesh->triangleCount;
+	bd.triangles = triangles;
+	bd.tetrahedronCount = mesh->tetrahedronCount;
+	bd.tetrahedrons = tetrahedrons;
+	bd.radius = def.thickness;
+	bd.friction = def.friction;
+	
+	// The surface triangles have zero mass contribution.
+	bd.triangleDensity = scalar(0);
+	bd.tetrahedronDensity = def.density;
+	
+	bd.createTetrahedronForces = true;
+	bd.tetrahedronYoungModulus = def.elementYoungModulus;
+	bd.tetrahedronPoissonRatio = def.elementPoissonRatio;
+	bd.tetrahedronStiffnessDamping = def.elementStiffnessDamping;
+
+	m_bodyMesh = CreateMesh(bd);
+	assert(m_bodyMesh != nullptr);
+
+	free(tetrahedrons);
+	free(triangles);
 }
 
 UniformBody::~UniformBody()
 {
-	free(m_particles);
-}
+}
\ No newline at end of file
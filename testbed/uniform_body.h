@@ -151,11 +151,11 @@ public:
 	b3Particle* GetParticle(int index)
 	{
 		assert(index < m_mesh->vertexCount);
-		return m_particles[index];
+		return m_bodyMesh->GetParticle(index);
 	}
 private:
 	const BodyMesh* m_mesh;
-	b3Particle** m_particles;
+	b3BodyMesh* m_bodyMesh;
 };
 
 template<int H = 1, int W = 1>
@@ -330,6 +330,16 @@ void View::Interface()
 	ImGui::Text("Force Sub-iterations");
 	ImGui::SliderInt("##Force Sub-iterations", &testSettings.forceSubIterations, 0, 50);
 
+	ImGui::Checkbox("Warm Start", &testSettings.warmStart);
+	ImGui::Checkbox("Compare Cold Start", &testSettings.compareColdStart);
+	ImGui::Checkbox("Adaptive Sub-tolerance", &testSettings.adaptiveSubTolerance);
+
+	ImGui::Text("Linear Solver");
+	ImGui::Combo("##Linear Solver", &testSettings.linearSolver, "CG\0LDLT\0\0");
+
+	ImGui::Text("Preconditioner");
+	ImGui::Combo("##Preconditioner", &testSettings.preconditioner, "Jacobi\0Block Jacobi\0Multigrid\0Incomplete Cholesky\0\0");
+
 	if (ImGui::Button("Play/Pause", buttonSize))
 	{
 		m_viewModel->Action_PlayPause();
@@ -33,6 +33,8 @@
 #include "tests/cloth_element.h"
 #include "tests/sheet.h"
 #include "tests/node_types.h"
+#include "tests/thread_count.h"
+#include "tests/duplicate_fixtures.h"
 
 TestSettings* g_testSettings = nullptr;
 Settings* g_settings = nullptr;
@@ -53,6 +55,8 @@ ViewModel::ViewModel(Model* model, GLFWwindow* window)
 	m_settings.RegisterTest("Cloth Element", &ClothElement::Create);
 	m_settings.RegisterTest("Sheet", &Sheet::Create);
 	m_settings.RegisterTest("Node Types", &NodeTypes::Create);
+	m_settings.RegisterTest("Thread Count", &ThreadCount::Create);
+	m_settings.RegisterTest("Duplicate Fixtures", &DuplicateFixtures::Create);
 
 	g_settings = &m_settings;
 	g_testSettings = &m_testSettings;
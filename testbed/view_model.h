@@ -75,6 +75,11 @@ struct TestSettings
 		inv_hertz = 1.0f / hertz;
 		forceIterations = 1;
 		forceSubIterations = 40;
+		warmStart = false;
+		compareColdStart = false;
+		adaptiveSubTolerance = false;
+		linearSolver = 0;
+		preconditioner = 0;
 		pause = true;
 		singlePlay = false;
 	}
@@ -82,6 +87,11 @@ struct TestSettings
 	float hertz, inv_hertz;
 	int forceIterations;
 	int forceSubIterations;
+	bool warmStart;
+	bool compareColdStart;
+	bool adaptiveSubTolerance;
+	int linearSolver;
+	int preconditioner;
 	bool pause;
 	bool singlePlay;
 };